@@ -489,6 +489,23 @@ inline const char* GetNameCellMode(TpCellMode cellmode){
   return("???");
 }
 
+///Ordering of cell rows (y,z) for the particle sort on CPU (x is always consecutive).
+typedef enum{ 
+   CELLORDER_Linear=0   ///<Linear ordering of rows (z*Ncy+y).
+  ,CELLORDER_Morton=1   ///<Rows ordered according to Morton (Z-order) curve.
+  ,CELLORDER_Hilbert=2  ///<Rows ordered according to Hilbert curve.
+}TpCellOrder; 
+
+///Returns the name of the CellOrder in text format.
+inline const char* GetNameCellOrder(TpCellOrder cellorder){
+  switch(cellorder){
+    case CELLORDER_Linear:   return("Linear");
+    case CELLORDER_Morton:   return("Morton");
+    case CELLORDER_Hilbert:  return("Hilbert");
+  }
+  return("???");
+}
+
 
 ///Domain division mode.
 typedef enum{ 
@@ -70,6 +70,7 @@
 //:# - Mueve funciones de poligonos a FunGeo3dPolygon. (21-11-2020)
 //:# - Mueve funciones de triangulos a FunGeo3dTriangle. (21-11-2020)
 //:# - Nuevas funciones: VecBounce(). (05-05-2021)
+//:# - Error corregido en PointInMinMax() al comprobar el limite maximo en Y. (17-10-2026)
 //:#############################################################################
 
 /// \file FunGeo3d.h \brief Declares geometry functions for 3D.
@@ -137,7 +138,7 @@ inline tfloat3 ProductVec(const tfloat3 &v1,const tfloat3 &v2){
 /// Returns true when pmin <= pt <= pmax.
 //==============================================================================
 inline bool PointInMinMax(const tdouble3 &pt,const tdouble3 &pmin,const tdouble3 &pmax){
-  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.x && pt.z<=pmax.z);
+  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.y && pt.z<=pmax.z);
 }
 
 //==============================================================================
@@ -145,7 +146,7 @@ inline bool PointInMinMax(const tdouble3 &pt,const tdouble3 &pmin,const tdouble3
 /// Returns true when pmin <= pt <= pmax.
 //==============================================================================
 inline bool PointInMinMax(const tfloat3 &pt,const tfloat3 &pmin,const tfloat3 &pmax){
-  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.x && pt.z<=pmax.z);
+  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.y && pt.z<=pmax.z);
 }
 
 
@@ -21,6 +21,7 @@
 //:# =========
 //:# - Implementacion inicial. (01-12-2019)
 //:# - Funciones: PointInMinMax(), PlanePoint() y PlanesDomainCheck(). (01-12-2019)
+//:# - Error corregido en PointInMinMax() al comprobar el limite maximo en Y. (17-10-2026)
 //:#############################################################################
 
 /// \file FunctionsGeo3d_iker.h \brief Implements geometry functions for 3D on CUDA.
@@ -35,7 +36,7 @@ namespace cugeo{
 /// Returns true when pmin <= pt <= pmax.
 //------------------------------------------------------------------------------
 __device__ bool PointInMinMax(const double3 &pt,const double3 &pmin,const double3 &pmax){
-  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.x && pt.z<=pmax.z);
+  return(pmin.x<=pt.x && pmin.y<=pt.y && pmin.z<=pt.z && pt.x<=pmax.x && pt.y<=pmax.y && pt.z<=pmax.z);
 }
 
 //------------------------------------------------------------------------------
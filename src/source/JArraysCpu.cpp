@@ -21,7 +21,16 @@
 #include "JArraysCpu.h"
 #include "Functions.h"
 #include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <algorithm>
+#ifdef WIN32
+  #include <malloc.h>
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #include <sys/syscall.h>
+#endif
 
 using namespace std;
 
@@ -36,6 +45,7 @@ JArraysCpuSize::JArraysCpuSize(unsigned elementsize):ElementSize(elementsize){
   for(unsigned c=0;c<MAXPOINTERS;c++)Pointers[c]=NULL;
   Count=0;
   CountMax=CountUsedMax=0;
+  HugePages=false;
   Reset();
 }
 
@@ -65,28 +75,35 @@ void JArraysCpuSize::FreeMemory(){
 }
 
 //==============================================================================
-/// Reserva memoria y devuelve puntero con memoria asignada.
-/// Allocates memory and returns pointers with allocated memory.
+/// Devuelve el numero de bytes asignados a un array de size elementos.
+/// Returns the number of bytes allocated for an array of size elements.
+//==============================================================================
+size_t JArraysCpuSize::GetPointerBytes(unsigned size)const{
+  const size_t align=(HugePages? HUGEPAGESIZE: ALIGNSIZE);
+  const size_t bytes=size_t(ElementSize)*size;
+  return((bytes+align-1)/align*align);
+}
+
+//==============================================================================
+/// Reserva memoria alineada, la inicializa en paralelo y devuelve el puntero.
+/// Allocates aligned memory, initialises it in parallel and returns the pointer.
 //==============================================================================
 void* JArraysCpuSize::AllocPointer(unsigned size)const{
+  if(ElementSize!=1 && ElementSize!=2 && ElementSize!=4 && ElementSize!=8 && ElementSize!=12
+    && ElementSize!=16 && ElementSize!=24 && ElementSize!=32 && ElementSize!=72)Run_Exceptioon("The elementsize value is invalid.");
+  const size_t align=(HugePages? HUGEPAGESIZE: ALIGNSIZE);
+  const size_t bytes=GetPointerBytes(size);
   void* pointer=NULL;
-  try{
-    switch(ElementSize){
-      case 1:   pointer=new char[size];      break;
-      case 2:   pointer=new word[size];      break;
-      case 4:   pointer=new int[size];       break;
-      case 8:   pointer=new double[size];    break;
-      case 12:  pointer=new int[size*3];     break;
-      case 16:  pointer=new int[size*4];     break;
-      case 24:  pointer=new double[size*3];  break;
-      case 32:  pointer=new double[size*4];  break;
-      case 72:  pointer=new double[size*9];  break;
-    }
-  }
-  catch(const std::bad_alloc){
-    Run_Exceptioon("Cannot allocate the requested memory.");
-  }
-  if(!pointer)Run_Exceptioon("The elementsize value is invalid.");
+#ifdef WIN32
+  pointer=_aligned_malloc(bytes,align);
+#else
+  if(posix_memalign(&pointer,align,bytes))pointer=NULL;
+  #ifdef MADV_HUGEPAGE
+    if(pointer && HugePages)madvise(pointer,bytes,MADV_HUGEPAGE);
+  #endif
+#endif
+  if(!pointer)Run_Exceptioon("Cannot allocate the requested memory.");
+  FirstTouch(pointer,size);
   return(pointer);
 }
 
@@ -95,18 +112,76 @@ void* JArraysCpuSize::AllocPointer(unsigned size)const{
 /// Frees memory allocated to pointers.
 //==============================================================================
 void JArraysCpuSize::FreePointer(void* pointer)const{
-  switch(ElementSize){
-    case 1:   delete[] ((char*)pointer);    pointer=NULL;   break;
-    case 2:   delete[] ((word*)pointer);    pointer=NULL;   break;
-    case 4:   delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 8:   delete[] ((double*)pointer);  pointer=NULL;   break;
-    case 12:  delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 16:  delete[] ((int*)pointer);     pointer=NULL;   break;
-    case 24:  delete[] ((double*)pointer);  pointer=NULL;   break;
-    case 32:  delete[] ((double*)pointer);  pointer=NULL;   break;
-    case 72:  delete[] ((double*)pointer);  pointer=NULL;   break;
+#ifdef WIN32
+  _aligned_free(pointer);
+#else
+  free(pointer);
+#endif
+}
+
+//==============================================================================
+/// Inicializa a cero el array con el mismo reparto estatico de particulas entre
+/// hilos que los calculos, asi cada pagina se asigna al nodo NUMA del hilo que
+/// la usa (first touch).
+/// Initialises the array to zero with the same static distribution of particles
+/// among threads as the computations, so each page is placed on the NUMA node
+/// of the thread that uses it (first touch).
+//==============================================================================
+void JArraysCpuSize::FirstTouch(void* pointer,unsigned size)const{
+  byte *ptr=(byte*)pointer;
+  const size_t esize=ElementSize;
+  const int n=int(size);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++)memset(ptr+esize*p,0,esize);
+  //-Padding of the last page.
+  const size_t bytes=esize*size;
+  memset(ptr+bytes,0,GetPointerBytes(size)-bytes);
+}
+
+//==============================================================================
+/// Cambia el uso de huge pages. Los arrays ya asignados se vuelven a asignar.
+/// Changes the use of huge pages. Arrays already allocated are allocated again.
+//==============================================================================
+void JArraysCpuSize::SetHugePages(bool hugepages){
+  if(HugePages!=hugepages){
+    if(CountUsed)Run_Exceptioon("Unable to change the allocation mode of the arrays because some are in use.");
+    HugePages=hugepages;
+    const unsigned count=Count;
+    FreeMemory();
+    if(count)SetArrayCount(count);
+  }
+}
+
+//==============================================================================
+/// Suma en nodepages[] el numero de paginas en cada nodo NUMA y devuelve el
+/// numero de paginas consultadas (0 cuando no esta disponible).
+/// Adds to nodepages[] the number of pages on each NUMA node and returns the
+/// number of checked pages (0 when it is not available).
+//==============================================================================
+unsigned JArraysCpuSize::CountNodePages(unsigned nodesmax,ullong *nodepages)const{
+  unsigned npages=0;
+#if !defined(WIN32) && defined(SYS_move_pages)
+  const size_t pagesize=size_t(sysconf(_SC_PAGESIZE));
+  const unsigned nmax=256; //-Maximum number of checked pages per array.
+  void* pages[nmax];
+  int status[nmax];
+  for(unsigned c=0;c<Count;c++)if(Pointers[c]){
+    const size_t bytes=GetPointerBytes(ArraySize);
+    const size_t np=bytes/pagesize;
+    const size_t step=max(size_t(1),np/nmax);
+    unsigned n=0;
+    for(size_t cp=0;cp<np && n<nmax;cp+=step)pages[n++]=(byte*)Pointers[c]+cp*pagesize;
+    //-Only queries the nodes with nodes=NULL (no page is moved).
+    if(n && syscall(SYS_move_pages,0,(unsigned long)n,pages,(const int*)NULL,status,0)==0){
+      for(unsigned cp=0;cp<n;cp++)if(status[cp]>=0 && unsigned(status[cp])<nodesmax){
+        nodepages[status[cp]]++; npages++;
+      }
+    }
   }
-  if(pointer)Run_Exceptioon("The elementsize value is invalid.");
+#endif
+  return(npages);
 }
 
 //==============================================================================
@@ -252,6 +327,49 @@ llong JArraysCpu::GetAllocMemoryCpu()const{
   return(m);
 }
 
+//==============================================================================
+/// Cambia el uso de huge pages. Si hay algun array en uso lanza una excepcion.
+/// Changes the use of huge pages. If there is any array in use raises an exception.
+//==============================================================================
+void JArraysCpu::SetHugePages(bool hugepages){
+  Arrays1b->SetHugePages(hugepages);
+  Arrays2b->SetHugePages(hugepages);
+  Arrays4b->SetHugePages(hugepages);
+  Arrays8b->SetHugePages(hugepages);
+  Arrays12b->SetHugePages(hugepages);
+  Arrays16b->SetHugePages(hugepages);
+  Arrays24b->SetHugePages(hugepages);
+  Arrays32b->SetHugePages(hugepages);
+  Arrays72b->SetHugePages(hugepages);
+}
+
+//==============================================================================
+/// Devuelve el reparto de paginas de los arrays entre nodos NUMA (muestreado).
+/// Devuelve un texto vacio cuando no esta disponible.
+/// Returns the distribution of pages of the arrays among NUMA nodes (sampled).
+/// Returns an empty string when it is not available.
+//==============================================================================
+std::string JArraysCpu::GetNumaInfo()const{
+  const unsigned nodesmax=64;
+  ullong nodepages[nodesmax];
+  for(unsigned c=0;c<nodesmax;c++)nodepages[c]=0;
+  ullong npages=0;
+  npages+=Arrays1b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays2b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays4b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays8b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays12b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays16b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays24b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays32b->CountNodePages(nodesmax,nodepages);
+  npages+=Arrays72b->CountNodePages(nodesmax,nodepages);
+  string tx;
+  if(npages)for(unsigned c=0;c<nodesmax;c++)if(nodepages[c]){
+    tx=tx+(tx.empty()? "": ", ")+fun::PrintStr("node%u: %.1f%%",c,double(nodepages[c])*100./npages);
+  }
+  return(tx);
+}
+
 //==============================================================================
 /// Cambia el numero de elementos de los arrays.
 /// Si hay algun array en uso lanza una excepcion.
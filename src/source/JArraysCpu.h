@@ -23,6 +23,9 @@
 //:# - Remplaza long long por llong. (01-10-2015)
 //:# - Mejora la gestion de excepciones. (06-05-2020)
 //:# - Incorpora nuevos tipos. (11-04-2021)
+//:# - Los arrays se alinean a 64 bytes (o 2 MB con huge pages) y se inicializan
+//:#   en paralelo con el mismo reparto estatico de OpenMP que los calculos para
+//:#   repartir las paginas entre nodos NUMA (first touch). (17-10-2026)
 //:#############################################################################
 
 /// \file JArraysCpu.h \brief Declares the class \ref JArraysCpu.
@@ -32,17 +35,27 @@
 
 #include "JObject.h"
 #include "DualSphDef.h"
+#include <string>
 
 //##############################################################################
 //# JArraysCpuSize
 //##############################################################################
 /// \brief Defines the type of elements of the arrays managed in \ref JArraysCpu with a given size.
+///
+/// Arrays are aligned to ALIGNSIZE bytes (or HUGEPAGESIZE with HugePages) and
+/// they are initialised by the threads that compute each particle range with
+/// schedule(static), so the pages are placed on the NUMA node of those threads.
 
 class JArraysCpuSize : protected JObject
 {
+public:
+  static const unsigned ALIGNSIZE=64;          ///<Alignment of arrays (cache line).
+  static const unsigned HUGEPAGESIZE=2097152;  ///<Alignment of arrays with HugePages (2 MB).
+
 protected:
   const unsigned ElementSize;
   unsigned ArraySize;
+  bool HugePages;   ///<Arrays are aligned to HUGEPAGESIZE and use transparent huge pages when available.
 
   static const unsigned MAXPOINTERS=30;
   void* Pointers[MAXPOINTERS];
@@ -51,8 +64,10 @@ protected:
 
   unsigned CountMax,CountUsedMax;
   
+  size_t GetPointerBytes(unsigned size)const;
   void* AllocPointer(unsigned size)const;
   void FreePointer(void* pointer)const;
+  void FirstTouch(void* pointer,unsigned size)const;
 
   void FreeMemory();
   unsigned FindPointerUsed(void *pointer)const;
@@ -74,7 +89,12 @@ public:
 
   llong GetAllocMemoryCpu()const{ return((llong)(Count)*ElementSize*ArraySize); };
 
+  void SetHugePages(bool hugepages);
+  bool GetHugePages()const{ return(HugePages); }
+  unsigned CountNodePages(unsigned nodesmax,ullong *nodepages)const;
+
   void* Reserve();
+  void* TryReserve(){ return(CountUsed<Count && ArraySize? Reserve(): NULL); }
   void Free(void *pointer);
 };
 
@@ -135,6 +155,10 @@ public:
   void SetArraySize(unsigned size);
   unsigned GetArraySize()const{ return(Arrays1b->GetArraySize()); }
 
+  void SetHugePages(bool hugepages);
+  bool GetHugePages()const{ return(Arrays1b->GetHugePages()); }
+  std::string GetNumaInfo()const;
+
   byte*        ReserveByte(){       return((byte*)Arrays1b->Reserve());         }
   word*        ReserveWord(){       return((word*)Arrays2b->Reserve());         }
   unsigned*    ReserveUint(){       return((unsigned*)Arrays4b->Reserve());     }
@@ -154,6 +178,12 @@ public:
   typecode*    ReserveTypeCode(){   return(ReserveWord());                      }
 #endif
 
+  /// Reserves an array of elementsize bytes when one is free, otherwise returns NULL.
+  void* TryReserve(unsigned elementsize){ return(GetArrays(TpArraySize(elementsize))->TryReserve()); }
+
+  /// Frees an array of elementsize bytes.
+  void Free(unsigned elementsize,void *pointer){ GetArrays(TpArraySize(elementsize))->Free(pointer); }
+
   void Free(byte        *pointer){ Arrays1b->Free(pointer);  }
   void Free(word        *pointer){ Arrays2b->Free(pointer);  }
   void Free(unsigned    *pointer){ Arrays4b->Free(pointer);  }
@@ -148,6 +148,7 @@ class JBinaryDataArray : protected JObject
 
   void ConfigFileData(llong filepos,unsigned datacount,unsigned datasize);
   void ClearFileData();
+  llong GetFileDataPos()const{ return(FileDataPos); }
   unsigned GetFileDataCount()const{ return(FileDataCount); }
   unsigned GetFileDataSize()const{ return(FileDataSize); }
   void ReadFileData(bool resize);
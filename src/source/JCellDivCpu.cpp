@@ -21,8 +21,11 @@
 #include "JCellDivCpu.h"
 #include "JAppInfo.h"
 #include "Functions.h"
+#include "FunSphEos.h"
 #include <cfloat>
 #include <climits>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -30,12 +33,12 @@ using namespace std;
 /// Constructor.
 //==============================================================================
 JCellDivCpu::JCellDivCpu(bool stable,bool floating,byte periactive
-  ,bool celldomfixed,TpCellMode cellmode,float scell
+  ,bool celldomfixed,TpCellMode cellmode,TpCellOrder cellorder,float scell
   ,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells
   ,unsigned casenbound,unsigned casenfixed,unsigned casenpb,std::string dirout
   ,bool allocfullnct,float overmemorynp,word overmemorycells)
   :Log(AppInfo.LogPtr()),Stable(stable),Floating(floating),PeriActive(periactive)
-  ,CellDomFixed(celldomfixed),CellMode(cellmode)
+  ,CellDomFixed(celldomfixed),CellMode(cellmode),CellOrder(cellorder)
   ,ScellDiv(cellmode==CELLMODE_Full? 1: (cellmode==CELLMODE_Half? 2: 0))
   ,Scell(scell),OvScell(1.f/scell)
   ,Map_PosMin(mapposmin),Map_PosMax(mapposmax),Map_PosDif(mapposmax-mapposmin)
@@ -45,7 +48,9 @@ JCellDivCpu::JCellDivCpu(bool stable,bool floating,byte periactive
   ClassName="JCellDivCpu";
   CellPart=NULL;    SortPart=NULL;
   PartsInCell=NULL; BeginCell=NULL;
+  PartsInCellBlk=NULL;
   VSort=NULL;
+  SizeRowCell=0; RowCell=NULL;
   Reset();
 }
 
@@ -63,6 +68,7 @@ JCellDivCpu::~JCellDivCpu(){
 //==============================================================================
 void JCellDivCpu::Reset(){
   SizeNp=SizeNct=0;
+  SizePartsInCellBlk=0;
   IncreaseNp=0;
   FreeMemoryAll();
   Ndiv=NdivFull=0;
@@ -88,10 +94,82 @@ void JCellDivCpu::Reset(){
 void JCellDivCpu::FreeMemoryNct(){
   delete[] PartsInCell;   PartsInCell=NULL;
   delete[] BeginCell;     BeginCell=NULL; 
+  delete[] PartsInCellBlk; PartsInCellBlk=NULL;
+  SizePartsInCellBlk=0;
   MemAllocNct=0;
   BoundDivideOk=false;
 }
 
+//==============================================================================
+/// Returns key of position (y,z) in Morton (Z-order) curve.
+/// Devuelve la clave de la posicion (y,z) en la curva de Morton (Z-order).
+//==============================================================================
+static ullong CellOrderMortonKey(unsigned y,unsigned z){
+  ullong key=0;
+  for(unsigned b=0;b<32;b++){
+    key|=(ullong((y>>b)&1)<<(b*2)) | (ullong((z>>b)&1)<<(b*2+1));
+  }
+  return(key);
+}
+
+//==============================================================================
+/// Returns key of position (y,z) in Hilbert curve of size n (power of 2).
+/// Devuelve la clave de la posicion (y,z) en la curva de Hilbert de tamanho n 
+/// (potencia de 2).
+//==============================================================================
+static ullong CellOrderHilbertKey(unsigned n,unsigned y,unsigned z){
+  ullong key=0;
+  for(unsigned s=n/2;s>0;s/=2){
+    const unsigned ry=((y&s)>0? 1: 0);
+    const unsigned rz=((z&s)>0? 1: 0);
+    key+=ullong(s)*ullong(s)*((3*ry)^rz);
+    //-Rotates quadrant. | Rota el cuadrante.
+    if(rz==0){
+      if(ry==1){ y=n-1-y; z=n-1-z; }
+      const unsigned t=y; y=z; z=t;
+    }
+  }
+  return(key);
+}
+
+//==============================================================================
+/// Computes first cell of each row (y,z) according to CellOrder. Cells in x
+/// direction remain consecutive, so each row is a single range of particles
+/// for neighbour search. It is only recomputed when the number of cells changes.
+/// Calcula la primera celda de cada fila (y,z) segun CellOrder. Las celdas en
+/// direccion x siguen siendo consecutivas, por lo que cada fila es un unico 
+/// rango de particulas para la busqueda de vecinos. Solo se recalcula cuando 
+/// cambia el numero de celdas.
+//==============================================================================
+void JCellDivCpu::PrepareRowCell(){
+  if(CellOrder==CELLORDER_Linear || RowCellNc==TUint3(Ncx,Ncy,Ncz))return;
+  const unsigned nrow=Ncy*Ncz;
+  if(nrow>SizeRowCell){
+    delete[] RowCell; RowCell=NULL;
+    SizeRowCell=0;
+    try{
+      RowCell=new unsigned[nrow];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Failed CPU memory allocation for ordering of %u cell rows.",nrow));
+    }
+    SizeRowCell=nrow;
+  }
+  //-Computes key of each row. | Calcula clave de cada fila.
+  unsigned n=1;
+  while(n<Ncy || n<Ncz)n*=2;
+  std::vector< std::pair<ullong,unsigned> > keys(nrow);
+  for(unsigned cz=0;cz<Ncz;cz++)for(unsigned cy=0;cy<Ncy;cy++){
+    const unsigned row=cy+cz*Ncy;
+    keys[row].first=(CellOrder==CELLORDER_Morton? CellOrderMortonKey(cy,cz): CellOrderHilbertKey(n,cy,cz));
+    keys[row].second=row;
+  }
+  std::sort(keys.begin(),keys.end());
+  //-Assigns first cell of each row. | Asigna primera celda de cada fila.
+  for(unsigned c=0;c<nrow;c++)RowCell[keys[c].second]=c*Ncx;
+  RowCellNc=TUint3(Ncx,Ncy,Ncz);
+}
+
 //==============================================================================
 /// Free memory reserved for particles.
 /// Libera memoria reservada para particulas.
@@ -111,6 +189,9 @@ void JCellDivCpu::FreeMemoryNp(){
 void JCellDivCpu::FreeMemoryAll(){
   FreeMemoryNct();
   FreeMemoryNp();
+  delete[] RowCell; RowCell=NULL;
+  SizeRowCell=0;
+  RowCellNc=TUint3(0);
 }
 
 //==============================================================================
@@ -211,6 +292,29 @@ void JCellDivCpu::CheckMemoryNct(unsigned nctmin){
   else if(!BeginCell)AllocMemoryNct(SizeNct);  
 }
 
+//==============================================================================
+/// Check reserved memory for counters of particles per cell of each block of
+/// particles used in the multi-threaded divide. Memory is only increased.
+///
+/// Comprueba la reserva de memoria para contadores de particulas por celda de 
+/// cada bloque de particulas usado en el divide multihilo. Solo aumenta la memoria.
+//==============================================================================
+void JCellDivCpu::CheckMemoryPartsInCellBlk(ullong size){
+  if(SizePartsInCellBlk<size){
+    delete[] PartsInCellBlk; PartsInCellBlk=NULL;
+    MemAllocNct-=sizeof(unsigned)*SizePartsInCellBlk;
+    SizePartsInCellBlk=0;
+    try{
+      PartsInCellBlk=new unsigned[size];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Failed CPU memory allocation of %.1f MB for multi-threaded divide.",double(sizeof(unsigned)*size)/(1024*1024)));
+    }
+    SizePartsInCellBlk=size;
+    MemAllocNct+=sizeof(unsigned)*SizePartsInCellBlk;
+  }
+}
+
 //==============================================================================
 /// Define simulation domain to use.
 /// Define el dominio de simulacion a usar.
@@ -349,6 +453,46 @@ void JCellDivCpu::CalcCellDomainFluid(unsigned n,unsigned pini,unsigned n2,unsig
   //:Log->Printf("CalcDomainFluid> cell:(%s)-(%s)",fun::Uint3Str(cellmin).c_str(),fun::Uint3Str(cellmax).c_str());
 }
 
+//==============================================================================
+/// Updates the position of selected particles (ridp[]) according to the last 
+/// sort of particles. The new position of each particle is searched with a 
+/// binary search in the range of its cell in SortPart[], since particles of 
+/// each cell keep the order of their previous positions. 
+/// Positions out of [pini,pfin) are set as UINT_MAX.
+///
+/// Actualiza la posicion de particulas seleccionadas (ridp[]) segun la ultima
+/// ordenacion de particulas. La nueva posicion de cada particula se busca con 
+/// busqueda binaria en el rango de su celda en SortPart[], ya que las 
+/// particulas de cada celda mantienen el orden de sus posiciones previas.
+/// Las posiciones fuera de [pini,pfin) se marcan como UINT_MAX.
+//==============================================================================
+void JCellDivCpu::SortRidp(unsigned n,unsigned pini,unsigned pfin,unsigned *ridp)const{
+  const unsigned sortini=GetSortIni();
+  const int nsel=int(n);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nsel>OMP_LIMIT_COMPUTEMEDIUM)
+  #endif
+  for(int c=0;c<nsel;c++){
+    unsigned p=ridp[c];
+    if(p!=UINT_MAX && p>=sortini){
+      unsigned pnew=UINT_MAX;
+      if(p<Nptot){
+        const unsigned box=CellPart[p];
+        const unsigned qfin=BeginCell[box+1];
+        unsigned q1=BeginCell[box],q2=qfin;
+        while(q1<q2){
+          const unsigned qm=(q1+q2)>>1;
+          if(SortPart[qm]<p)q1=qm+1;
+          else q2=qm;
+        }
+        if(q1<qfin && SortPart[q1]==p)pnew=q1;
+      }
+      p=pnew;
+    }
+    ridp[c]=(p>=pini && p<pfin? p: UINT_MAX);
+  }
+}
+
 //==============================================================================
 /// Reorder values of all particles (for type word).
 /// Reordena datos de todas las particulas (para tipo word).
@@ -447,6 +591,132 @@ void JCellDivCpu::SortArray(tsymatrix3f *vec){
   memcpy(vec+ini,VSortSymmatrix3f+ini,sizeof(tsymatrix3f)*(n-ini));
 }
 
+//==============================================================================
+/// Reorder values of particles in the range [pini,pfin) into vec2.
+/// Reordena datos de particulas en el rango [pini,pfin) en vec2.
+//==============================================================================
+template<class T> static void SortArrayBlock(const unsigned *sortpart,int pini,int pfin
+  ,const void *vec,void *vec2)
+{
+  const T *v=(const T*)vec;
+  T *v2=(T*)vec2;
+  for(int p=pini;p<pfin;p++)v2[p]=v[sortpart[p]];
+}
+
+//==============================================================================
+/// Reorder values of particles in the range [pini,pfin) into vec2 according
+/// to the size of array elements.
+/// Reordena datos de particulas en el rango [pini,pfin) en vec2 segun el 
+/// tamanho de los elementos del array.
+//==============================================================================
+static void SortArrayBlockSize(unsigned size,const unsigned *sortpart,int pini,int pfin
+  ,const void *vec,void *vec2)
+{
+  switch(size){
+    case 1:  SortArrayBlock<byte>       (sortpart,pini,pfin,vec,vec2);  break;
+    case 2:  SortArrayBlock<word>       (sortpart,pini,pfin,vec,vec2);  break;
+    case 4:  SortArrayBlock<unsigned>   (sortpart,pini,pfin,vec,vec2);  break;
+    case 8:  SortArrayBlock<double>     (sortpart,pini,pfin,vec,vec2);  break;
+    case 12: SortArrayBlock<tfloat3>    (sortpart,pini,pfin,vec,vec2);  break;
+    case 16: SortArrayBlock<tfloat4>    (sortpart,pini,pfin,vec,vec2);  break;
+    case 24: SortArrayBlock<tdouble3>   (sortpart,pini,pfin,vec,vec2);  break;
+    default:{
+      const byte *v=(const byte*)vec;
+      byte *v2=(byte*)vec2;
+      for(int p=pini;p<pfin;p++)memcpy(v2+size_t(size)*p,v+size_t(size)*sortpart[p],size);
+    }
+  }
+}
+
+//==============================================================================
+/// Reorder values of all particles of array with elements of size bytes using
+/// VSort (the array must not be larger than tdouble3).
+/// Reordena datos de todas las particulas de un array con elementos de size 
+/// bytes usando VSort (el array no debe ser mayor que tdouble3).
+//==============================================================================
+void JCellDivCpu::SortArrayInPlace(void *vec,unsigned size){
+  if(size>sizeof(tdouble3))Run_Exceptioon("Size of array element is invalid for reordering.");
+  const int n=int(Nptot);
+  const int ini=(DivideFull? 0: int(NpbFinal));
+  const int nblock=(n-ini+SORTARRAYS_BLOCK-1)/SORTARRAYS_BLOCK;
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int cb=0;cb<nblock;cb++){
+    const int pini=ini+cb*SORTARRAYS_BLOCK;
+    const int pfin=min(n,pini+SORTARRAYS_BLOCK);
+    SortArrayBlockSize(size,SortPart,pini,pfin,vec,VSort);
+  }
+  memcpy((byte*)vec+size_t(size)*ini,VSort+size_t(size)*ini,size_t(size)*(n-ini));
+}
+
+//==============================================================================
+/// Reorder values of all particles for several arrays walking SortPart[] once
+/// in blocks of particles. Each array is gathered into its partner buffer 
+/// vecs2[c], but when vecs2[c] is NULL the array is sorted in place using VSort.
+/// Particles not reordered (boundary when DivideFull is false) are copied to 
+/// the partner buffers.
+/// With press, the pressure of all particles is computed from the array 
+/// arrays[cvelrhop] (velrhop) in the same blocks while it is sorted.
+///
+/// Reordena datos de todas las particulas de varios arrays recorriendo 
+/// SortPart[] una vez en bloques de particulas. Cada array se recoge en su 
+/// buffer pareja vecs2[c], pero cuando vecs2[c] es NULL el array se ordena en 
+/// el mismo usando VSort. Las particulas no reordenadas (contorno cuando 
+/// DivideFull es false) se copian en los buffers pareja.
+/// Con press, se calcula la presion de todas las particulas a partir del array
+/// arrays[cvelrhop] (velrhop) en los mismos bloques mientras se ordena.
+//==============================================================================
+void JCellDivCpu::SortArrays(unsigned narrays,const StSortArrayCpu *arrays,void *const *vecs2
+  ,int cvelrhop,const StCteSph *csp,float *press)
+{
+  const int n=int(Nptot);
+  const int ini=(DivideFull? 0: int(NpbFinal));
+  if(press && (cvelrhop<0 || cvelrhop>=int(narrays) || arrays[cvelrhop].size!=sizeof(tfloat4) || !csp))
+    Run_Exceptioon("Velrhop array for pressure computation is invalid.");
+  //-Pressure is computed with the fused reorder when velrhop has partner buffer.
+  const tfloat4 *velrhop2=(press? (const tfloat4*)vecs2[cvelrhop]: NULL);
+  //-Pressure of particles not reordered. | Presion de particulas no reordenadas.
+  if(press && ini){
+    const tfloat4 *velrhop=(const tfloat4*)*arrays[cvelrhop].ptr;
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(ini>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=0;p<ini;p++)press[p]=fsph::ComputePress(velrhop[p].w,*csp);
+  }
+  unsigned nfused=0;
+  for(unsigned c=0;c<narrays;c++)if(vecs2[c]){
+    if(ini)memcpy(vecs2[c],*arrays[c].ptr,size_t(arrays[c].size)*ini);
+    nfused++;
+  }
+  //-Fused reorder of arrays with partner buffer. | Reordenacion conjunta de arrays con buffer pareja.
+  if(nfused){
+    const int nblock=(n-ini+SORTARRAYS_BLOCK-1)/SORTARRAYS_BLOCK;
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int cb=0;cb<nblock;cb++){
+      const int pini=ini+cb*SORTARRAYS_BLOCK;
+      const int pfin=min(n,pini+SORTARRAYS_BLOCK);
+      for(unsigned c=0;c<narrays;c++)if(vecs2[c]){
+        SortArrayBlockSize(arrays[c].size,SortPart,pini,pfin,*arrays[c].ptr,vecs2[c]);
+      }
+      //-Pressure from the block of velrhop just reordered. | Presion a partir del bloque de velrhop recien reordenado.
+      if(velrhop2)for(int p=pini;p<pfin;p++)press[p]=fsph::ComputePress(velrhop2[p].w,*csp);
+    }
+  }
+  //-Reorder of arrays without partner buffer. | Reordenacion de arrays sin buffer pareja.
+  for(unsigned c=0;c<narrays;c++)if(!vecs2[c])SortArrayInPlace(*arrays[c].ptr,arrays[c].size);
+  //-Pressure of velrhop sorted in place. | Presion de velrhop ordenado en el mismo array.
+  if(press && !velrhop2){
+    const tfloat4 *velrhop=(const tfloat4*)*arrays[cvelrhop].ptr;
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=ini;p<n;p++)press[p]=fsph::ComputePress(velrhop[p].w,*csp);
+  }
+}
+
 //==============================================================================
 /// Return current limites of domain.
 /// Devuelve limites actuales del dominio.
@@ -467,7 +737,7 @@ tdouble3 JCellDivCpu::GetDomainLimits(bool limitmin,unsigned slicecellmin)const{
 /// Devuelve datis de division en celdas para busqueda de vecinos.
 //==============================================================================
 StDivDataCpu JCellDivCpu::GetCellDivData()const{
-  return(MakeDivDataCpu(ScellDiv,GetNcells(),GetCellDomainMin(),GetBeginCell()
+  return(MakeDivDataCpu(ScellDiv,GetNcells(),GetCellDomainMin(),GetBeginCell(),RowCell
     ,Scell,DomCellCode,DomPosMin));
 }
 
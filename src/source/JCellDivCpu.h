@@ -34,6 +34,8 @@
 
 //#define DBG_JCellDivCpu 1 //:DEL:
 
+#define SORTARRAYS_BLOCK 2048  ///<Number of particles in each block of fused reorder.
+
 //##############################################################################
 //# JCellDivCpu
 //##############################################################################
@@ -46,6 +48,7 @@ protected:
   const bool Floating;
   const byte PeriActive;
   const TpCellMode CellMode;  ///<Cell division mode.
+  const TpCellOrder CellOrder;  ///<Ordering of cell rows (y,z) for particle sort.
   const int ScellDiv;         ///<Value to divide KernelSize (1 or 2).
   const float Scell;          ///<Cell size: KernelSize/ScellDiv (KernelSize or KernelSize/2).
   const float OvScell;        ///<OvScell=1/Scell
@@ -68,7 +71,7 @@ protected:
   //-Variables with allocated memory as a function of the number of particles in CPU.
   //-Memoria reservada en funcion de particulas en CPU.
   unsigned SizeNp;
-  unsigned *CellPart;
+  unsigned *CellPart;    ///<Box of each particle according to its position before the last sort (used by SortRidp()). | Caja de cada particula segun su posicion antes de la ultima ordenacion.
   unsigned *SortPart;
 
   unsigned IncreaseNp; ///<Possible number of particles to be created in the near future.
@@ -79,6 +82,8 @@ protected:
   unsigned *PartsInCell;
   unsigned *BeginCell;   ///<Get first value of each cell. | Contiene el principio de cada celda. 
   // BeginCell=[BoundOk(nct),BoundIgnore(1),Fluid(nct),BoundOut(1),FluidOut(1),BoundOutIgnore(1),FluidOutIgnore(1),END)]
+  ullong SizePartsInCellBlk;
+  unsigned *PartsInCellBlk; ///<Particles per cell for each block of particles in multi-threaded divide. | Particulas por celda para cada bloque de particulas en el divide multihilo. [nblock*(Nctt-1)]
 
   //-Variables to reorder particles. | Variables para reordenar particulas.
   byte        *VSort;            ///<Memory to reorder particles. | Memoria para reordenar particulas. [sizeof(tdouble3)*Np]
@@ -93,6 +98,12 @@ protected:
   llong MemAllocNp;  ///<Memory reserved for particles. | Mermoria reservada para particulas.
   llong MemAllocNct; ///<Memory reserved for cells. | Mermoria reservada para celdas.
 
+  //-Variables for ordering of cell rows according to a space-filling curve.
+  //-Variables para ordenar filas de celdas segun una curva de llenado del espacio.
+  unsigned SizeRowCell;
+  unsigned *RowCell;     ///<First cell of each row (y,z) (NULL for linear order). | Primera celda de cada fila (y,z). [Ncy*Ncz]
+  tuint3 RowCellNc;      ///<Number of cells used to compute RowCell[]. | Numero de celdas usado para calcular RowCell[].
+
   unsigned Ndiv,NdivFull;
 
   //-Number of particles by type to initialise in divide.
@@ -137,11 +148,19 @@ protected:
   void AllocMemoryNct(ullong nct);
   void CheckMemoryNp(unsigned npmin);
   void CheckMemoryNct(unsigned nctmin);
+  void CheckMemoryPartsInCellBlk(ullong size);
+  void PrepareRowCell();
+
+  /// Returns sort position of cell (cx,cy,cz) inside the domain.
+  /// Devuelve la posicion de ordenacion de la celda (cx,cy,cz) dentro del dominio.
+  inline unsigned CellSort(unsigned cx,unsigned cy,unsigned cz)const{ 
+    return(RowCell? cx+RowCell[cy+cz*Ncy]: cx+cy*Ncx+cz*Nsheet);
+  }
 
   ullong SizeBeginCell(ullong nct)const{ return((nct*2)+5+1); } //-[BoundOk(nct),BoundIgnore(1),Fluid(nct),BoundOut(1),FluidOut(1),BoundOutIgnore(1),FluidOutIgnore(1),END(1)]
 
   ullong GetAllocMemoryNp()const{ return(MemAllocNp); };
-  ullong GetAllocMemoryNct()const{ return(MemAllocNct); };
+  ullong GetAllocMemoryNct()const{ return(MemAllocNct+sizeof(unsigned)*SizeRowCell); };
   ullong GetAllocMemory()const{ return(GetAllocMemoryNp()+GetAllocMemoryNct()); };
 
   //tuint3 GetMapCell(const tfloat3 &pos)const;
@@ -152,9 +171,11 @@ protected:
 
   unsigned CellSize(unsigned box)const{ return(BeginCell[box+1]-BeginCell[box]); }
 
+  void SortArrayInPlace(void *vec,unsigned size);
+
 public:
   JCellDivCpu(bool stable,bool floating,byte periactive
-    ,bool celldomfixed,TpCellMode cellmode,float scell
+    ,bool celldomfixed,TpCellMode cellmode,TpCellOrder cellorder,float scell
     ,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells
     ,unsigned casenbound,unsigned casenfixed,unsigned casenpb,std::string dirout
     ,bool allocfullnct=true,float overmemorynp=CELLDIV_OVERMEMORYNP,word overmemorycells=CELLDIV_OVERMEMORYCELLS);
@@ -170,7 +191,12 @@ public:
   void SortArray(tfloat4 *vec);
   void SortArray(tsymatrix3f *vec);
 
+  bool GetSortSwapUseful()const{ return(DivideFull || NpbFinal<=Nptot-NpbFinal); } ///<Sorting into a partner buffer moves less data than SortArray(vec).
+  void SortArrays(unsigned narrays,const StSortArrayCpu *arrays,void *const *vecs2
+    ,int cvelrhop=-1,const StCteSph *csp=NULL,float *press=NULL);
+
   TpCellMode GetCellMode()const{ return(CellMode); }
+  TpCellOrder GetCellOrder()const{ return(CellOrder); }
   int GetScellDiv()const{ return(ScellDiv); }
   float GetScell()const{ return(Scell); }
 
@@ -195,6 +221,10 @@ public:
   unsigned GetNpbOutIgnore()const{ return(NpbOutIgnore); }
   unsigned GetNpfOutIgnore()const{ return(NpfOutIgnore); }
 
+  const unsigned* GetSortPart()const{ return(SortPart); }
+  unsigned GetSortIni()const{ return(DivideFull? 0: NpbFinal); } ///<First particle reordered by SortArray().
+  void SortRidp(unsigned n,unsigned pini,unsigned pfin,unsigned *ridp)const;
+
   //:const unsigned* GetCellPart()const{ return(CellPart); }
   const unsigned* GetBeginCell()const{ return(BeginCell); }
 
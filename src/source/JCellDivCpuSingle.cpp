@@ -22,6 +22,8 @@
 #include "JDsTimersCpu.h"
 #include "Functions.h"
 #include <climits>
+#include <vector>
+#include <algorithm>
 
 using namespace std;
 
@@ -29,10 +31,10 @@ using namespace std;
 /// Constructor.
 //==============================================================================
 JCellDivCpuSingle::JCellDivCpuSingle(bool stable,bool floating,byte periactive
-  ,bool celldomfixed,TpCellMode cellmode,float scell
+  ,bool celldomfixed,TpCellMode cellmode,TpCellOrder cellorder,float scell
   ,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells
   ,unsigned casenbound,unsigned casenfixed,unsigned casenpb,std::string dirout)
-  :JCellDivCpu(stable,floating,periactive,celldomfixed,cellmode,scell
+  :JCellDivCpu(stable,floating,periactive,celldomfixed,cellmode,cellorder,scell
   ,mapposmin,mapposmax,mapcells,casenbound,casenfixed,casenpb,dirout)
 {
   ClassName="JCellDivCpuSingle";
@@ -116,10 +118,56 @@ void JCellDivCpuSingle::PrepareNct(){
   BoxFluidOut=BoxBoundOut+1; 
   BoxBoundOutIgnore=BoxFluidOut+1;
   BoxFluidOutIgnore=BoxBoundOutIgnore+1;
+  //-Computes ordering of cell rows. | Calcula ordenacion de filas de celdas.
+  PrepareRowCell();
   //:Log->Printf("--->PrepareNct> BoxIgnore:%u BoxFluid:%u BoxBoundOut:%u BoxFluidOut:%u",BoxIgnore,BoxFluid,BoxBoundOut,BoxFluidOut);
   //:Log->Printf("--->PrepareNct> BoxBoundOutIgnore:%u BoxFluidOutIgnore:%u",BoxBoundOutIgnore,BoxFluidOutIgnore);
 }
 
+//==============================================================================
+/// Returns box of boundary or fluid particle starting from its cell in the map 
+/// and its code (used when the divide is applied to all particles).
+/// Excluded particles bound (fixed and moving) and floating are moved to BoxBoundOut.
+///
+/// Devuelve la caja de una particula bound o fluid a partir de su celda en el 
+/// mapa y su code (usado cuando el divide se aplica a todas las particulas).
+/// Las particulas excluidas de tipo bound (fixed and moving) and floating se mueven a BoxBoundOut.
+//==============================================================================
+inline unsigned JCellDivCpuSingle::GetBoxFull(unsigned rcell,typecode rcode)const{
+  //-Computes cell according position.
+  const unsigned cx=DCEL_Cellx(DomCellCode,rcell)-CellDomainMin.x;
+  const unsigned cy=DCEL_Celly(DomCellCode,rcell)-CellDomainMin.y;
+  const unsigned cz=DCEL_Cellz(DomCellCode,rcell)-CellDomainMin.z;
+  //-Checks particle code.
+  const typecode codetype=CODE_GetType(rcode);
+  const typecode codeout=CODE_GetSpecialValue(rcode);
+  //-Assigns box.
+  if(codetype<CODE_TYPE_FLOATING){//-Bound particles (except floating) | Particulas bound (excepto floating).
+    return(codeout<CODE_OUTIGNORE?   ((cx<Ncx && cy<Ncy && cz<Ncz)? CellSort(cx,cy,cz): BoxBoundIgnore):   (codeout==CODE_OUTIGNORE? BoxBoundOutIgnore: BoxBoundOut));
+  }
+  //-Fluid and floating particles | Particulas fluid y floating.
+  return(codeout<=CODE_OUTIGNORE?   (codeout<CODE_OUTIGNORE? BoxFluid+CellSort(cx,cy,cz): BoxFluidOutIgnore):   (codetype==CODE_TYPE_FLOATING? BoxBoundOut: BoxFluidOut));
+}
+
+//==============================================================================
+/// Returns box of fluid particle starting from its cell in the map and its code.
+/// Excluded particles floating are moved to BoxBoundOut.
+///
+/// Devuelve la caja de una particula fluid a partir de su celda en el mapa y su code.
+/// Las particulas excluidas de tipo floating se mueven a BoxBoundOut.
+//==============================================================================
+inline unsigned JCellDivCpuSingle::GetBoxFluid(unsigned rcell,typecode rcode)const{
+  //-Computes cell according position.
+  const unsigned cx=DCEL_Cellx(DomCellCode,rcell)-CellDomainMin.x;
+  const unsigned cy=DCEL_Celly(DomCellCode,rcell)-CellDomainMin.y;
+  const unsigned cz=DCEL_Cellz(DomCellCode,rcell)-CellDomainMin.z;
+  //-Checks particle code.
+  const typecode codetype=CODE_GetType(rcode);
+  const typecode codeout=CODE_GetSpecialValue(rcode);
+  //-Assigns box.
+  return(codeout<=CODE_OUTIGNORE?   (codeout<CODE_OUTIGNORE? BoxFluid+CellSort(cx,cy,cz): BoxFluidOutIgnore):   (codetype==CODE_TYPE_FLOATING? BoxBoundOut: BoxFluidOut));
+}
+
 //==============================================================================
 /// Computes cell of each boundary and fluid particle (cellpart[]) starting from its cell in 
 /// the map. all the excluded particles were already marked in code[].
@@ -136,24 +184,7 @@ void JCellDivCpuSingle::PreSortFull(unsigned np,const unsigned *dcellc,const typ
 {
   memset(partsincell,0,sizeof(unsigned)*(Nctt-1));
   for(unsigned p=0;p<np;p++){
-    //-Computes cell according position.
-    const unsigned rcell=dcellc[p];
-    const unsigned cx=DCEL_Cellx(DomCellCode,rcell)-CellDomainMin.x;
-    const unsigned cy=DCEL_Celly(DomCellCode,rcell)-CellDomainMin.y;
-    const unsigned cz=DCEL_Cellz(DomCellCode,rcell)-CellDomainMin.z;
-    const unsigned cellsort=cx+cy*Ncx+cz*Nsheet;
-    //-Checks particle code.
-    const typecode rcode=codec[p];
-    const typecode codetype=CODE_GetType(rcode);
-    const typecode codeout=CODE_GetSpecialValue(rcode);
-    //-Assigns box.
-    unsigned box;
-    if(codetype<CODE_TYPE_FLOATING){//-Bound particles (except floating) | Particulas bound (excepto floating).
-      box=(codeout<CODE_OUTIGNORE?   ((cx<Ncx && cy<Ncy && cz<Ncz)? cellsort: BoxBoundIgnore):   (codeout==CODE_OUTIGNORE? BoxBoundOutIgnore: BoxBoundOut));
-    }
-    else{//-Fluid and floating particles | Particulas fluid y floating.
-      box=(codeout<=CODE_OUTIGNORE?   (codeout<CODE_OUTIGNORE? BoxFluid+cellsort: BoxFluidOutIgnore):   (codetype==CODE_TYPE_FLOATING? BoxBoundOut: BoxFluidOut));
-    }
+    const unsigned box=GetBoxFull(dcellc[p],codec[p]);
     cellpart[p]=box;
     partsincell[box]++;
   }
@@ -176,18 +207,7 @@ void JCellDivCpuSingle::PreSortFluid(unsigned np,unsigned pini,const unsigned *d
   memset(partsincell+BoxFluid,0,sizeof(unsigned)*(Nctt-1-BoxFluid));
   const unsigned pfin=pini+np;
   for(unsigned p=pini;p<pfin;p++){
-    //-Computes cell according position.
-    const unsigned rcell=dcellc[p];
-    const unsigned cx=DCEL_Cellx(DomCellCode,rcell)-CellDomainMin.x;
-    const unsigned cy=DCEL_Celly(DomCellCode,rcell)-CellDomainMin.y;
-    const unsigned cz=DCEL_Cellz(DomCellCode,rcell)-CellDomainMin.z;
-    const unsigned cellsortfluid=BoxFluid+cx+cy*Ncx+cz*Nsheet;
-    //-Checks particle code.
-    const typecode rcode=codec[p];
-    const typecode codetype=CODE_GetType(rcode);
-    const typecode codeout=CODE_GetSpecialValue(rcode);
-    //-Assigns box.
-    const unsigned box=(codeout<=CODE_OUTIGNORE?   (codeout<CODE_OUTIGNORE? cellsortfluid: BoxFluidOutIgnore):   (codetype==CODE_TYPE_FLOATING? BoxBoundOut: BoxFluidOut));
+    const unsigned box=GetBoxFluid(dcellc[p],codec[p]);
     cellpart[p]=box;
     partsincell[box]++;
   }
@@ -233,6 +253,129 @@ void JCellDivCpuSingle::MakeSortFluid(unsigned np,unsigned pini,const unsigned*
   }
 }
 
+//==============================================================================
+/// Returns number of blocks of particles for the multi-threaded divide or 1 
+/// when the serial version must be used. Each block needs its own counters for
+/// all cells, so the number of blocks is limited by memory (2 counters per particle).
+///
+/// Devuelve el numero de bloques de particulas para el divide multihilo o 1 
+/// cuando se debe usar la version serie. Cada bloque necesita sus contadores para
+/// todas las celdas, por lo que el numero de bloques se limita por memoria.
+//==============================================================================
+unsigned JCellDivCpuSingle::GetSortBlocks(unsigned np,unsigned nbox)const{
+  unsigned nblock=1;
+  #ifdef OMP_USE
+  if(np>=OMP_LIMIT_CELLDIVSORT && nbox){
+    const unsigned nth=unsigned(omp_get_max_threads());
+    const ullong nblockmem=(ullong(np)*2)/nbox;
+    nblock=unsigned(min(ullong(nth),nblockmem));
+    if(nblock<2)nblock=1;
+  }
+  #endif
+  return(nblock);
+}
+
+//==============================================================================
+/// Multi-threaded version of PreSortFull()+MakeSortFull() or PreSortFluid()+
+/// MakeSortFluid() using counting sort. Particles are split in nblock ranges 
+/// with their own counters per cell, so the order of particles in each cell 
+/// is the same as the serial version.
+///
+/// Version multihilo de PreSortFull()+MakeSortFull() o PreSortFluid()+
+/// MakeSortFluid() usando counting sort. Las particulas se reparten en nblock 
+/// rangos con sus propios contadores por celda, por lo que el orden de las 
+/// particulas en cada celda es el mismo que en la version serie.
+//==============================================================================
+void JCellDivCpuSingle::PreSortOmp(bool full,unsigned np,unsigned pini,unsigned nblock
+  ,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* begincell
+  ,unsigned* partsincell,unsigned* sortpart)
+{
+  const unsigned boxini=(full? 0: BoxFluid);
+  const unsigned nbox=unsigned(Nctt-1)-boxini;
+  CheckMemoryPartsInCellBlk(ullong(nbox)*nblock);
+  unsigned *partsblk=PartsInCellBlk;
+  const int nblk=int(nblock);
+  //-Computes box of each particle and counts particles per box in each block.
+  //-Calcula caja de cada particula y cuenta particulas por caja en cada bloque.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int cb=0;cb<nblk;cb++){
+    unsigned *cnt=partsblk+ullong(nbox)*cb;
+    memset(cnt,0,sizeof(unsigned)*nbox);
+    const unsigned p1=pini+unsigned((ullong(np)*cb)/nblock);
+    const unsigned p2=pini+unsigned((ullong(np)*(cb+1))/nblock);
+    if(full)for(unsigned p=p1;p<p2;p++){
+      const unsigned box=GetBoxFull(dcellc[p],codec[p]);
+      cellpart[p]=box;
+      cnt[box]++;
+    }
+    else for(unsigned p=p1;p<p2;p++){
+      const unsigned box=GetBoxFluid(dcellc[p],codec[p]);
+      cellpart[p]=box;
+      cnt[box-boxini]++;
+    }
+  }
+  //-Computes total of particles per box and initial position of each block in the box.
+  //-Calcula total de particulas por caja y posicion inicial de cada bloque en la caja.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static)
+  #endif
+  for(int box=0;box<int(nbox);box++){
+    unsigned tot=0;
+    for(int cb=0;cb<nblk;cb++){
+      unsigned &v=partsblk[ullong(nbox)*cb+box];
+      const unsigned n=v;
+      v=tot;
+      tot+=n;
+    }
+    partsincell[boxini+box]=tot;
+  }
+  //-Adjust initial position of cells using a prefix sum by segments.
+  //-Ajusta posiciones iniciales de celdas usando una suma prefija por segmentos.
+  {
+    const int nseg=nblk;
+    std::vector<unsigned> segsum(nseg+1,0);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static,1)
+    #endif
+    for(int cs=0;cs<nseg;cs++){
+      const unsigned b1=unsigned((ullong(nbox)*cs)/nseg);
+      const unsigned b2=unsigned((ullong(nbox)*(cs+1))/nseg);
+      unsigned sum=0;
+      for(unsigned box=b1;box<b2;box++)sum+=partsincell[boxini+box];
+      segsum[cs+1]=sum;
+    }
+    segsum[0]=begincell[boxini];
+    for(int cs=0;cs<nseg;cs++)segsum[cs+1]+=segsum[cs];
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static,1)
+    #endif
+    for(int cs=0;cs<nseg;cs++){
+      const unsigned b1=unsigned((ullong(nbox)*cs)/nseg);
+      const unsigned b2=unsigned((ullong(nbox)*(cs+1))/nseg);
+      unsigned v=segsum[cs];
+      for(unsigned box=b1;box<b2;box++){
+        v+=partsincell[boxini+box];
+        begincell[boxini+box+1]=v;
+      }
+    }
+  }
+  //-Put particles in their boxes | Coloca las particulas en sus cajas.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int cb=0;cb<nblk;cb++){
+    unsigned *cnt=partsblk+ullong(nbox)*cb;
+    const unsigned p1=pini+unsigned((ullong(np)*cb)/nblock);
+    const unsigned p2=pini+unsigned((ullong(np)*(cb+1))/nblock);
+    for(unsigned p=p1;p<p2;p++){
+      const unsigned box=cellpart[p];
+      sortpart[begincell[box]+(cnt[box-boxini]++)]=p;
+    }
+  }
+}
+
 //==============================================================================
 /// Computes cell of each particle (CellPart[]) from dcell[], all the excluded 
 /// particles have been marked  in code[].
@@ -242,20 +385,34 @@ void JCellDivCpuSingle::MakeSortFluid(unsigned np,unsigned pini,const unsigned*
 /// particulas excluidas ya fueron marcadas en code[].
 /// Calcula SortPart[] (donde esta la particula que deberia ir en dicha posicion).
 //==============================================================================
-void JCellDivCpuSingle::PreSort(const unsigned* dcellc,const typecode *codec){
+void JCellDivCpuSingle::PreSort(const unsigned* dcellc,const typecode *codec,JDsTimersCpu *timersc){
   //-Load SortPart[] with the current particle in the data vectors where the particle is that must go in stated position.
   //-Load BeginCell[] with first particle of each cell.
   //-Carga SortPart[] con la p actual en los vectores de datos donde esta la particula que deberia ir en dicha posicion.
   //-Carga BeginCell[] con primera particula de cada celda.
+  timersc->TmStart(TMC_NlPreSort);
   if(DivideFull){
-    PreSortFull(Nptot,dcellc,codec,CellPart,PartsInCell);
-    MakeSortFull(CellPart,BeginCell,PartsInCell,SortPart);
+    const unsigned nblock=GetSortBlocks(Nptot,unsigned(Nctt-1));
+    if(nblock>1){
+      BeginCell[0]=0;
+      PreSortOmp(true,Nptot,0,nblock,dcellc,codec,CellPart,BeginCell,PartsInCell,SortPart);
+    }
+    else{
+      PreSortFull(Nptot,dcellc,codec,CellPart,PartsInCell);
+      MakeSortFull(CellPart,BeginCell,PartsInCell,SortPart);
+    }
   }
   else{
-    PreSortFluid(Npf1,Npb1,dcellc,codec,CellPart,PartsInCell);
-    MakeSortFluid(Npf1,Npb1,CellPart,BeginCell,PartsInCell,SortPart);
+    const unsigned nblock=GetSortBlocks(Npf1,unsigned(Nctt-1)-BoxFluid);
+    if(nblock>1)PreSortOmp(false,Npf1,Npb1,nblock,dcellc,codec,CellPart,BeginCell,PartsInCell,SortPart);
+    else{
+      PreSortFluid(Npf1,Npb1,dcellc,codec,CellPart,PartsInCell);
+      MakeSortFluid(Npf1,Npb1,CellPart,BeginCell,PartsInCell,SortPart);
+    }
   }
-  SortArray(CellPart); //-Order values of CellPart[] | Ordena valores de CellPart[].
+  timersc->TmStop(TMC_NlPreSort);
+  //-CellPart[] is not reordered since it is used to locate particles after sorting (see SortRidp()).
+  //-CellPart[] no se reordena porque se usa para localizar particulas despues de ordenar (ver SortRidp()).
 }
 
 //==============================================================================
@@ -324,7 +481,7 @@ void JCellDivCpuSingle::Divide(unsigned npb1,unsigned npf1
   //-Computes CellPart[] and SortPart[] (where the particle is that must go in stated position).
   //-Calcula CellPart[] y SortPart[] (donde esta la particula que deberia ir en dicha posicion).
   timersc->TmStart(TMC_NlMakeSort);
-  PreSort(dcellc,codec);
+  PreSort(dcellc,codec,timersc);
 
   //-Calculate number of particles. | Calcula numeros de particulas.
   NpbIgnore=CellSize(BoxBoundIgnore);
@@ -37,15 +37,21 @@ protected:
   void MergeMapCellBoundFluid(const tuint3 &celbmin,const tuint3 &celbmax,const tuint3 &celfmin,const tuint3 &celfmax,tuint3 &celmin,tuint3 &celmax)const;
   void PrepareNct();
 
+  inline unsigned GetBoxFull(unsigned rcell,typecode rcode)const;
+  inline unsigned GetBoxFluid(unsigned rcell,typecode rcode)const;
+
   void PreSortFull(unsigned np,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* partsincell)const;
   void PreSortFluid(unsigned np,unsigned pini,const unsigned *dcellc,const typecode *codec,unsigned* cellpart,unsigned* partsincell)const;
   void MakeSortFull(const unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart)const;
   void MakeSortFluid(unsigned np,unsigned pini,const unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart)const;
-  void PreSort(const unsigned* dcellc,const typecode *codec);
+  unsigned GetSortBlocks(unsigned np,unsigned nbox)const;
+  void PreSortOmp(bool full,unsigned np,unsigned pini,unsigned nblock,const unsigned *dcellc
+    ,const typecode *codec,unsigned* cellpart,unsigned* begincell,unsigned* partsincell,unsigned* sortpart);
+  void PreSort(const unsigned* dcellc,const typecode *codec,JDsTimersCpu *timersc);
 
 public:
   JCellDivCpuSingle(bool stable,bool floating,byte periactive
-    ,bool celldomfixed,TpCellMode cellmode,float scell
+    ,bool celldomfixed,TpCellMode cellmode,TpCellOrder cellorder,float scell
     ,tdouble3 mapposmin,tdouble3 mapposmax,tuint3 mapcells
     ,unsigned casenbound,unsigned casenfixed,unsigned casenpb,std::string dirout);
 
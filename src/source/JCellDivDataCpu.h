@@ -22,6 +22,9 @@
 #define _JCellDivDataCpu_
 
 #include "DualSphDef.h"
+#include <vector>
+#include <algorithm>
+#include <cmath>
 
 ///Structure with data of cell division for neighborhood search on GPU.
 typedef struct{
@@ -30,16 +33,23 @@ typedef struct{
   unsigned cellfluid;
   tint3 cellzero;
   const unsigned* begincell;
+  const unsigned* rowcell;  ///<First cell of each row (y,z) when rows are not in linear order (NULL for linear order).
   float scell;
   unsigned domcellcode;
   tdouble3 domposmin;
 }StDivDataCpu;
 
+///Structure with a particle array that must follow the particle sort of divide.
+typedef struct{
+  void **ptr;     ///<Address of the variable with the pointer to the array (the array is ignored when it is NULL).
+  unsigned size;  ///<Size of array element in bytes.
+}StSortArrayCpu;
+
 //==============================================================================
 ///Returns empty StDivDataCpu structure.
 //==============================================================================
 inline StDivDataCpu DivDataCpuNull(){
-  StDivDataCpu c={0,TInt4(0),0,TInt3(0),NULL,0,0,TDouble3(0)};
+  StDivDataCpu c={0,TInt4(0),0,TInt3(0),NULL,NULL,0,0,TDouble3(0)};
   return(c);
 }
 
@@ -47,7 +57,7 @@ inline StDivDataCpu DivDataCpuNull(){
 /// Returns structure with data for neighborhood search on Single-GPU.
 //==============================================================================
 inline StDivDataCpu MakeDivDataCpu(int scelldiv,const tuint3 &ncells,const tuint3 &cellmin
-  ,const unsigned* begincell,float scell,unsigned domcellcode,const tdouble3 &domposmin)
+  ,const unsigned* begincell,const unsigned* rowcell,float scell,unsigned domcellcode,const tdouble3 &domposmin)
 {
   StDivDataCpu ret;
   ret.scelldiv=scelldiv;
@@ -55,6 +65,7 @@ inline StDivDataCpu MakeDivDataCpu(int scelldiv,const tuint3 &ncells,const tuint
   ret.cellfluid=ret.nc.w*ret.nc.z+1;
   ret.cellzero=ToTInt3(cellmin);
   ret.begincell=begincell;
+  ret.rowcell=rowcell;
   ret.scell=scell;
   ret.domcellcode=domcellcode;
   ret.domposmin=domposmin;
@@ -62,6 +73,75 @@ inline StDivDataCpu MakeDivDataCpu(int scelldiv,const tuint3 &ncells,const tuint
 }
 
 
+//==============================================================================
+/// Returns the first cell of row (y,z) (without the offset of fluid cells).
+/// Devuelve la primera celda de la fila (y,z) (sin el desplazamiento de celdas fluid).
+//==============================================================================
+inline int DivDataCpuRowCell(const StDivDataCpu &dvd,int y,int z){
+  return(dvd.rowcell? int(dvd.rowcell[dvd.nc.y*z+y]): dvd.nc.w*z+dvd.nc.x*y);
+}
+
+
+//==============================================================================
+/// Computes the range of cells [cini,cfin) of one axis for the interval 
+/// [vmin,vmax] extended by ncmargin cells. Returns false when it is outside.
+/// Calcula el rango de celdas [cini,cfin) de un eje para el intervalo 
+/// [vmin,vmax] ampliado en ncmargin celdas. Devuelve false cuando esta fuera.
+//==============================================================================
+inline bool DivDataCpuAxisCells(double vmin,double vmax,double domposmin,double scell
+  ,int cellzero,int nc,int ncmargin,int &cini,int &cfin)
+{
+  const double c1=floor((vmin-domposmin)/scell)-cellzero-ncmargin;
+  const double c2=floor((vmax-domposmin)/scell)-cellzero+ncmargin;
+  if(!(c1<=c2) || c2<0 || c1>=nc)return(false);
+  cini=(c1<0? 0: int(c1));
+  cfin=(c2>=nc? nc: int(c2)+1);
+  return(true);
+}
+
+//==============================================================================
+/// Returns the particle ranges [x,y) of the bound or fluid cells that include 
+/// the box [pmin,pmax] extended by ncmargin cells (particles can move after 
+/// the divide). Ranges are limited to [pini,pfin), consecutive ranges are 
+/// joined and split in blocks of rmax particles to balance OpenMP threads.
+/// Returns the number of particles in the ranges.
+/// Devuelve los rangos de particulas [x,y) de las celdas bound o fluid que 
+/// incluyen la caja [pmin,pmax] ampliada en ncmargin celdas (las particulas 
+/// pueden moverse despues del divide). Los rangos se limitan a [pini,pfin), 
+/// los rangos consecutivos se unen y se dividen en bloques de rmax particulas
+/// para repartir el trabajo entre hilos OpenMP.
+/// Devuelve el numero de particulas en los rangos.
+//==============================================================================
+inline unsigned DivDataCpuBoxRanges(const StDivDataCpu &dvd,bool fluid
+  ,const tdouble3 &pmin,const tdouble3 &pmax,int ncmargin,unsigned pini,unsigned pfin
+  ,std::vector<tuint2> &ranges,unsigned rmax=4096)
+{
+  ranges.clear();
+  unsigned nsel=0;
+  const double scell=dvd.scell;
+  int cxini,cxfin,cyini,cyfin,czini,czfin;
+  if(DivDataCpuAxisCells(pmin.x,pmax.x,dvd.domposmin.x,scell,dvd.cellzero.x,dvd.nc.x,ncmargin,cxini,cxfin)
+    && DivDataCpuAxisCells(pmin.y,pmax.y,dvd.domposmin.y,scell,dvd.cellzero.y,dvd.nc.y,ncmargin,cyini,cyfin)
+    && DivDataCpuAxisCells(pmin.z,pmax.z,dvd.domposmin.z,scell,dvd.cellzero.z,dvd.nc.z,ncmargin,czini,czfin))
+  {
+    const int cellinit=(fluid? int(dvd.cellfluid): 0);
+    for(int cz=czini;cz<czfin;cz++)for(int cy=cyini;cy<cyfin;cy++){
+      const int v=DivDataCpuRowCell(dvd,cy,cz)+cellinit;
+      unsigned p1=std::max(dvd.begincell[v+cxini],pini);
+      const unsigned p2=std::min(dvd.begincell[v+cxfin],pfin);
+      while(p1<p2){
+        if(ranges.empty() || ranges.back().y!=p1 || ranges.back().y-ranges.back().x>=rmax)ranges.push_back(TUint2(p1,p1));
+        tuint2 &r=ranges.back();
+        r.y=std::min(p2,r.x+rmax);
+        nsel+=r.y-p1;
+        p1=r.y;
+      }
+    }
+  }
+  return(nsel);
+}
+
+
 ///Structure with data for neighborhood search.
 typedef struct{
   int cellinit;
@@ -71,6 +151,24 @@ typedef struct{
 }StNgSearch;
 
 
+///Structure with neighbour list for interaction on CPU (see JDsNgListCpu).
+typedef struct{
+  const unsigned* curtobuild;  ///<Build index of each particle [np].
+  const unsigned* buildtocur;  ///<Current index of each build index [np].
+  const unsigned* beginng;     ///<First neighbour of bound and fluid segments of each build index [np*2+1].
+  const unsigned* ng;          ///<Neighbours by build index [beginng[np*2]].
+  const tuint2* ovfrange;      ///<Range in ng[] of additional neighbours of bound and fluid segments of each build index [np*2].
+}StNgListCpu;
+
+//==============================================================================
+///Returns empty StNgListCpu structure (neighbour list is not used).
+//==============================================================================
+inline StNgListCpu NgListCpuNull(){
+  StNgListCpu c={NULL,NULL,NULL,NULL,NULL};
+  return(c);
+}
+
+
 #endif
 
 
@@ -22,6 +22,7 @@
 #define _JCellSearch_inline_
 
 #include "JCellDivDataCpu.h"
+#include <cstring>
 
 /// Implements inline functions for neighborhood search on CPU.
 namespace nsearch{
@@ -68,12 +69,56 @@ inline StNgSearch Init(const tdouble3 &pos,bool boundp2,const StDivDataCpu &dvd)
   return(ret);
 }
 
+//==============================================================================
+/// Return initial data for neighborhood search according to cell number of 
+/// particle using ncdiv cells in each direction (ncdiv>=scelldiv).
+/// Devuelve datos iniciales para busqueda de vecinos segun numero de celda de 
+/// particula usando ncdiv celdas en cada direccion (ncdiv>=scelldiv).
+//==============================================================================
+inline StNgSearch InitDiv(unsigned rcell,bool boundp2,int ncdiv,const StDivDataCpu &dvd){
+  //-Get cell coordinates of cell number.
+  const int cx=DCEL_Cellx(dvd.domcellcode,rcell)-dvd.cellzero.x;
+  const int cy=DCEL_Celly(dvd.domcellcode,rcell)-dvd.cellzero.y;
+  const int cz=DCEL_Cellz(dvd.domcellcode,rcell)-dvd.cellzero.z;
+  StNgSearch ret;
+  ret.cellinit=(boundp2? 0: dvd.cellfluid);
+  ret.cxini=cx-(cx<ncdiv? cx: ncdiv);
+  ret.cxfin=cx+(dvd.nc.x-cx-1<ncdiv? dvd.nc.x-cx-1: ncdiv)+1;
+  ret.yini=cy-(cy<ncdiv? cy: ncdiv);
+  ret.yfin=cy+(dvd.nc.y-cy-1<ncdiv? dvd.nc.y-cy-1: ncdiv)+1;
+  ret.zini=cz-(cz<ncdiv? cz: ncdiv);
+  ret.zfin=cz+(dvd.nc.z-cz-1<ncdiv? dvd.nc.z-cz-1: ncdiv)+1;
+  return(ret);
+}
+
+//==============================================================================
+/// Return data for neighborhood search using neighbour list (two ranges: list
+/// and additional neighbours).
+/// Devuelve datos para busqueda de vecinos usando lista de vecinos (dos rangos:
+/// lista y vecinos adicionales).
+//==============================================================================
+inline StNgSearch InitNgList(){
+  StNgSearch ret={0,0,0,0,2,0,1};
+  return(ret);
+}
+
+//==============================================================================
+/// Returns range y (0:list, 1:additional neighbours) of neighbour list of 
+/// particle p1. Neighbour particle is obtained with ngl.buildtocur[ngl.ng[cp2]].
+/// Devuelve rango y (0:lista, 1:vecinos adicionales) de la lista de vecinos de
+/// la particula p1.
+//==============================================================================
+inline tuint2 ParticleRangeNgList(int y,unsigned p1,bool boundp2,const StNgListCpu &ngl){
+  const unsigned r=ngl.curtobuild[p1]*2+(boundp2? 0: 1);
+  return(y? ngl.ovfrange[r]: TUint2(ngl.beginng[r],ngl.beginng[r+1]));
+}
+
 //==============================================================================
 /// Returns range of particles for neighborhood search.
 /// Devuelve rango de particulas para busqueda de vecinos.
 //==============================================================================
 inline tuint2 ParticleRange(int y,int z,const StNgSearch &ngs,const StDivDataCpu &dvd){
-  const int v=dvd.nc.w*z + dvd.nc.x*y + ngs.cellinit;
+  const int v=DivDataCpuRowCell(dvd,y,z) + ngs.cellinit;
   const unsigned pini=dvd.begincell[v+ngs.cxini];
   const unsigned pfin=dvd.begincell[v+ngs.cxfin];
   return(TUint2(pini,pfin));
@@ -91,6 +136,48 @@ inline tfloat4 Distances(const tdouble3 &pos1,const tdouble3 &pos2){
   return(dr);
 }
 
+//==============================================================================
+/// Returns position of particle relative to the origin of its cell dcell 
+/// (PosCell) with the cell code stored in w.
+/// Devuelve la posicion de la particula relativa al origen de su celda dcell
+/// (PosCell) con el codigo de celda almacenado en w.
+//==============================================================================
+inline tfloat4 PosCellCalc(const tdouble3 &pos,unsigned dcell,const StDivDataCpu &dvd){
+  const double scell=dvd.scell;
+  tfloat4 ret;
+  ret.x=float(pos.x-dvd.domposmin.x-scell*DCEL_Cellx(dvd.domcellcode,dcell));
+  ret.y=float(pos.y-dvd.domposmin.y-scell*DCEL_Celly(dvd.domcellcode,dcell));
+  ret.z=float(pos.z-dvd.domposmin.z-scell*DCEL_Cellz(dvd.domcellcode,dcell));
+  memcpy(&ret.w,&dcell,sizeof(unsigned));
+  return(ret);
+}
+
+//==============================================================================
+/// Returns cell coordinates of PosCell value.
+/// Devuelve las coordenadas de celda del valor PosCell.
+//==============================================================================
+inline tint3 PosCellGetCell(const tfloat4 &pscell,const StDivDataCpu &dvd){
+  unsigned cel;
+  memcpy(&cel,&pscell.w,sizeof(unsigned));
+  return(TInt3(int(DCEL_Cellx(dvd.domcellcode,cel)),int(DCEL_Celly(dvd.domcellcode,cel)),int(DCEL_Cellz(dvd.domcellcode,cel))));
+}
+
+//==============================================================================
+/// Returns distance between particles 1 and 2 (drx,dry,drz and rr2) using 
+/// PosCell values (cel1 is the cell of particle 1).
+/// Devuelve la distancia entre particulas 1 y 2 usando valores PosCell (cel1 
+/// es la celda de la particula 1).
+//==============================================================================
+inline tfloat4 PosCellDistances(const tfloat4 &pscell1,const tint3 &cel1,const tfloat4 &pscell2,const StDivDataCpu &dvd){
+  const tint3 cel2=PosCellGetCell(pscell2,dvd);
+  tfloat4 dr;
+  dr.x=(pscell1.x-pscell2.x)+dvd.scell*float(cel1.x-cel2.x);
+  dr.y=(pscell1.y-pscell2.y)+dvd.scell*float(cel1.y-cel2.y);
+  dr.z=(pscell1.z-pscell2.z)+dvd.scell*float(cel1.z-cel2.z);
+  dr.w=dr.x*dr.x + dr.y*dr.y + dr.z*dr.z;
+  return(dr);
+}
+
 //==============================================================================
 /// Returns distance squared between particles 1 and 2 (rr2).
 //==============================================================================
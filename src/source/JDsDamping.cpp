@@ -35,6 +35,23 @@
 
 using namespace std;
 
+//##############################################################################
+//# JDsDampingOp
+//##############################################################################
+//==============================================================================
+/// Applies Damping to particles of the given ranges on CPU.
+/// Aplica Damping a las particulas de los rangos indicados en CPU.
+//==============================================================================
+void JDsDampingOp::ComputeDampingRangesCpu(double dt,unsigned nsel
+  ,const std::vector<tuint2> &ranges,const tdouble3 *pos,const typecode *code
+  ,tfloat4 *velrhop)const
+{
+  for(unsigned r=0;r<unsigned(ranges.size());r++){
+    ComputeDampingCpu(dt,ranges[r].y-ranges[r].x,ranges[r].x,pos,code,velrhop);
+  }
+}
+
+
 //##############################################################################
 //# JDsDampingOp_Plane
 //##############################################################################
@@ -185,18 +202,6 @@ void JDsDampingOp_Plane::GetConfig(std::vector<std::string> &lines)const{
 void JDsDampingOp_Plane::ComputeDampingCpu(double dt,unsigned n,unsigned pini
   ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const
 {
-  const bool usedomain=UseDomain;
-  const double zmin=DomzMin;
-  const double zmax=DomzMax;
-  const tplane3d pla0=DomPla0;
-  const tplane3d pla1=DomPla1;
-  const tplane3d pla2=DomPla2;
-  const tplane3d pla3=DomPla3;
-  const tplane3d plane=Plane;
-  const float dist=Dist;
-  const float over=OverLimit;
-  const tfloat3 factorxyz=Factorxyz;
-  const float redumax=ReduMax;
   const int inp=int(n);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (static) if(inp>OMP_LIMIT_COMPUTEMEDIUM)
@@ -208,25 +213,68 @@ void JDsDampingOp_Plane::ComputeDampingCpu(double dt,unsigned n,unsigned pini
       const typecode cod=code[p1];
       ok=(CODE_IsNormal(cod) && CODE_IsFluid(cod));
     }
-    if(ok){
-      const tdouble3 ps=pos[p1];
-      //-Check if it is within the domain. | Comprueba si esta dentro del dominio.
-      const double vdis=fgeo::PlanePoint(plane,ps);
-      if(0<vdis && vdis<=dist+over){
-        if(!usedomain || (ps.z>=zmin && ps.z<=zmax && fgeo::PlanePoint(pla0,ps)<=0 && fgeo::PlanePoint(pla1,ps)<=0 && fgeo::PlanePoint(pla2,ps)<=0 && fgeo::PlanePoint(pla3,ps)<=0)){
-          const double fdis=(vdis>=dist? 1.: vdis/dist);
-          const double redudt=dt*(fdis*fdis)*redumax;
-          double redudtx=(1.-redudt*factorxyz.x);
-          double redudty=(1.-redudt*factorxyz.y);
-          double redudtz=(1.-redudt*factorxyz.z);
-          redudtx=(redudtx<0? 0.: redudtx);
-          redudty=(redudty<0? 0.: redudty);
-          redudtz=(redudtz<0? 0.: redudtz);
-          velrhop[p1].x=float(redudtx*velrhop[p1].x);
-          velrhop[p1].y=float(redudty*velrhop[p1].y);
-          velrhop[p1].z=float(redudtz*velrhop[p1].z);
-        }
+    if(ok)ComputeDampingPointCpu(dt,pos[p1],velrhop[p1]);
+  }
+}
+
+//==============================================================================
+/// Returns limits of the box including the damping zone. The zone is bounded 
+/// along the plane normal when it is parallel to an axis and by the domain 
+/// limits when they are defined.
+/// Devuelve limites de la caja que incluye la zona de damping. La zona esta
+/// acotada segun la normal del plano cuando es paralela a un eje y por los 
+/// limites del dominio cuando estan definidos.
+//==============================================================================
+bool JDsDampingOp_Plane::GetBoxLimits(tdouble3 &pmin,tdouble3 &pmax)const{
+  bool ret=UseDomain;
+  pmin=TDouble3(-DBL_MAX);
+  pmax=TDouble3(DBL_MAX);
+  if(UseDomain){
+    pmin.x=std::min(std::min(DomPt0.x,DomPt1.x),std::min(DomPt2.x,DomPt3.x));
+    pmin.y=std::min(std::min(DomPt0.y,DomPt1.y),std::min(DomPt2.y,DomPt3.y));
+    pmax.x=std::max(std::max(DomPt0.x,DomPt1.x),std::max(DomPt2.x,DomPt3.x));
+    pmax.y=std::max(std::max(DomPt0.y,DomPt1.y),std::max(DomPt2.y,DomPt3.y));
+    pmin.z=DomzMin;
+    pmax.z=DomzMax;
+  }
+  //-Limits of slab 0<PlanePoint(Plane,ps)<=Dist+OverLimit with normal parallel to one axis.
+  const double dmax=double(Dist+OverLimit);
+  if(Plane.a && !Plane.b && !Plane.c){
+    const double v1=-Plane.d/Plane.a,v2=(dmax-Plane.d)/Plane.a;
+    pmin.x=std::max(pmin.x,std::min(v1,v2)); pmax.x=std::min(pmax.x,std::max(v1,v2)); ret=true;
+  }
+  if(!Plane.a && Plane.b && !Plane.c){
+    const double v1=-Plane.d/Plane.b,v2=(dmax-Plane.d)/Plane.b;
+    pmin.y=std::max(pmin.y,std::min(v1,v2)); pmax.y=std::min(pmax.y,std::max(v1,v2)); ret=true;
+  }
+  if(!Plane.a && !Plane.b && Plane.c){
+    const double v1=-Plane.d/Plane.c,v2=(dmax-Plane.d)/Plane.c;
+    pmin.z=std::max(pmin.z,std::min(v1,v2)); pmax.z=std::min(pmax.z,std::max(v1,v2)); ret=true;
+  }
+  return(ret);
+}
+
+//==============================================================================
+/// Applies Damping to particles of the given ranges on CPU.
+/// Aplica Damping a las particulas de los rangos indicados en CPU.
+//==============================================================================
+void JDsDampingOp_Plane::ComputeDampingRangesCpu(double dt,unsigned nsel
+  ,const std::vector<tuint2> &ranges,const tdouble3 *pos,const typecode *code
+  ,tfloat4 *velrhop)const
+{
+  const int nr=int(ranges.size());
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (dynamic) if(nsel>OMP_LIMIT_COMPUTEMEDIUM)
+  #endif
+  for(int r=0;r<nr;r++){
+    const unsigned pfin=ranges[r].y;
+    for(unsigned p1=ranges[r].x;p1<pfin;p1++){
+      bool ok=true;
+      if(code){//-Ignores floating and periodic particles. | Descarta particulas floating o periodicas.
+        const typecode cod=code[p1];
+        ok=(CODE_IsNormal(cod) && CODE_IsFluid(cod));
       }
+      if(ok)ComputeDampingPointCpu(dt,pos[p1],velrhop[p1]);
     }
   }
 }
@@ -710,14 +758,35 @@ void JDsDamping::SaveVtkConfig(double dp)const{
 }
 
 //==============================================================================
-/// Applies Damping to the indicated particles.
+/// Returns true when all damping zones are planes (per particle damping with
+/// ComputeDampingPointCpu() is available).
+/// Devuelve true cuando todas las zonas de damping son planos.
+//==============================================================================
+bool JDsDamping::OnlyPlanes()const{
+  bool ret=true;
+  for(unsigned c=0;c<Count() && ret;c++)ret=(List[c]->Type==JDsDampingOp::DA_Plane);
+  return(ret);
+}
+
+//==============================================================================
+/// Applies Damping to the indicated particles. When divdata is valid, bounded
+/// zones only process the particles in their cells.
+/// Aplica Damping a las particulas indicadas. Cuando divdata es valido, las 
+/// zonas acotadas solo procesan las particulas de sus celdas.
 //==============================================================================
 //:#include "JSaveCsv.h"
 void JDsDamping::ComputeDampingCpu(double timestep,double dt,unsigned n,unsigned pini
-  ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const
+  ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop,const StDivDataCpu &divdata)const
 {
+  std::vector<tuint2> ranges;
   for(unsigned c=0;c<Count();c++){
-    List[c]->ComputeDampingCpu(dt,n,pini,pos,code,velrhop);
+    tdouble3 pmin,pmax;
+    if(divdata.begincell && List[c]->GetBoxLimits(pmin,pmax)){
+      //-Margin of two cells since particles moved after the divide (up to MovLimit per update).
+      const unsigned nsel=DivDataCpuBoxRanges(divdata,true,pmin,pmax,2,pini,pini+n,ranges);
+      if(nsel)List[c]->ComputeDampingRangesCpu(dt,nsel,ranges,pos,code,velrhop);
+    }
+    else List[c]->ComputeDampingCpu(dt,n,pini,pos,code,velrhop);
   }
 }
 
@@ -29,6 +29,10 @@
 //:# - Comprueba opcion active en elementos de primer y segundo nivel. (18-03-2020)  
 //:# - Cambio de nombre de J.Damping a J.DsDamping. (28-06-2020)
 //:# - Mejora de codigo para la implementacion de nuevas opcioens de damping. (14-10-2021)
+//:# - Nuevos metodos OnlyPlanes() y ComputeDampingPointCpu() para aplicar el damping
+//:#   de planos por particula en la actualizacion fusionada del Symplectic-Corrector. (17-10-2026)
+//:# - Damping de planos en CPU solo sobre las celdas de su zona segun el ultimo 
+//:#   divide. (17-10-2026)
 //:#############################################################################
 
 /// \file JDsDamping.h \brief Declares the class \ref JDsDamping.
@@ -40,6 +44,8 @@
 #include <vector>
 #include "JObject.h"
 #include "DualSphDef.h"
+#include "FunGeo3d.h"
+#include "JCellDivDataCpu.h"
 #ifdef _WITHGPU
   #include <cuda_runtime_api.h>
 #endif
@@ -105,6 +111,12 @@ public:
   virtual void ComputeDampingCpu(double dt,unsigned n,unsigned pini
     ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const=0;
 
+  /// Returns limits of the box including the damping zone (false when it is not bounded).
+  /// Devuelve limites de la caja que incluye la zona de damping (false cuando no esta acotada).
+  virtual bool GetBoxLimits(tdouble3 &pmin,tdouble3 &pmax)const{ return(false); }
+  virtual void ComputeDampingRangesCpu(double dt,unsigned nsel,const std::vector<tuint2> &ranges
+    ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const;
+
 #ifdef _WITHGPU
   virtual void ComputeDampingGpu(double dt,unsigned n,unsigned pini
     ,const double2 *posxy,const double *posz,const typecode *code,float4 *velrhop)const=0;
@@ -150,6 +162,33 @@ public:
 
   void ComputeDampingCpu(double dt,unsigned n,unsigned pini
     ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const;
+  bool GetBoxLimits(tdouble3 &pmin,tdouble3 &pmax)const;
+  void ComputeDampingRangesCpu(double dt,unsigned nsel,const std::vector<tuint2> &ranges
+    ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const;
+
+  //============================================================================
+  /// Applies Damping to the velocity of one particle according to its position.
+  /// Aplica Damping a la velocidad de una particula segun su posicion.
+  //============================================================================
+  inline void ComputeDampingPointCpu(double dt,const tdouble3 &ps,tfloat4 &velrhop)const{
+    //-Check if it is within the domain. | Comprueba si esta dentro del dominio.
+    const double vdis=fgeo::PlanePoint(Plane,ps);
+    if(0<vdis && vdis<=Dist+OverLimit){
+      if(!UseDomain || (ps.z>=DomzMin && ps.z<=DomzMax && fgeo::PlanePoint(DomPla0,ps)<=0 && fgeo::PlanePoint(DomPla1,ps)<=0 && fgeo::PlanePoint(DomPla2,ps)<=0 && fgeo::PlanePoint(DomPla3,ps)<=0)){
+        const double fdis=(vdis>=Dist? 1.: vdis/Dist);
+        const double redudt=dt*(fdis*fdis)*ReduMax;
+        double redudtx=(1.-redudt*Factorxyz.x);
+        double redudty=(1.-redudt*Factorxyz.y);
+        double redudtz=(1.-redudt*Factorxyz.z);
+        redudtx=(redudtx<0? 0.: redudtx);
+        redudty=(redudty<0? 0.: redudty);
+        redudtz=(redudtz<0? 0.: redudtz);
+        velrhop.x=float(redudtx*velrhop.x);
+        velrhop.y=float(redudty*velrhop.y);
+        velrhop.z=float(redudtz*velrhop.z);
+      }
+    }
+  }
 
 #ifdef _WITHGPU
   void ComputeDampingGpu(double dt,unsigned n,unsigned pini
@@ -278,7 +317,17 @@ public:
   void VisuConfig(std::string txhead,std::string txfoot);
 
   void ComputeDampingCpu(double timestep,double dt,unsigned n,unsigned pini
-    ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const;
+    ,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop,const StDivDataCpu &divdata)const;
+
+  bool OnlyPlanes()const;
+  //============================================================================
+  /// Applies Damping to the velocity of one particle (only when OnlyPlanes() is true).
+  /// Aplica Damping a la velocidad de una particula (solo cuando OnlyPlanes() es true).
+  //============================================================================
+  inline void ComputeDampingPointCpu(double dt,const tdouble3 &ps,tfloat4 &velrhop)const{
+    const unsigned nc=Count();
+    for(unsigned c=0;c<nc;c++)((const JDsDampingOp_Plane*)List[c])->ComputeDampingPointCpu(dt,ps,velrhop);
+  }
 
 #ifdef _WITHGPU
   void ComputeDampingGpu(double timestep,double dt,unsigned n,unsigned pini
@@ -367,6 +367,20 @@ template<TpKernel tker> void JGaugeVelocity::CalculeCpuT(double timestep
   //Log->Printf("------> t:%f",TimeStep);
   if(Output(timestep))StoreResult();
 }
+
+//==============================================================================
+/// Stores velocity at the point computed by the batched evaluation of 
+/// JGaugeSystem (on CPU).
+/// Guarda la velocidad en el punto calculada por la evaluacion conjunta de
+/// JGaugeSystem (en CPU).
+//==============================================================================
+void JGaugeVelocity::SetResultCpu(double timestep,const tfloat3 &ptvel){
+  SetTimeStep(timestep);
+  //-Stores result. | Guarda resultado.
+  Result.Set(timestep,ToTFloat3(Point),ptvel);
+  if(Output(timestep))StoreResult();
+}
+
 //==============================================================================
 /// Calculates velocity at indicated points (on CPU).
 //==============================================================================
@@ -598,6 +612,48 @@ template<TpKernel tker> void JGaugeSwl::CalculeCpuT(double timestep
   if(Output(timestep))StoreResult();
 }
 
+//==============================================================================
+/// Adds the points where mass is computed (in the same order and with the same
+/// values used by CalculeCpuT()). Returns number of points.
+/// Anhade los puntos donde se calcula la masa (en el mismo orden y con los 
+/// mismos valores usados por CalculeCpuT()). Devuelve el numero de puntos.
+//==============================================================================
+unsigned JGaugeSwl::GetMassPoints(std::vector<tdouble3> &points)const{
+  tdouble3 ptpos=Point0;
+  for(unsigned cp=0;cp<=PointNp;cp++){
+    points.push_back(ptpos);
+    ptpos=ptpos+PointDir;
+  }
+  return(PointNp+1);
+}
+
+//==============================================================================
+/// Calculates surface water level starting from the mass of all points computed
+/// by the batched evaluation of JGaugeSystem (on CPU).
+/// Calcula nivel de superficie a partir de la masa de todos los puntos calculada
+/// por la evaluacion conjunta de JGaugeSystem (en CPU).
+//==============================================================================
+void JGaugeSwl::SetResultMassCpu(double timestep,const float *mass){
+  SetTimeStep(timestep);
+  //-Look for change of fluid to empty. | Busca paso de fluido a vacio.
+  tdouble3 ptsurf=TDouble3(DBL_MAX);
+  float mpre=0;
+  tdouble3 ptpos=Point0;
+  for(unsigned cp=0;cp<=PointNp;cp++){
+    if(mass[cp]>MassLimit)mpre=mass[cp];
+    if(mass[cp]<MassLimit && mpre){
+      const float fxm1=(MassLimit-mpre)/(mass[cp]-mpre)-1;
+      ptsurf=ptpos+(PointDir*double(fxm1));
+      cp=PointNp+1;
+    }
+    ptpos=ptpos+PointDir;
+  }
+  if(ptsurf.x==DBL_MAX)ptsurf=Point0+(PointDir*(mpre? PointNp: 0));
+  //-Stores result. | Guarda resultado.
+  Result.Set(timestep,ToTFloat3(Point0),ToTFloat3(Point2),ToTFloat3(ptsurf));
+  if(Output(timestep))StoreResult();
+}
+
 //==============================================================================
 /// Calculates surface water level at indicated points (on CPU).
 //==============================================================================
@@ -793,9 +849,8 @@ void JGaugeMaxZ::CalculeCpu(double timestep,const StDivDataCpu &dvd
   float zmax=-FLT_MAX;
   //-Search for neighbours in adjacent cells. | Busqueda de vecinos en celdas adyacentes.
   if(cxini<cxfin)for(int z=zfin-1;z>=zini && pmax==UINT_MAX;z--){
-    const int zmod=(dvd.nc.w)*z+dvd.cellfluid; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
     for(int y=yini;y<yfin;y++){
-      int ymod=zmod+dvd.nc.x*y;
+      const int ymod=DivDataCpuRowCell(dvd,y,z)+dvd.cellfluid; //-Sum from start of fluid cells. | Le suma donde empiezan las celdas de fluido.
       const unsigned pini=dvd.begincell[cxini+ymod];
       const unsigned pfin=dvd.begincell[cxfin+ymod];
 
@@ -223,6 +223,9 @@ public:
   const StGaugeVelRes& GetResult()const{ return(Result); }
 
   void SetPoint(const tdouble3 &point){ ClearResult(); Point=point; }
+  bool GetPointOut()const{ return(PointIsOut(Point.x,Point.y,Point.z)); }
+
+  void SetResultCpu(double timestep,const tfloat3 &ptvel);
 
   template<TpKernel tker> void CalculeCpuT(double timestep,const StDivDataCpu &dvd
     ,unsigned npbok,unsigned npb,unsigned np,const tdouble3 *pos
@@ -301,6 +304,9 @@ public:
 
   void SetPoints(const tdouble3 &point0,const tdouble3 &point2,double pointdp=0);
 
+  unsigned GetMassPoints(std::vector<tdouble3> &points)const;
+  void SetResultMassCpu(double timestep,const float *mass);
+
   template<TpKernel tker> void CalculeCpuT(double timestep,const StDivDataCpu &dvd
     ,unsigned npbok,unsigned npb,unsigned np,const tdouble3 *pos
     ,const typecode *code,const unsigned *idp,const tfloat4 *velrhop);
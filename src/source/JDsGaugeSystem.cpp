@@ -19,6 +19,7 @@
 /// \file JDsGaugeSystem.cpp \brief Implements the class \ref JGaugeSystem.
 
 #include "JDsGaugeSystem.h"
+#include "JCellSearch_inline.h"
 #include "FunSphKernel.h"
 #include "JLog2.h"
 #include "JXml.h"
@@ -73,6 +74,7 @@ void JGaugeSystem::Reset(){
   ResetCfgDefault();
   for(unsigned c=0;c<Gauges.size();c++)delete Gauges[c];
   Gauges.clear();
+  BatchCpu=true;
  #ifdef _WITHGPU
   if(AuxMemoryg)cudaFree(AuxMemoryg); AuxMemoryg=NULL;
  #endif
@@ -442,7 +444,133 @@ JGaugeItem* JGaugeSystem::GetGauge(unsigned c)const{
 }
 
 //==============================================================================
-/// Updates results on gauges (on CPU).
+/// Comparison function to sort points by cell (z,y,x) and point index (w).
+/// Funcion de comparacion para ordenar puntos por celda (z,y,x) e indice (w).
+//==============================================================================
+static bool BatchCellLess(const tint4 &a,const tint4 &b){
+  return(a.x<b.x || (a.x==b.x && (a.y<b.y || (a.y==b.y && (a.z<b.z || (a.z==b.z && a.w<b.w))))));
+}
+
+//==============================================================================
+/// Computes kernel sums of velocity and mass on several points (on CPU). Points
+/// are grouped by cell so the particles of the neighbouring cells are loaded 
+/// once for all points of the group. Particles are visited in the same order 
+/// as JGaugeVelocity and JGaugeSwl, so results are identical.
+///
+/// Calcula sumas del kernel de velocidad y masa en varios puntos (en CPU). Los
+/// puntos se agrupan por celda para que las particulas de las celdas vecinas 
+/// se carguen una vez para todos los puntos del grupo. Las particulas se 
+/// recorren en el mismo orden que JGaugeVelocity y JGaugeSwl, por lo que los 
+/// resultados son identicos.
+//==============================================================================
+void JGaugeSystem::CalculeBatchPointsCpu(unsigned npt,const tdouble3 *ptpos
+  ,const StDivDataCpu &dvd,const tdouble3 *pos,const typecode *code
+  ,const tfloat4 *velrhop,tfloat3 *ptvel,float *ptmass)const
+{
+  //-Sorts points by cell. | Ordena puntos por celda.
+  std::vector<tint4> ptcell(npt);
+  for(unsigned cp=0;cp<npt;cp++){
+    const tdouble3 ps=ptpos[cp];
+    ptcell[cp]=TInt4(int((ps.z-dvd.domposmin.z)/dvd.scell),int((ps.y-dvd.domposmin.y)/dvd.scell)
+      ,int((ps.x-dvd.domposmin.x)/dvd.scell),int(cp));
+  }
+  std::sort(ptcell.begin(),ptcell.end(),BatchCellLess);
+  //-Obtains groups of points in the same cell. | Obtiene grupos de puntos en la misma celda.
+  std::vector<unsigned> groups;
+  for(unsigned cp=0;cp<npt;cp++){
+    const tint4 c=ptcell[cp];
+    if(!cp || c.x!=ptcell[cp-1].x || c.y!=ptcell[cp-1].y || c.z!=ptcell[cp-1].z)groups.push_back(cp);
+  }
+  groups.push_back(npt);
+  const int ngroups=int(groups.size())-1;
+  const float kernelsize2=CSP.kernelsize2;
+  const float massfluid=CSP.massfluid;
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    std::vector<double> sums;
+    #ifdef OMP_USE
+      #pragma omp for schedule (dynamic)
+    #endif
+    for(int cgr=0;cgr<ngroups;cgr++){
+      const unsigned gini=groups[cgr],gfin=groups[cgr+1],gn=gfin-gini;
+      sums.assign(size_t(gn)*4,0);
+      //-Search for fluid neighbours in adjacent cells.
+      const StNgSearch ngs=nsearch::Init(ptpos[ptcell[gini].w],false,dvd);
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=nsearch::ParticleRange(y,z,ngs,dvd);
+        for(unsigned p2=pif.x;p2<pif.y;p2++)if(CODE_IsFluid(code[p2])){
+          const tdouble3 pos2=pos[p2];
+          const tfloat4 velrhop2=velrhop[p2];
+          for(unsigned cp=0;cp<gn;cp++){
+            const float rr2=nsearch::Distance2(ptpos[ptcell[gini+cp].w],pos2);
+            //-Interaction with real neighbouring particles.
+            if(rr2<=kernelsize2 && rr2>=ALMOSTZERO){
+              float wab=fsph::GetKernel_Wab<KERNEL_Wendland>(CSP,rr2);
+              wab*=massfluid/velrhop2.w;
+              double *sum=sums.data()+cp*4;
+              sum[0]+=wab*velrhop2.x;
+              sum[1]+=wab*velrhop2.y;
+              sum[2]+=wab*velrhop2.z;
+              sum[3]+=wab*massfluid;
+            }
+          }
+        }
+      }
+      //-Stores results. | Guarda resultados.
+      for(unsigned cp=0;cp<gn;cp++){
+        const unsigned pt=unsigned(ptcell[gini+cp].w);
+        const double *sum=sums.data()+cp*4;
+        ptvel[pt]=ToTFloat3(TDouble3(sum[0],sum[1],sum[2]));
+        ptmass[pt]=float(sum[3]);
+      }
+    }
+  }
+}
+
+//==============================================================================
+/// Updates results on velocity and SWL gauges using one batched evaluation of
+/// all their points (on CPU).
+/// Actualiza resultados de gauges de velocidad y SWL usando una evaluacion 
+/// conjunta de todos sus puntos (en CPU).
+//==============================================================================
+void JGaugeSystem::CalculeBatchCpu(double timestep,const StDivDataCpu &dvd
+  ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop
+  ,const std::vector<unsigned> &gauges)
+{
+  //-Collects points of gauges. | Recopila puntos de los gauges.
+  const unsigned ngb=unsigned(gauges.size());
+  std::vector<tdouble3> ptpos;
+  std::vector<unsigned> ptini(ngb+1,0);
+  for(unsigned cb=0;cb<ngb;cb++){
+    ptini[cb]=unsigned(ptpos.size());
+    const JGaugeItem* gau=Gauges[gauges[cb]];
+    if(gau->Type==JGaugeItem::GAUGE_Vel){
+      const JGaugeVelocity* gauvel=(const JGaugeVelocity*)gau;
+      //-Points out of domain are not computed. | Los puntos fuera del dominio no se calculan.
+      if(!gauvel->GetPointOut())ptpos.push_back(gauvel->GetPoint());
+    }
+    if(gau->Type==JGaugeItem::GAUGE_Swl)((const JGaugeSwl*)gau)->GetMassPoints(ptpos);
+  }
+  const unsigned npt=unsigned(ptpos.size());
+  ptini[ngb]=npt;
+  //-Computes velocity and mass on all points. | Calcula velocidad y masa en todos los puntos.
+  std::vector<tfloat3> ptvel(npt);
+  std::vector<float> ptmass(npt);
+  if(npt)CalculeBatchPointsCpu(npt,ptpos.data(),dvd,pos,code,velrhop,ptvel.data(),ptmass.data());
+  //-Stores results on gauges. | Guarda resultados en los gauges.
+  for(unsigned cb=0;cb<ngb;cb++){
+    JGaugeItem* gau=Gauges[gauges[cb]];
+    const unsigned cp=ptini[cb];
+    if(gau->Type==JGaugeItem::GAUGE_Vel)((JGaugeVelocity*)gau)->SetResultCpu(timestep,(ptini[cb+1]>cp? ptvel[cp]: TFloat3(0)));
+    if(gau->Type==JGaugeItem::GAUGE_Swl)((JGaugeSwl*)gau)->SetResultMassCpu(timestep,ptmass.data()+cp);
+  }
+}
+
+//==============================================================================
+/// Updates results on gauges (on CPU). Velocity and SWL gauges are computed 
+/// together in one batched pass when there are several of them.
 //==============================================================================
 void JGaugeSystem::CalculeCpu(double timestep,const StDivDataCpu &dvd
   ,unsigned npbok,unsigned npb,unsigned np,const tdouble3 *pos
@@ -450,12 +578,25 @@ void JGaugeSystem::CalculeCpu(double timestep,const StDivDataCpu &dvd
   ,bool saveinput)
 {
   const unsigned ng=GetCount();
+  //-Selects velocity and SWL gauges for batched evaluation.
+  std::vector<unsigned> gaubatch;
+  if(BatchCpu){
+    for(unsigned cg=0;cg<ng;cg++){
+      const JGaugeItem* gau=Gauges[cg];
+      if((gau->Type==JGaugeItem::GAUGE_Vel || gau->Type==JGaugeItem::GAUGE_Swl) && gau->Update(timestep))gaubatch.push_back(cg);
+    }
+    if(gaubatch.size()<2)gaubatch.clear();
+  }
+  //-Computes other gauges one by one.
+  unsigned cb=0;
   for(unsigned cg=0;cg<ng;cg++){
     JGaugeItem* gau=Gauges[cg];
-    if(gau->Update(timestep)){
+    if(cb<unsigned(gaubatch.size()) && gaubatch[cb]==cg)cb++;
+    else if(gau->Update(timestep)){
       gau->CalculeCpu(timestep,dvd,npbok,npb,np,pos,code,idp,velrhop);
     }
   }
+  if(!gaubatch.empty())CalculeBatchCpu(timestep,dvd,pos,code,velrhop,gaubatch);
   //-Saves input state.
   InputCpu=(saveinput? StrInputCpu(timestep,dvd,npbok,npb,np,pos,code,idp,velrhop): StrInputCpu());
 }
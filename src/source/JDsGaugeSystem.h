@@ -28,6 +28,8 @@
 //:# - Comprueba opcion active en elementos de primer y segundo nivel. (18-03-2020)  
 //:# - Cambio de nombre de fichero J.GaugeSystem a J.DsGaugeSystem. (28-06-2020)
 //:# - Nuevos metodos CalculeLastInputXXX(). (27-08-2020)
+//:# - Evaluacion conjunta de gauges de velocidad y SWL en CPU agrupando los 
+//:#   puntos por celda. (17-10-2026)
 //:#############################################################################
 
 /// \file JDsGaugeSystem.h \brief Declares the class \ref JGaugeSystem.
@@ -127,6 +129,8 @@ private:
   
   std::vector<JGaugeItem*> Gauges;
 
+  bool BatchCpu;          ///<Velocity and SWL gauges are computed in one batched pass on CPU (default=true).
+
   //-Variables for GPU.
  #ifdef _WITHGPU
   float3* AuxMemoryg;  ///<Auxiliary allocated memory on GPU [1].
@@ -145,6 +149,13 @@ private:
   JGaugeItem::StDefault ReadXmlCommon(const JXml *sxml,TiXmlElement* ele)const;
   void ReadXml(const JXml *sxml,TiXmlElement* ele,const JSphMk* mkinfo);
 
+  void CalculeBatchPointsCpu(unsigned npt,const tdouble3 *ptpos,const StDivDataCpu &dvd
+    ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop
+    ,tfloat3 *ptvel,float *ptmass)const;
+  void CalculeBatchCpu(double timestep,const StDivDataCpu &dvd
+    ,const tdouble3 *pos,const typecode *code,const tfloat4 *velrhop
+    ,const std::vector<unsigned> &gauges);
+
 public:
   JGaugeSystem(bool cpu);
   ~JGaugeSystem();
@@ -191,6 +202,9 @@ public:
 
   void CalculeLastInputCpu(std::string gaugename);
 
+  void SetBatchCpu(bool batch){ BatchCpu=batch; }
+  bool GetBatchCpu()const{ return(BatchCpu); }
+
  #ifdef _WITHGPU
   void CalculeGpu(double timestep,const StDivDataGpu &dvd
     ,unsigned npbok,unsigned npb,unsigned np,const double2 *posxy,const double *posz
@@ -0,0 +1,443 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file JDsNgListCpu.cpp \brief Implements the class \ref JDsNgListCpu.
+
+#include "JDsNgListCpu.h"
+#include "JCellSearch_inline.h"
+#include "JLog2.h"
+#include "JAppInfo.h"
+#include "Functions.h"
+#include <climits>
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+//##############################################################################
+//# JDsNgListCpu
+//##############################################################################
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JDsNgListCpu::JDsNgListCpu(float kernelsize,float skin)
+  :Log(AppInfo.LogPtr()),KernelSize(kernelsize),Skin(skin)
+  ,RList2((kernelsize+skin)*(kernelsize+skin)),MaxDisp2((skin/2)*(skin/2))
+  ,RInsert2((kernelsize+skin*1.5f)*(kernelsize+skin*1.5f))
+{
+  ClassName="JDsNgListCpu";
+  SizeNp=0;
+  CurToBuild=NULL; BuildToCur=NULL; AuxIdx=NULL;
+  PosRef=NULL; BeginNg=NULL; OvfRange=NULL;
+  SizeNg=0;
+  Ng=NULL;
+  Reset();
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JDsNgListCpu::~JDsNgListCpu(){
+  DestructorActive=true;
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables and frees memory.
+//==============================================================================
+void JDsNgListCpu::Reset(){
+  Valid=false;
+  Np=Npb=0;
+  NbMain=NbDone=NbTotal=0;
+  PendingDel.clear();
+  SizeNp=0;
+  delete[] CurToBuild; CurToBuild=NULL;
+  delete[] BuildToCur; BuildToCur=NULL;
+  delete[] AuxIdx;     AuxIdx=NULL;
+  delete[] PosRef;     PosRef=NULL;
+  delete[] BeginNg;    BeginNg=NULL;
+  delete[] OvfRange;   OvfRange=NULL;
+  SizeNg=0;
+  delete[] Ng; Ng=NULL;
+  NgUsed=0;
+  NumBuild=NumUpdate=NumPatch=0;
+}
+
+//==============================================================================
+/// Returns the allocated memory.
+//==============================================================================
+llong JDsNgListCpu::GetAllocMemory()const{
+  llong s=0;
+  s+=llong(sizeof(unsigned)*3+sizeof(tdouble3))*SizeNp;
+  if(SizeNp)s+=llong(sizeof(unsigned))*(llong(SizeNp)*2+1)+llong(sizeof(tuint2))*SizeNp*2;
+  s+=llong(sizeof(unsigned))*SizeNg;
+  return(s);
+}
+
+//==============================================================================
+/// Allocates memory for particles when it is necessary.
+/// Reserva memoria para particulas cuando es necesario.
+//==============================================================================
+void JDsNgListCpu::AllocMemoryNp(unsigned np){
+  if(np>SizeNp){
+    delete[] CurToBuild; CurToBuild=NULL;
+    delete[] BuildToCur; BuildToCur=NULL;
+    delete[] AuxIdx;     AuxIdx=NULL;
+    delete[] PosRef;     PosRef=NULL;
+    delete[] BeginNg;    BeginNg=NULL;
+    delete[] OvfRange;   OvfRange=NULL;
+    SizeNp=0;
+    const unsigned size=np+np/10;
+    try{
+      CurToBuild=new unsigned[size];
+      BuildToCur=new unsigned[size];
+      AuxIdx    =new unsigned[size];
+      PosRef    =new tdouble3[size];
+      BeginNg   =new unsigned[size*2+1];
+      OvfRange  =new tuint2[size*2];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Could not allocate the requested memory for neighbour list of %u particles.",size));
+    }
+    SizeNp=size;
+  }
+}
+
+//==============================================================================
+/// Allocates memory for neighbours when it is necessary.
+/// Reserva memoria para vecinos cuando es necesario.
+//==============================================================================
+void JDsNgListCpu::AllocMemoryNg(ullong nng){
+  if(nng>SizeNg){
+    delete[] Ng; Ng=NULL;
+    SizeNg=0;
+    const ullong size=min(nng+nng/10,ullong(UINT_MAX));
+    try{
+      Ng=new unsigned[size];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Could not allocate the requested memory for neighbour list of %llu neighbours.",size));
+    }
+    SizeNg=size;
+  }
+}
+
+//==============================================================================
+/// Returns the square of the maximum displacement of particles since the list
+/// was built.
+/// Devuelve el cuadrado del desplazamiento maximo de las particulas desde que
+/// se creo la lista.
+//==============================================================================
+float JDsNgListCpu::ComputeMaxDisp2(unsigned np,const tdouble3 *pos)const{
+  const int n=int(np);
+  float dmax=0;
+  #ifdef OMP_USE
+    #pragma omp parallel if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  {
+    float dmaxth=0;
+    #ifdef OMP_USE
+      #pragma omp for nowait
+    #endif
+    for(int p=0;p<n;p++){
+      const float d2=nsearch::Distance2(pos[p],PosRef[CurToBuild[p]]);
+      if(dmaxth<d2)dmaxth=d2;
+    }
+    #ifdef OMP_USE
+      #pragma omp critical
+    #endif
+    {
+      if(dmax<dmaxth)dmax=dmaxth;
+    }
+  }
+  return(dmax);
+}
+
+//==============================================================================
+/// Builds the neighbour list for current particles. Boundary particles only
+/// have fluid neighbours and fluid particles have bound and fluid neighbours.
+/// Crea la lista de vecinos para las particulas actuales. Las particulas de
+/// contorno solo tienen vecinos fluido y las de fluido tienen vecinos de
+/// contorno y fluido.
+//==============================================================================
+void JDsNgListCpu::Build(unsigned np,unsigned npb,const StDivDataCpu &divdata
+  ,const unsigned *dcell,const tdouble3 *pos)
+{
+  Valid=false;
+  AllocMemoryNp(np);
+  Np=np; Npb=npb;
+  NbMain=NbDone=NbTotal=np;
+  PendingDel.clear();
+  const int ncdiv=max(int(ceil(sqrt(RList2)/divdata.scell)),divdata.scelldiv);
+  const int n=int(np);
+  const float rlist2=RList2;
+  //-Counts neighbours of each particle. | Cuenta vecinos de cada particula.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (guided)
+  #endif
+  for(int p1=0;p1<n;p1++){
+    const tdouble3 posp1=pos[p1];
+    BeginNg[p1*2]=0;
+    for(byte tpfluid=(unsigned(p1)<npb? 1: 0);tpfluid<=1;tpfluid++){
+      unsigned num=0;
+      const StNgSearch ngs=nsearch::InitDiv(dcell[p1],!tpfluid,ncdiv,divdata);
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
+        for(unsigned p2=pif.x;p2<pif.y;p2++){
+          if(p2!=unsigned(p1) && nsearch::Distance2(posp1,pos[p2])<=rlist2)num++;
+        }
+      }
+      BeginNg[p1*2+tpfluid]=num;
+    }
+  }
+  //-Computes position of first neighbour of each segment. | Calcula posicion del primer vecino de cada segmento.
+  ullong nng=0;
+  for(unsigned c=0;c<np*2;c++){
+    const unsigned v=BeginNg[c];
+    BeginNg[c]=unsigned(nng);
+    nng+=v;
+    if(nng>=UINT_MAX)Run_Exceptioon(fun::PrintStr("Number of neighbours in neighbour list is too big (np=%u). Reduce the skin distance.",np));
+  }
+  BeginNg[np*2]=unsigned(nng);
+  AllocMemoryNg(nng);
+  NgUsed=unsigned(nng);
+  memset(OvfRange,0,sizeof(tuint2)*np*2);
+  //-Stores neighbours. | Graba vecinos.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (guided)
+  #endif
+  for(int p1=0;p1<n;p1++){
+    const tdouble3 posp1=pos[p1];
+    for(byte tpfluid=(unsigned(p1)<npb? 1: 0);tpfluid<=1;tpfluid++){
+      unsigned cng=BeginNg[p1*2+tpfluid];
+      const StNgSearch ngs=nsearch::InitDiv(dcell[p1],!tpfluid,ncdiv,divdata);
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
+        for(unsigned p2=pif.x;p2<pif.y;p2++){
+          if(p2!=unsigned(p1) && nsearch::Distance2(posp1,pos[p2])<=rlist2)Ng[cng++]=p2;
+        }
+      }
+    }
+    //-Build index is the current index. | El indice de creacion es el indice actual.
+    CurToBuild[p1]=BuildToCur[p1]=unsigned(p1);
+    PosRef[p1]=posp1;
+  }
+  Valid=true;
+  NumBuild++;
+}
+
+//==============================================================================
+/// Replaces bold by bnew in the neighbours of build index b.
+/// Sustituye bold por bnew en los vecinos del indice de creacion b.
+//==============================================================================
+void JDsNgListCpu::ReplaceNg(unsigned b,unsigned bold,unsigned bnew){
+  for(unsigned r=b*2;r<b*2+2;r++){
+    const unsigned ini=BeginNg[r],fin=BeginNg[r+1];
+    for(unsigned c=ini;c<fin;c++)if(Ng[c]==bold)Ng[c]=bnew;
+    const tuint2 rg=OvfRange[r];
+    for(unsigned c=rg.x;c<rg.y;c++)if(Ng[c]==bold)Ng[c]=bnew;
+  }
+}
+
+//==============================================================================
+/// Adds build index b to the additional neighbours of segment r. The segment
+/// is moved to the end of used Ng[] when it is not there. Returns false when
+/// there is not free space in Ng[].
+/// Anhade el indice de creacion b a los vecinos adicionales del segmento r.
+/// El segmento se mueve al final de Ng[] usado cuando no esta alli. Devuelve
+/// false cuando no hay espacio libre en Ng[].
+//==============================================================================
+bool JDsNgListCpu::AddNg(unsigned r,unsigned b){
+  tuint2 &rg=OvfRange[r];
+  const unsigned n=rg.y-rg.x;
+  if(!n || rg.y!=NgUsed){
+    if(ullong(NgUsed)+n+1>SizeNg)return(false);
+    if(n)memcpy(Ng+NgUsed,Ng+rg.x,sizeof(unsigned)*n);
+    rg=TUint2(NgUsed,NgUsed+n);
+    NgUsed+=n;
+  }
+  else if(ullong(NgUsed)+1>SizeNg)return(false);
+  Ng[NgUsed++]=b;
+  rg.y++;
+  return(true);
+}
+
+//==============================================================================
+/// Removes the particles removed in cell division and inserts the new particles
+/// in the list. Returns false when the list must be built again.
+/// Quita las particulas eliminadas en el divide e inserta las particulas nuevas
+/// en la lista. Devuelve false cuando la lista debe crearse de nuevo.
+//==============================================================================
+bool JDsNgListCpu::Patch(unsigned npb,const StDivDataCpu &divdata
+  ,const unsigned *dcell,const tdouble3 *pos)
+{
+  //-Removed particles are replaced by the owner of the list (ignored by distance).
+  //-Las particulas eliminadas se sustituyen por el duenho de la lista (ignorado por distancia).
+  const unsigned ndel=unsigned(PendingDel.size());
+  for(unsigned cd=0;cd<ndel;cd++){
+    const unsigned b=PendingDel[cd];
+    if(b<NbDone)for(unsigned r=b*2;r<b*2+2;r++){
+      const unsigned ini=BeginNg[r],fin=BeginNg[r+1];
+      for(unsigned c=ini;c<fin;c++){
+        const unsigned b2=Ng[c];
+        if(BuildToCur[b2]!=UINT_MAX)ReplaceNg(b2,b,b2);
+      }
+      const tuint2 rg=OvfRange[r];
+      for(unsigned c=rg.x;c<rg.y;c++){
+        const unsigned b2=Ng[c];
+        if(BuildToCur[b2]!=UINT_MAX)ReplaceNg(b2,b,b2);
+      }
+    }
+  }
+  PendingDel.clear();
+  //-New particles obtain their neighbours and they are added to the neighbours of them.
+  //-Las particulas nuevas obtienen sus vecinos y se anhaden a los vecinos de estos.
+  const int ncdiv=max(int(ceil(sqrt(RInsert2)/divdata.scell)),divdata.scelldiv);
+  const float rins2=RInsert2;
+  std::vector<unsigned> lst;
+  for(unsigned b=NbDone;b<NbTotal;b++){
+    const unsigned p1=BuildToCur[b];
+    if(p1==UINT_MAX)continue;
+    const tdouble3 posp1=pos[p1];
+    PosRef[b]=posp1;
+    const bool boundp1=(p1<npb);
+    for(byte tpfluid=(boundp1? 1: 0);tpfluid<=1;tpfluid++){
+      lst.clear();
+      const StNgSearch ngs=nsearch::InitDiv(dcell[p1],!tpfluid,ncdiv,divdata);
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
+        for(unsigned p2=pif.x;p2<pif.y;p2++){
+          if(p2!=p1 && nsearch::Distance2(posp1,pos[p2])<=rins2)lst.push_back(CurToBuild[p2]);
+        }
+      }
+      //-Stores neighbours of new particle. | Graba vecinos de la particula nueva.
+      const unsigned n=unsigned(lst.size());
+      if(ullong(NgUsed)+n>SizeNg)return(false);
+      if(n)memcpy(Ng+NgUsed,&lst[0],sizeof(unsigned)*n);
+      OvfRange[b*2+tpfluid]=TUint2(NgUsed,NgUsed+n);
+      NgUsed+=n;
+      //-Adds new particle to its neighbours (the new ones find it themselves).
+      //-Anhade la particula nueva a sus vecinos (las nuevas la encuentran ellas mismas).
+      for(unsigned c=0;c<n;c++)if(lst[c]<NbDone && !AddNg(lst[c]*2+(boundp1? 0: 1),b))return(false);
+    }
+  }
+  NbDone=NbTotal;
+  NumPatch++;
+  return(true);
+}
+
+//==============================================================================
+/// Checks the displacement of particles and rebuilds the neighbour list when
+/// it is necessary.
+/// Comprueba el desplazamiento de las particulas y recrea la lista de vecinos
+/// cuando es necesario.
+//==============================================================================
+void JDsNgListCpu::Update(unsigned np,unsigned npb,const StDivDataCpu &divdata
+  ,const unsigned *dcell,const tdouble3 *pos)
+{
+  NumUpdate++;
+  bool rebuild=(!Valid || np!=Np || npb!=Npb);
+  if(!rebuild && (NbDone<NbTotal || !PendingDel.empty()))rebuild=!Patch(npb,divdata,dcell,pos);
+  if(!rebuild)rebuild=(ComputeMaxDisp2(np,pos)>MaxDisp2);
+  if(rebuild)Build(np,npb,divdata,dcell,pos);
+}
+
+//==============================================================================
+/// Updates indices according to the new order of particles after cell division.
+/// Particles appended after the last division (npini>Np) obtain new build 
+/// indices and particles removed in the division are recorded, both are 
+/// applied to the list in the next Update().
+/// Actualiza indices segun el nuevo orden de las particulas tras el divide.
+/// Las particulas anhadidas despues del ultimo divide (npini>Np) obtienen
+/// nuevos indices de creacion y se guardan las particulas eliminadas en el
+/// divide, ambas se aplican a la lista en el siguiente Update().
+//==============================================================================
+void JDsNgListCpu::SortParticles(unsigned npini,unsigned np,unsigned npb
+  ,unsigned pini,const unsigned *sortpart)
+{
+  if(Valid && (npini<Np || npb!=Npb || pini>np || pini>Np))Valid=false;
+  //-Checks the number of build indices and changes. | Comprueba el numero de indices de creacion y cambios.
+  const unsigned nnew=(Valid? npini-Np: 0);
+  if(Valid && (ullong(NbTotal)+nnew>SizeNp 
+    || ullong(NbTotal-NbDone)+PendingDel.size()+nnew+(npini-np)>Np/PATCHFRAC))Valid=false;
+  if(Valid){
+    const int ini=int(pini),n=int(np),n0=int(Np);
+    const unsigned np0=Np;
+    //-Marks build indices of reordered particles as removed.
+    //-Marca indices de creacion de las particulas reordenadas como eliminadas.
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n0>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=ini;p<n0;p++)BuildToCur[CurToBuild[p]]=UINT_MAX;
+    //-Computes build index of particles in new order (UINT_MAX for new particles).
+    //-Calcula indice de creacion de las particulas en el nuevo orden (UINT_MAX para las nuevas).
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=ini;p<n;p++){
+      const unsigned pold=sortpart[p];
+      const unsigned b=(pold<np0? CurToBuild[pold]: UINT_MAX);
+      AuxIdx[p]=b;
+      if(b!=UINT_MAX)BuildToCur[b]=unsigned(p);
+    }
+    //-Records removed particles. | Guarda las particulas eliminadas.
+    if(npini>np)for(int p=ini;p<n0;p++){
+      const unsigned b=CurToBuild[p];
+      if(BuildToCur[b]==UINT_MAX)PendingDel.push_back(b);
+    }
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=ini;p<n;p++)CurToBuild[p]=AuxIdx[p];
+    //-Assigns new build indices to new particles. | Asigna nuevos indices de creacion a las particulas nuevas.
+    if(nnew)for(int p=ini;p<n;p++)if(CurToBuild[p]==UINT_MAX){
+      const unsigned b=NbTotal++;
+      CurToBuild[p]=b;
+      BuildToCur[b]=unsigned(p);
+      BeginNg[b*2+1]=BeginNg[b*2+2]=BeginNg[NbMain*2];
+      OvfRange[b*2]=OvfRange[b*2+1]=TUint2(0);
+    }
+    Np=np;
+  }
+}
+
+//==============================================================================
+/// Returns structure with neighbour list for interaction (empty when it is
+/// not valid).
+//==============================================================================
+StNgListCpu JDsNgListCpu::GetNgList()const{
+  StNgListCpu ret=NgListCpuNull();
+  if(Valid){
+    ret.curtobuild=CurToBuild;
+    ret.buildtocur=BuildToCur;
+    ret.beginng=BeginNg;
+    ret.ng=Ng;
+    ret.ovfrange=OvfRange;
+  }
+  return(ret);
+}
+
+//==============================================================================
+/// Returns information about the use of the neighbour list.
+//==============================================================================
+std::string JDsNgListCpu::GetInfo()const{
+  const double nng=(Valid && NbMain? double(BeginNg[NbMain*2])/NbMain: 0);
+  return(fun::PrintStr("Neighbour list: %u builds and %u insertions/removals of particles in %u updates (skin=%g, neighbours per particle=%.1f)"
+    ,NumBuild,NumPatch,NumUpdate,Skin,nng));
+}
+
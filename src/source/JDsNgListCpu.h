@@ -0,0 +1,131 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//:#############################################################################
+//:# Cambios:
+//:# =========
+//:# - Lista de vecinos persistente (formato CSR) calculada con una distancia
+//:#   extra (skin) que se reutiliza entre pasos mientras el desplazamiento
+//:#   maximo de las particulas sea menor que skin/2. (17-10-2026)
+//:# - Las particulas nuevas (p.ej. inlet) y eliminadas (p.ej. outlet) se anhaden
+//:#   o quitan de la lista existente usando una zona de vecinos adicionales, sin
+//:#   crear de nuevo toda la lista. (17-10-2026)
+//:#############################################################################
+
+/// \file JDsNgListCpu.h \brief Declares the class \ref JDsNgListCpu.
+
+#ifndef _JDsNgListCpu_
+#define _JDsNgListCpu_
+
+#include "JObject.h"
+#include "DualSphDef.h"
+#include "JCellDivDataCpu.h"
+#include <string>
+#include <vector>
+
+class JLog2;
+
+//##############################################################################
+//# JDsNgListCpu
+//##############################################################################
+/// \brief Manages a persistent neighbour list (Verlet list with skin distance)
+/// for particle interaction on CPU.
+///
+/// The list is stored according to the particle order when it was built
+/// (build index) so the reorder of particles in cell division only updates
+/// the map between current and build indices.
+/// Particles created after the build (e.g. inlet particles) get new build
+/// indices and their neighbours are stored in the free space at the end of
+/// Ng[] (additional neighbours). Removed particles (e.g. outlet particles)
+/// are replaced in the lists of their neighbours by the neighbour itself,
+/// which is ignored in interaction (zero distance). The list is built again
+/// when the displacement exceeds Skin/2, when there are too many changes or
+/// when the free space of Ng[] is exhausted.
+
+class JDsNgListCpu : protected JObject
+{
+protected:
+  JLog2* Log;
+
+  bool Valid;          ///<The list can be used with current particles.
+  unsigned Np;         ///<Number of particles when the list was built.
+  unsigned Npb;        ///<Number of boundary particles when the list was built.
+
+  unsigned SizeNp;     ///<Number of particles with allocated memory.
+  unsigned *CurToBuild;  ///<Build index of each particle [SizeNp].
+  unsigned *BuildToCur;  ///<Current index of each build index [SizeNp].
+  unsigned *AuxIdx;      ///<Auxiliary memory to reorder CurToBuild[] [SizeNp].
+  tdouble3 *PosRef;      ///<Position of particles when the list was built (by build index) [SizeNp].
+  unsigned *BeginNg;     ///<First neighbour of bound and fluid segments of each build index [SizeNp*2+1].
+  tuint2 *OvfRange;      ///<Range in Ng[] of additional neighbours of bound and fluid segments of each build index [SizeNp*2].
+
+  unsigned NbMain;     ///<Number of build indices with neighbours in the main list (particles of last build).
+  unsigned NbDone;     ///<Number of build indices with neighbours (the rest are pending to insert).
+  unsigned NbTotal;    ///<Number of build indices in use.
+  std::vector<unsigned> PendingDel;  ///<Build indices of removed particles pending to remove from the list.
+
+  ullong SizeNg;       ///<Number of neighbours with allocated memory.
+  unsigned *Ng;        ///<Neighbours by build index [SizeNg].
+  unsigned NgUsed;     ///<Number of used positions in Ng[] (list and additional neighbours).
+
+  unsigned NumBuild;   ///<Number of list builds.
+  unsigned NumUpdate;  ///<Number of list checks.
+  unsigned NumPatch;   ///<Number of insertions and removals of particles without building the list.
+
+  static const unsigned PATCHFRAC=20;  ///<The list is built again when inserted and removed particles exceed Np/PATCHFRAC.
+
+  void Reset();
+  void AllocMemoryNp(unsigned np);
+  void AllocMemoryNg(ullong nng);
+
+  float ComputeMaxDisp2(unsigned np,const tdouble3 *pos)const;
+  void Build(unsigned np,unsigned npb,const StDivDataCpu &divdata
+    ,const unsigned *dcell,const tdouble3 *pos);
+  void ReplaceNg(unsigned b,unsigned bold,unsigned bnew);
+  bool AddNg(unsigned r,unsigned b);
+  bool Patch(unsigned npb,const StDivDataCpu &divdata,const unsigned *dcell,const tdouble3 *pos);
+
+public:
+  const float KernelSize;  ///<Maximum interaction distance between particles (KernelK*KernelH).
+  const float Skin;        ///<Extra distance to build the list.
+  const float RList2;      ///<Square of radius of list (KernelSize+Skin)^2.
+  const float MaxDisp2;    ///<Square of maximum displacement to rebuild the list (Skin/2)^2.
+  const float RInsert2;    ///<Square of radius to insert new particles (KernelSize+Skin*1.5)^2.
+
+public:
+  JDsNgListCpu(float kernelsize,float skin);
+  ~JDsNgListCpu();
+  llong GetAllocMemory()const;
+
+  void Update(unsigned np,unsigned npb,const StDivDataCpu &divdata
+    ,const unsigned *dcell,const tdouble3 *pos);
+  void SortParticles(unsigned npini,unsigned np,unsigned npb
+    ,unsigned pini,const unsigned *sortpart);
+
+  bool GetValid()const{ return(Valid); }
+  StNgListCpu GetNgList()const;
+
+  unsigned GetNumBuild()const{ return(NumBuild); }
+  unsigned GetNumUpdate()const{ return(NumUpdate); }
+  unsigned GetNumPatch()const{ return(NumPatch); }
+  std::string GetInfo()const;
+};
+
+#endif
+
+
@@ -0,0 +1,265 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file JDsPartWriter.cpp \brief Implements the class \ref JDsPartWriter.
+
+#include "JDsPartWriter.h"
+#include "Functions.h"
+#include <cstring>
+#include <algorithm>
+
+using namespace std;
+
+//##############################################################################
+//# JDsPartWriterSlot
+//##############################################################################
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JDsPartWriterSlot::JDsPartWriterSlot(){
+  ClassName="JDsPartWriterSlot";
+  Reset();
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JDsPartWriterSlot::~JDsPartWriterSlot(){
+  DestructorActive=true;
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables and frees memory.
+//==============================================================================
+void JDsPartWriterSlot::Reset(){
+  Arrays.Reset();
+  for(unsigned c=0;c<unsigned(Buffers.size());c++)delete[] Buffers[c];
+  Buffers.clear();
+  BufferSizes.clear();
+  Vdom.clear();
+  memset(&Info,0,sizeof(JSph::StPartSaveInfo));
+}
+
+//==============================================================================
+/// Copies data of PART to staging buffers. Buffers are only reallocated when
+/// they are too small.
+/// Copia datos del PART a los buffers. Los buffers solo se redimensionan cuando
+/// son demasiado pequenhos.
+//==============================================================================
+void JDsPartWriterSlot::CopyData(const JSph::StPartSaveInfo &info
+  ,const JDataArrays &arrays,unsigned ndom,const tdouble3 *vdom)
+{
+  Info=info;
+  Vdom.assign(vdom,vdom+ndom*2);
+  Arrays.Reset();
+  const unsigned na=arrays.Count();
+  for(unsigned ca=0;ca<na;ca++){
+    const JDataArrays::StDataArray &arr=arrays.GetArrayCte(ca);
+    const llong size=llong(SizeOfType(arr.type))*arr.count;
+    //-Allocates staging buffer when it is necessary.
+    if(ca>=unsigned(Buffers.size())){
+      Buffers.push_back(NULL);
+      BufferSizes.push_back(0);
+    }
+    if(BufferSizes[ca]<size){
+      delete[] Buffers[ca]; Buffers[ca]=NULL; BufferSizes[ca]=0;
+      try{
+        Buffers[ca]=new byte[size];
+      }
+      catch(const std::bad_alloc){
+        Run_Exceptioon(fun::PrintStr("Could not allocate the requested memory (%lld bytes).",size));
+      }
+      BufferSizes[ca]=size;
+    }
+    //-Copies data in parallel blocks.
+    byte *dst=Buffers[ca];
+    const byte *src=(const byte*)arr.ptr;
+    const llong sblock=(1<<20);
+    const int nblock=int((size+sblock-1)/sblock);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(nblock>1)
+    #endif
+    for(int cb=0;cb<nblock;cb++){
+      const llong ini=sblock*cb;
+      const llong fin=min(ini+sblock,size);
+      memcpy(dst+ini,src+ini,size_t(fin-ini));
+    }
+    Arrays.AddArray(arr.fullname,arr.type,arr.count,dst,false);
+  }
+}
+
+//==============================================================================
+/// Returns the allocated memory in staging buffers.
+//==============================================================================
+llong JDsPartWriterSlot::GetAllocMemory()const{
+  llong s=0;
+  for(unsigned c=0;c<unsigned(BufferSizes.size());c++)s+=BufferSizes[c];
+  return(s);
+}
+
+
+//##############################################################################
+//# JDsPartWriter
+//##############################################################################
+//==============================================================================
+/// Constructor. Starts the background thread.
+//==============================================================================
+JDsPartWriter::JDsPartWriter(JSph *sph,unsigned slotcount)
+  :Sph(sph),SlotCount(max(slotcount,1u))
+{
+  ClassName="JDsPartWriter";
+  Busy=false;
+  Stop=false;
+  for(unsigned c=0;c<SlotCount;c++){
+    Slots.push_back(new JDsPartWriterSlot());
+    Free.push_back(Slots[c]);
+  }
+  Worker=std::thread(&JDsPartWriter::ThreadLoop,this);
+}
+
+//==============================================================================
+/// Destructor. Waits for pending PARTs and stops the background thread.
+//==============================================================================
+JDsPartWriter::~JDsPartWriter(){
+  DestructorActive=true;
+  {
+    std::unique_lock<std::mutex> lock(Mtx);
+    CvFree.wait(lock,[this]{ return(Queue.empty() && !Busy); });
+    Stop=true;
+  }
+  CvQueue.notify_all();
+  if(Worker.joinable())Worker.join();
+  for(unsigned c=0;c<unsigned(Slots.size());c++)delete Slots[c];
+  Slots.clear();
+  Free.clear();
+}
+
+//==============================================================================
+/// Main loop of background thread. Stores the pending PARTs in order.
+/// Bucle principal del hilo en segundo plano. Graba los PARTs pendientes en orden.
+//==============================================================================
+void JDsPartWriter::ThreadLoop(){
+  for(;;){
+    JDsPartWriterSlot *slot=NULL;
+    {
+      std::unique_lock<std::mutex> lock(Mtx);
+      CvQueue.wait(lock,[this]{ return(Stop || !Queue.empty()); });
+      if(Queue.empty())break;
+      slot=Queue.front();
+      Queue.pop_front();
+      Busy=true;
+    }
+    //-Stores files of PART (ignored after a previous error).
+    string err;
+    bool skip;
+    {
+      std::lock_guard<std::mutex> lock(Mtx);
+      skip=!ErrorText.empty();
+    }
+    if(!skip){
+      try{
+        Sph->SavePartFiles(slot->Info,slot->Arrays,slot->GetNdom(),slot->Vdom.data());
+      }
+      catch(const std::exception &e){
+        err=e.what();
+        if(err.empty())err="Unknown error.";
+      }
+      catch(...){
+        err="Unknown error.";
+      }
+    }
+    {
+      std::lock_guard<std::mutex> lock(Mtx);
+      if(!err.empty() && ErrorText.empty())ErrorText=fun::PrintStr("Part_%04u: ",slot->Info.part)+err;
+      Free.push_back(slot);
+      Busy=false;
+    }
+    CvFree.notify_all();
+  }
+}
+
+//==============================================================================
+/// Throws exception when the background thread failed.
+/// Lanza excepcion cuando el hilo en segundo plano fallo.
+//==============================================================================
+void JDsPartWriter::CheckError(){
+  string err;
+  {
+    std::lock_guard<std::mutex> lock(Mtx);
+    err=ErrorText;
+  }
+  if(!err.empty())Run_Exceptioon(string("Error storing particle files in background. ")+err);
+}
+
+//==============================================================================
+/// Copies data of PART and queues it to be stored by background thread. It
+/// waits when all slots are pending to be stored.
+/// Copia los datos del PART y los encola para grabar en segundo plano. Espera
+/// cuando todos los slots estan pendientes de grabar.
+//==============================================================================
+void JDsPartWriter::AddPart(const JSph::StPartSaveInfo &info,const JDataArrays &arrays
+  ,unsigned ndom,const tdouble3 *vdom)
+{
+  CheckError();
+  //-Gets free slot (back-pressure). | Obtiene slot libre.
+  JDsPartWriterSlot *slot=NULL;
+  {
+    std::unique_lock<std::mutex> lock(Mtx);
+    CvFree.wait(lock,[this]{ return(!Free.empty()); });
+    slot=Free.back();
+    Free.pop_back();
+  }
+  //-Copies data to slot. | Copia datos al slot.
+  try{
+    slot->CopyData(info,arrays,ndom,vdom);
+  }
+  catch(...){
+    std::lock_guard<std::mutex> lock(Mtx);
+    Free.push_back(slot);
+    throw;
+  }
+  //-Queues slot. | Encola slot.
+  {
+    std::lock_guard<std::mutex> lock(Mtx);
+    Queue.push_back(slot);
+  }
+  CvQueue.notify_one();
+}
+
+//==============================================================================
+/// Waits until all pending PARTs are stored.
+/// Espera hasta que todos los PARTs pendientes esten grabados.
+//==============================================================================
+void JDsPartWriter::WaitAll(){
+  {
+    std::unique_lock<std::mutex> lock(Mtx);
+    CvFree.wait(lock,[this]{ return(Queue.empty() && !Busy); });
+  }
+  CheckError();
+}
+
+//==============================================================================
+/// Returns the allocated memory in staging buffers.
+//==============================================================================
+llong JDsPartWriter::GetAllocMemory()const{
+  llong s=0;
+  for(unsigned c=0;c<unsigned(Slots.size());c++)s+=Slots[c]->GetAllocMemory();
+  return(s);
+}
+
@@ -0,0 +1,107 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//:#############################################################################
+//:# Cambios:
+//:# =========
+//:# - Graba los ficheros de particulas (bi4, VTK y CSV) en un hilo en segundo
+//:#   plano usando copias de los datos en buffers reutilizables. (17-10-2026)
+//:#############################################################################
+
+/// \file JDsPartWriter.h \brief Declares the class \ref JDsPartWriter.
+
+#ifndef _JDsPartWriter_
+#define _JDsPartWriter_
+
+#include "JSph.h"
+#include "JObject.h"
+#include "JDataArrays.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+//##############################################################################
+//# JDsPartWriterSlot
+//##############################################################################
+/// \brief Staging copy of the data of one PART. Memory is reused between PARTs.
+
+class JDsPartWriterSlot : protected JObject
+{
+protected:
+  std::vector<byte*> Buffers;      ///<Staging buffers for arrays data.
+  std::vector<llong> BufferSizes;  ///<Allocated size of each staging buffer (in bytes).
+
+public:
+  JSph::StPartSaveInfo Info;   ///<Values of PART.
+  std::vector<tdouble3> Vdom;  ///<Limits of domains [ndom*2].
+  JDataArrays Arrays;          ///<Arrays with data in staging buffers.
+
+public:
+  JDsPartWriterSlot();
+  ~JDsPartWriterSlot();
+  void Reset();
+  void CopyData(const JSph::StPartSaveInfo &info,const JDataArrays &arrays
+    ,unsigned ndom,const tdouble3 *vdom);
+  unsigned GetNdom()const{ return(unsigned(Vdom.size()/2)); }
+  llong GetAllocMemory()const;
+};
+
+//##############################################################################
+//# JDsPartWriter
+//##############################################################################
+/// \brief Stores particle files of each PART using a background thread.
+
+class JDsPartWriter : protected JObject
+{
+protected:
+  JSph* Sph;                 ///<Object that stores the particle files.
+  const unsigned SlotCount;  ///<Maximum number of PARTs pending to store (queue depth).
+
+  std::vector<JDsPartWriterSlot*> Slots;  ///<Staging slots [SlotCount].
+  std::vector<JDsPartWriterSlot*> Free;   ///<Slots available to copy a new PART.
+  std::deque<JDsPartWriterSlot*> Queue;   ///<Slots pending to store.
+  bool Busy;                 ///<Background thread is storing one slot.
+  bool Stop;                 ///<Requests the end of background thread.
+  std::string ErrorText;     ///<Error in background thread.
+
+  std::mutex Mtx;
+  std::condition_variable CvQueue;  ///<Notifies new PARTs or end of execution.
+  std::condition_variable CvFree;   ///<Notifies stored PARTs.
+  std::thread Worker;
+
+  void ThreadLoop();
+  void CheckError();
+
+public:
+  JDsPartWriter(JSph *sph,unsigned slotcount);
+  ~JDsPartWriter();
+
+  void AddPart(const JSph::StPartSaveInfo &info,const JDataArrays &arrays
+    ,unsigned ndom,const tdouble3 *vdom);
+  void WaitAll();
+
+  unsigned GetSlotCount()const{ return(SlotCount); }
+  llong GetAllocMemory()const;
+};
+
+#endif
+
+
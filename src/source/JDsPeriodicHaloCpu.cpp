@@ -0,0 +1,367 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file JDsPeriodicHaloCpu.cpp \brief Implements the class \ref JDsPeriodicHaloCpu.
+
+#include "JDsPeriodicHaloCpu.h"
+#include "JLog2.h"
+#include "JAppInfo.h"
+#include "Functions.h"
+#include <cstring>
+#include <cmath>
+
+using namespace std;
+
+//##############################################################################
+//# JDsPeriodicHaloCpu
+//##############################################################################
+//==============================================================================
+/// Constructor.
+//==============================================================================
+JDsPeriodicHaloCpu::JDsPeriodicHaloCpu(const tdouble3 &mapposmin,const tdouble3 &mapposmax,double margin
+  ,bool perix,bool periy,bool periz
+  ,const tdouble3 &perixinc,const tdouble3 &periyinc,const tdouble3 &perizinc)
+  :Log(AppInfo.LogPtr()),MapPosMin(mapposmin),MapPosMax(mapposmax),Margin(margin)
+  ,ExtPosMin(mapposmin-margin),ExtPosMax(mapposmax+margin)
+  ,LimPosMin(mapposmin-margin*2),LimPosMax(mapposmax+margin*2)
+{
+  ClassName="JDsPeriodicHaloCpu";
+  PeriAxis[0]=perix;   PeriAxis[1]=periy;   PeriAxis[2]=periz;
+  PeriInc[0]=perixinc; PeriInc[1]=periyinc; PeriInc[2]=perizinc;
+  SizeHalo=0;
+  PerIdx=NULL; SrcIdx=NULL;
+  SizeNp=0;
+  AuxIdx=NULL; HaloAxis=NULL; HaloSrc=NULL;
+  Reset();
+}
+
+//==============================================================================
+/// Destructor.
+//==============================================================================
+JDsPeriodicHaloCpu::~JDsPeriodicHaloCpu(){
+  DestructorActive=true;
+  Reset();
+}
+
+//==============================================================================
+/// Initialisation of variables and frees memory.
+//==============================================================================
+void JDsPeriodicHaloCpu::Reset(){
+  Valid=false;
+  Np=0;
+  SizeHalo=Count=0;
+  delete[] PerIdx; PerIdx=NULL;
+  delete[] SrcIdx; SrcIdx=NULL;
+  GroupsCount=0;
+  SizeNp=0;
+  delete[] AuxIdx;   AuxIdx=NULL;
+  delete[] HaloAxis; HaloAxis=NULL;
+  delete[] HaloSrc;  HaloSrc=NULL;
+  NumBuild=NumUpdate=0;
+}
+
+//==============================================================================
+/// Returns the allocated memory.
+//==============================================================================
+llong JDsPeriodicHaloCpu::GetAllocMemory()const{
+  llong s=0;
+  s+=llong(sizeof(unsigned)*2)*SizeHalo;
+  s+=llong(sizeof(unsigned)+sizeof(byte)*2)*SizeNp;
+  return(s);
+}
+
+//==============================================================================
+/// Allocates memory for entries of the halo keeping current data.
+/// Reserva memoria para entradas del halo manteniendo los datos actuales.
+//==============================================================================
+void JDsPeriodicHaloCpu::AllocMemoryHalo(unsigned n){
+  if(n>SizeHalo){
+    const unsigned size=n+n/10+1000;
+    unsigned *peridx=NULL,*srcidx=NULL;
+    try{
+      peridx=new unsigned[size];
+      srcidx=new unsigned[size];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Could not allocate the requested memory for periodic halo of %u particles.",size));
+    }
+    if(Count){
+      memcpy(peridx,PerIdx,sizeof(unsigned)*Count);
+      memcpy(srcidx,SrcIdx,sizeof(unsigned)*Count);
+    }
+    delete[] PerIdx; PerIdx=peridx;
+    delete[] SrcIdx; SrcIdx=srcidx;
+    SizeHalo=size;
+  }
+}
+
+//==============================================================================
+/// Allocates memory for particles when it is necessary.
+/// Reserva memoria para particulas cuando es necesario.
+//==============================================================================
+void JDsPeriodicHaloCpu::AllocMemoryNp(unsigned np){
+  if(np>SizeNp){
+    delete[] AuxIdx;   AuxIdx=NULL;
+    delete[] HaloAxis; HaloAxis=NULL;
+    delete[] HaloSrc;  HaloSrc=NULL;
+    SizeNp=0;
+    const unsigned size=np+np/10;
+    try{
+      AuxIdx  =new unsigned[size];
+      HaloAxis=new byte[size];
+      HaloSrc =new byte[size];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon(fun::PrintStr("Could not allocate the requested memory for periodic halo of %u particles.",size));
+    }
+    memset(HaloAxis,0,sizeof(byte)*size);
+    memset(HaloSrc,0,sizeof(byte)*size);
+    SizeNp=size;
+  }
+}
+
+//==============================================================================
+/// Starts a new full generation of the halo without periodic particles.
+/// Inicia una nueva generacion completa del halo sin particulas periodicas.
+//==============================================================================
+void JDsPeriodicHaloCpu::Clear(){
+  Valid=true;
+  Np=0;
+  Count=0;
+  GroupsCount=0;
+  NumBuild++;
+}
+
+//==============================================================================
+/// Adds a group of count new periodic particles created starting from pini
+/// according to list of source particles listp[] (see RunPeriodic()).
+/// Anhade un grupo de count nuevas particulas periodicas creadas a partir de
+/// pini segun la lista de particulas origen listp[] (ver RunPeriodic()).
+//==============================================================================
+void JDsPeriodicHaloCpu::AddGroup(unsigned axis,unsigned count,unsigned pini,const unsigned *listp){
+  if(GroupsCount>=GROUPSMAX)Run_Exceptioon("Number of groups of periodic halo is invalid.");
+  AllocMemoryHalo(Count+count);
+  StGroup &g=Groups[GroupsCount++];
+  g.ini=Count;
+  g.count=count;
+  g.axis=axis;
+  for(unsigned p=0;p<count;p++){
+    PerIdx[Count+p]=pini+p;
+    SrcIdx[Count+p]=listp[p];
+  }
+  Count+=count;
+}
+
+//==============================================================================
+/// Updates indices according to the new order of particles after cell division.
+/// The halo becomes invalid when some particle of the halo was excluded.
+/// Actualiza indices segun el nuevo orden de las particulas tras el divide.
+/// El halo se invalida cuando alguna particula del halo fue excluida.
+//==============================================================================
+void JDsPeriodicHaloCpu::SortParticles(unsigned npini,unsigned np,unsigned pini,const unsigned *sortpart){
+  if(Valid){
+    AllocMemoryNp(npini);
+    const int ini=int(pini),n=int(npini);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=ini;p<n;p++)AuxIdx[sortpart[p]]=unsigned(p);
+    const int nh=int(Count);
+    int nout=0;
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) reduction(+:nout) if(nh>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int c=0;c<nh;c++){
+      const unsigned pp=PerIdx[c];
+      const unsigned rs=SrcIdx[c];
+      const unsigned ps=(rs&0x7FFFFFFF);
+      const unsigned pp2=(pp<pini? pp: AuxIdx[pp]);
+      const unsigned ps2=(ps<pini? ps: AuxIdx[ps]);
+      if(pp2>=np || ps2>=np)nout++;
+      PerIdx[c]=pp2;
+      SrcIdx[c]=(ps2|(rs&0x80000000));
+    }
+    if(nout)Valid=false;
+    Np=np;
+  }
+}
+
+//==============================================================================
+/// Changes the direction of the periodic particles of group cg whose source
+/// particle crossed the periodic limit, so the periodic particle is created
+/// on the other side of the domain. It must be called before updating the
+/// periodic particles of the group.
+/// Cambia el sentido de las periodicas del grupo cg cuya particula origen
+/// cruzo el limite periodico, de forma que la periodica se crea en el otro
+/// lado del dominio. Debe llamarse antes de actualizar las periodicas del 
+/// grupo.
+//==============================================================================
+void JDsPeriodicHaloCpu::UpdateGroupDirection(unsigned cg,const tdouble3 *pos){
+  const StGroup &g=Groups[cg];
+  const tdouble3 perinc=PeriInc[g.axis];
+  const int cini=int(g.ini),cfin=int(g.ini+g.count);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(cfin-cini>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int c=cini;c<cfin;c++){
+    const unsigned rs=SrcIdx[c];
+    const bool inverse=(rs>=0x80000000);
+    const tdouble3 ps=pos[rs&0x7FFFFFFF];
+    if(!PosInsideLim(inverse? ps-perinc: ps+perinc) && PosInsideLim(inverse? ps+perinc: ps-perinc))SrcIdx[c]=(rs^0x80000000);
+  }
+}
+
+//==============================================================================
+/// Checks that the periodic particles updated from their sources are inside
+/// of the domain extended by 2*Margin and the source particles are not 
+/// excluded.
+/// Comprueba que las periodicas actualizadas desde sus origenes estan dentro
+/// del dominio ampliado con 2*Margin y que las particulas origen no estan 
+/// excluidas.
+//==============================================================================
+bool JDsPeriodicHaloCpu::CheckPeriodic(const tdouble3 *pos,const typecode *code)const{
+  const int nh=int(Count);
+  int nerr=0;
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) reduction(+:nerr) if(nh>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int c=0;c<nh;c++){
+    const unsigned ps=(SrcIdx[c]&0x7FFFFFFF);
+    if(!CODE_IsNotOut(code[ps]) || !PosInsideLim(pos[PerIdx[c]]))nerr++;
+  }
+  return(nerr==0);
+}
+
+//==============================================================================
+/// Marks periodic particles with their axis (HaloAxis[]) and source particles
+/// with their axis and direction (HaloSrc[]) or clears the marks. Returns 
+/// false when some source particle is duplicated twice in the same direction.
+/// Marca las periodicas con su eje (HaloAxis[]) y las particulas origen con
+/// su eje y sentido (HaloSrc[]) o borra las marcas. Devuelve false cuando 
+/// alguna particula origen se duplica dos veces en el mismo sentido.
+//==============================================================================
+bool JDsPeriodicHaloCpu::MarkHalo(bool clear){
+  bool ok=true;
+  for(unsigned cg=0;cg<GroupsCount;cg++){
+    const StGroup &g=Groups[cg];
+    const unsigned cfin=g.ini+g.count;
+    for(unsigned c=g.ini;c<cfin;c++){
+      const unsigned rs=SrcIdx[c];
+      const unsigned ps=(rs&0x7FFFFFFF);
+      if(clear)HaloAxis[PerIdx[c]]=HaloSrc[ps]=0;
+      else{
+        const byte srcbit=byte(1<<(g.axis*2+(rs>=0x80000000? 1: 0)));
+        if(HaloSrc[ps]&srcbit)ok=false;
+        HaloAxis[PerIdx[c]]=byte(g.axis+1);
+        HaloSrc[ps]|=srcbit;
+      }
+    }
+  }
+  return(ok);
+}
+
+//==============================================================================
+/// Returns number of particles in range [pini,pfin) that must be duplicated
+/// in direction cdir of axis but they are not sources of the halo. Only 
+/// original particles and periodic particles created in previous axes are
+/// considered (like in RunPeriodic()).
+///
+/// Devuelve numero de particulas del rango [pini,pfin) que deben duplicarse
+/// en el sentido cdir del eje pero no son origenes del halo. Solo se 
+/// consideran particulas originales y periodicas creadas en ejes previos 
+/// (como en RunPeriodic()).
+//==============================================================================
+unsigned JDsPeriodicHaloCpu::CountMissing(unsigned pini,unsigned pfin,unsigned axis
+  ,unsigned cdir,const tdouble3 *pos,const typecode *code)const
+{
+  const tdouble3 inc=(cdir? PeriInc[axis]*-1.: PeriInc[axis]);
+  const byte srcbit=byte(1<<(axis*2+cdir));
+  unsigned count=0;
+  for(unsigned p=pini;p<pfin;p++){
+    const byte ax=HaloAxis[p];
+    if(!(HaloSrc[p]&srcbit) && CODE_IsNotOut(code[p]) && (!ax || unsigned(ax)<=axis) && PosInside(pos[p]+inc))count++;
+  }
+  return(count);
+}
+
+//==============================================================================
+/// Checks that all the particles that must be duplicated are sources of the 
+/// halo. Only the cells close to periodic limits are checked and the 
+/// periodic particles of the halo were checked before (see CheckPeriodic()).
+///
+/// Comprueba que todas las particulas que deben duplicarse son origenes del
+/// halo. Solo se comprueban las celdas cercanas a los limites periodicos y 
+/// las periodicas del halo se comprobaron antes (ver CheckPeriodic()).
+//==============================================================================
+bool JDsPeriodicHaloCpu::CheckSources(unsigned np,const StDivDataCpu &divdata
+  ,const tdouble3 *pos,const typecode *code)
+{
+  if(!Valid || np!=Np)return(false);
+  AllocMemoryNp(np);
+  //-Counts particles that must be duplicated but they are not sources. | Cuenta particulas que deben duplicarse pero no son origenes.
+  const double scell=divdata.scell;
+  const unsigned cbi=divdata.cellfluid-1; //-Cell of ignored boundary particles. | Celda de particulas de contorno ignoradas.
+  unsigned nmiss=(MarkHalo(false)? 0: 1);
+  for(unsigned axis=0;axis<3 && !nmiss;axis++)if(PeriAxis[axis]){
+    for(unsigned cdir=0;cdir<2 && !nmiss;cdir++){
+      //-Cells where periodic particles are inside of the domain. | Celdas donde las periodicas estan dentro del dominio.
+      const tdouble3 inc=(cdir? PeriInc[axis]*-1.: PeriInc[axis]);
+      const tdouble3 bmin=MaxValues(MapPosMin,MapPosMin-inc)-divdata.domposmin;
+      const tdouble3 bmax=MinValues(MapPosMax,MapPosMax-inc)-divdata.domposmin;
+      if(bmin.x<bmax.x && bmin.y<bmax.y && bmin.z<bmax.z){
+        const int cxini=max(int(floor(bmin.x/scell))-divdata.cellzero.x-1,0);
+        const int cyini=max(int(floor(bmin.y/scell))-divdata.cellzero.y-1,0);
+        const int czini=max(int(floor(bmin.z/scell))-divdata.cellzero.z-1,0);
+        const int cxfin=min(int(floor(bmax.x/scell))-divdata.cellzero.x+2,divdata.nc.x);
+        const int cyfin=min(int(floor(bmax.y/scell))-divdata.cellzero.y+2,divdata.nc.y);
+        const int czfin=min(int(floor(bmax.z/scell))-divdata.cellzero.z+2,divdata.nc.z);
+        if(cxini<cxfin && cyini<cyfin && czini<czfin){
+          const int ny=cyfin-cyini;
+          const int nrows=ny*(czfin-czini);
+          unsigned nmissdir=0;
+          #ifdef OMP_USE
+            #pragma omp parallel for schedule (dynamic,8) reduction(+:nmissdir)
+          #endif
+          for(int cr=0;cr<nrows;cr++){
+            const int y=cyini+cr%ny,z=czini+cr/ny;
+            const int v=DivDataCpuRowCell(divdata,y,z);
+            for(unsigned tpfluid=0;tpfluid<2;tpfluid++){
+              const int v2=v+(tpfluid? int(divdata.cellfluid): 0);
+              nmissdir+=CountMissing(divdata.begincell[v2+cxini],divdata.begincell[v2+cxfin],axis,cdir,pos,code);
+            }
+          }
+          nmiss+=nmissdir;
+        }
+      }
+      //-Ignored boundary particles out of cells. | Particulas de contorno ignoradas fuera de las celdas.
+      nmiss+=CountMissing(divdata.begincell[cbi],divdata.begincell[cbi+1],axis,cdir,pos,code);
+    }
+  }
+  MarkHalo(true);
+  NumUpdate++;
+  if(nmiss)Valid=false;
+  return(Valid);
+}
+
+//==============================================================================
+/// Returns information about the use of the periodic halo.
+//==============================================================================
+std::string JDsPeriodicHaloCpu::GetInfo()const{
+  return(fun::PrintStr("Periodic halo: %u full generations in %u updates (margin=%g, periodic particles=%u)"
+    ,NumBuild,NumUpdate,Margin,Count));
+}
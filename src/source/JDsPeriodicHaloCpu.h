@@ -0,0 +1,140 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//:#############################################################################
+//:# Cambios:
+//:# =========
+//:# - Halo de particulas periodicas persistente que se actualiza copiando los
+//:#   datos de las particulas origen y solo se recrea cuando cambian las
+//:#   particulas que deben duplicarse. (17-10-2026)
+//:#############################################################################
+
+/// \file JDsPeriodicHaloCpu.h \brief Declares the class \ref JDsPeriodicHaloCpu.
+
+#ifndef _JDsPeriodicHaloCpu_
+#define _JDsPeriodicHaloCpu_
+
+#include "JObject.h"
+#include "DualSphDef.h"
+#include "JCellDivDataCpu.h"
+#include <string>
+
+class JLog2;
+
+//##############################################################################
+//# JDsPeriodicHaloCpu
+//##############################################################################
+/// \brief Manages a persistent halo of periodic particles on CPU.
+///
+/// Stores the periodic particles created by the last full generation and the
+/// particles they were duplicated from (source particles), so between
+/// generations the periodic particles are only updated from their sources.
+/// The full generation also duplicates the particles whose periodic particle
+/// falls up to Margin outside the domain, so the halo remains valid while all
+/// the particles that must be duplicated are sources of the halo and all the
+/// periodic particles of the halo are inside the domain extended by 2*Margin.
+/// Both conditions only fail when some particle moves more than Margin since
+/// the last full generation. Periodic particles out of the domain are further
+/// than KernelSize from the real domain so they do not change the results.
+/// Indices are updated with the reorder of particles in cell division.
+
+class JDsPeriodicHaloCpu : protected JObject
+{
+public:
+  ///Structure with a group of periodic particles created in the same axis.
+  typedef struct{
+    unsigned ini;     ///<First entry of the group.
+    unsigned count;   ///<Number of entries of the group.
+    unsigned axis;    ///<Periodic axis (0:X, 1:Y, 2:Z).
+  }StGroup;
+
+protected:
+  JLog2* Log;
+
+  bool Valid;          ///<The halo can be used with current particles.
+  unsigned Np;         ///<Number of particles after last cell division.
+
+  unsigned SizeHalo;   ///<Number of entries with allocated memory.
+  unsigned Count;      ///<Number of periodic particles in the halo.
+  unsigned *PerIdx;    ///<Index of each periodic particle [SizeHalo].
+  unsigned *SrcIdx;    ///<Index of source particle of each periodic particle with the direction in the last bit [SizeHalo].
+
+  static const unsigned GROUPSMAX=12; ///<Maximum number of groups (bound/fluid, 3 axes, new/original particles).
+  unsigned GroupsCount;
+  StGroup Groups[GROUPSMAX];  ///<Groups of entries created in the same axis.
+
+  unsigned SizeNp;     ///<Number of particles with allocated memory.
+  unsigned *AuxIdx;    ///<New index of each particle after cell division [SizeNp].
+  byte *HaloAxis;      ///<Axis+1 of periodic particles in the halo and 0 for the rest [SizeNp].
+  byte *HaloSrc;       ///<Axis and direction (bit axis*2+inverse) of source particles in the halo [SizeNp].
+
+  bool PeriAxis[3];     ///<Periodic conditions in X, Y and Z.
+  tdouble3 PeriInc[3];  ///<Value added to positions for periodic conditions in X, Y and Z.
+
+  unsigned NumBuild;   ///<Number of full generations of the halo.
+  unsigned NumUpdate;  ///<Number of updates of the halo.
+
+  void AllocMemoryHalo(unsigned n);
+  void AllocMemoryNp(unsigned np);
+  /// Returns true when position ps is inside of the simulation domain.
+  inline bool PosInside(const tdouble3 &ps)const{ return(MapPosMin<=ps && ps<MapPosMax); }
+  /// Returns true when position ps is inside of the simulation domain extended by 2*Margin.
+  inline bool PosInsideLim(const tdouble3 &ps)const{ return(LimPosMin<=ps && ps<LimPosMax); }
+  bool MarkHalo(bool clear);
+  unsigned CountMissing(unsigned pini,unsigned pfin,unsigned axis,unsigned cdir
+    ,const tdouble3 *pos,const typecode *code)const;
+
+public:
+  const tdouble3 MapPosMin;  ///<Lower limit of simulation domain.
+  const tdouble3 MapPosMax;  ///<Upper limit of simulation domain.
+  const double Margin;       ///<Extra distance outside the domain to create periodic particles of the halo.
+  const tdouble3 ExtPosMin;  ///<Lower limit of simulation domain extended by Margin.
+  const tdouble3 ExtPosMax;  ///<Upper limit of simulation domain extended by Margin.
+  const tdouble3 LimPosMin;  ///<Lower limit of periodic particles of the halo (domain extended by 2*Margin).
+  const tdouble3 LimPosMax;  ///<Upper limit of periodic particles of the halo (domain extended by 2*Margin).
+
+public:
+  JDsPeriodicHaloCpu(const tdouble3 &mapposmin,const tdouble3 &mapposmax,double margin
+    ,bool perix,bool periy,bool periz
+    ,const tdouble3 &perixinc,const tdouble3 &periyinc,const tdouble3 &perizinc);
+  ~JDsPeriodicHaloCpu();
+  void Reset();
+  llong GetAllocMemory()const;
+
+  void Clear();
+  void AddGroup(unsigned axis,unsigned count,unsigned pini,const unsigned *listp);
+  void SortParticles(unsigned npini,unsigned np,unsigned pini,const unsigned *sortpart);
+  void UpdateGroupDirection(unsigned cg,const tdouble3 *pos);
+  bool CheckPeriodic(const tdouble3 *pos,const typecode *code)const;
+  bool CheckSources(unsigned np,const StDivDataCpu &divdata,const tdouble3 *pos,const typecode *code);
+  void Invalidate(){ Valid=false; }
+
+  bool GetValid()const{ return(Valid); }
+  unsigned GetNp()const{ return(Np); }
+  unsigned GetCount()const{ return(Count); }
+  unsigned GetGroupsCount()const{ return(GroupsCount); }
+  const StGroup& GetGroup(unsigned c)const{ return(Groups[c]); }
+  const unsigned* GetPerIdx()const{ return(PerIdx); }
+  const unsigned* GetSrcIdx()const{ return(SrcIdx); }
+
+  std::string GetInfo()const;
+};
+
+#endif
+
+
@@ -40,12 +40,16 @@ using namespace std;
 //==============================================================================
 /// Constructor.
 //==============================================================================
-JDsPips::JDsPips(bool cpu,unsigned stepsnum,bool svdata,unsigned ntimes)
+JDsPips::JDsPips(bool cpu,unsigned stepsnum,bool svdata,unsigned ntimes,bool counters)
   :Log(AppInfo.LogPtr()),Cpu(cpu),StepsNum(stepsnum),SvData(svdata),Ntimes(ntimes)
+  ,Counters(cpu && counters)
 {
   ClassName="JDsPips";
   NextNstep=0;
   NewData=0;
+  StepInter=0;
+  StepPirf=StepPirb=StepPicf=StepPicb=0;
+  TotPirf=TotPirb=TotPicf=TotPicb=0;
   SizeResultAux=0;
   ResultAux=NULL;
   //Reset();
@@ -145,6 +149,7 @@ void JDsPips::SaveData(){
 /// Returns total PIs of fluid and boundary.
 //==============================================================================
 tdouble2 JDsPips::GetTotalPIs()const{
+  if(Counters)return(TDouble2(double(TotPirf)/1e9,double(TotPirb)/1e9));
   const unsigned ndata=unsigned(Data.size());
   double totgpisf=0,totgpisb=0;
   for(unsigned c=1;c<ndata;c++){
@@ -181,79 +186,132 @@ std::string JDsPips::GetTotalPIsInfo()const{
   return(fun::PrintStr("%s %cPIs (%.4e + %.4e)",vn.c_str(),unit,totgpis.x*1e9,totgpis.y*1e9));
 }
 
+//==============================================================================
+/// Returns ratio between real and checked PIs as string.
+/// Returns: 45.12% (fluid: 44.10%, bound: 60.20%)
+//==============================================================================
+std::string JDsPips::GetHitRatioInfo()const{
+  const unsigned ndata=unsigned(Data.size());
+  double rf=0,rb=0,cf=0,cb=0;
+  if(Counters){
+    rf=double(TotPirf); rb=double(TotPirb);
+    cf=double(TotPicf); cb=double(TotPicb);
+  }
+  else for(unsigned c=1;c<ndata;c++){
+    rf+=GetGPIsType(c,true);
+    rb+=GetGPIsType(c,false);
+    cf+=GetCheckGPIsType(c,true);
+    cb+=GetCheckGPIsType(c,false);
+  }
+  const double r =(cf+cb>0? (rf+rb)*100./(cf+cb): 0);
+  const double rfl=(cf>0? rf*100./cf: 0);
+  const double rbo=(cb>0? rb*100./cb: 0);
+  return(fun::PrintStr("%.2f%% (fluid: %.2f%%, bound: %.2f%%)",r,rfl,rbo));
+}
+
+//==============================================================================
+/// Adds the PIs counted in one force interaction.
+/// Suma las PIs contadas en una interaccion de fuerzas.
+//==============================================================================
+void JDsPips::AddInteraction(ullong pirf,ullong pirb,ullong picf,ullong picb){
+  StepInter++;
+  StepPirf+=pirf; StepPirb+=pirb;
+  StepPicf+=picf; StepPicb+=picb;
+  TotPirf+=pirf;  TotPirb+=pirb;
+  TotPicf+=picf;  TotPicb+=picb;
+}
+
+//==============================================================================
+/// Stores the average PIs per interaction counted since last stored data.
+/// Graba la media de PIs por interaccion contadas desde los ultimos datos.
+//==============================================================================
+void JDsPips::ComputeCounters(unsigned nstep,double tstep,double tsim){
+  if(StepInter){
+    StPipsInfo v;
+    v.nstep=nstep;
+    v.tstep=tstep;
+    v.tsim= tsim;
+    v.pirf=StepPirf/StepInter;
+    v.pirb=StepPirb/StepInter;
+    v.picf=StepPicf/StepInter;
+    v.picb=StepPicb/StepInter;
+    Data.push_back(v);
+    StepInter=0;
+    StepPirf=StepPirb=StepPicf=StepPicb=0;
+    NextNstep+=StepsNum;
+  }
+}
+
 //==============================================================================
 /// Compute number of particle interactions on CPU.
 //==============================================================================
 void JDsPips::ComputeCpu(unsigned nstep,double tstep,double tsim
-  ,const StCteSph &csp,int ompthreads
+  ,const StCteSph &csp
   ,unsigned np,unsigned npb,unsigned npbok
-  ,const StDivDataCpu &dvd,const unsigned *dcell,const tdouble3 *pos)
+  ,const StDivDataCpu &dvd,const unsigned *dcell,const tdouble3 *pos
+  ,const StNgListCpu &ngl)
 {
-  //-Compute bound & fluid PIs.
-  ullong npith[OMP_MAXTHREADS*OMP_STRIDE];
-  memset(npith,0,sizeof(ullong)*OMP_MAXTHREADS*OMP_STRIDE);
+  //-Compute bound & fluid PIs (checked PIs are neighbour list entries when it is used).
+  const bool usengl=(ngl.ng!=NULL);
+  ullong picb=0,pirb=0,picf=0,pirf=0;
   //-Counts bound PIs;
   const int inpbok=int(npbok);
   #ifdef OMP_USE
-    #pragma omp parallel for schedule (guided)
+    #pragma omp parallel for schedule (guided) reduction(+:picb,pirb)
   #endif
   for(int p1=0;p1<inpbok;p1++){
-    unsigned picb=0,pirb=0;
+    unsigned picbp1=0,pirbp1=0;
     const tdouble3 posp1=pos[p1];
-    //-Search for fluid neighbours in adjacent cells.
-    const StNgSearch ngs=nsearch::Init(dcell[p1],false,dvd);
+    //-Search for fluid neighbours in adjacent cells or in neighbour list.
+    const StNgSearch ngs=(usengl? nsearch::InitNgList(): nsearch::Init(dcell[p1],false,dvd));
     for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
-      const tuint2 pif=nsearch::ParticleRange(y,z,ngs,dvd);
-      for(unsigned p2=pif.x;p2<pif.y;p2++){
+      const tuint2 pif=(usengl? nsearch::ParticleRangeNgList(y,p1,false,ngl): nsearch::ParticleRange(y,z,ngs,dvd));
+      for(unsigned cp2=pif.x;cp2<pif.y;cp2++){
+        const unsigned p2=(usengl? ngl.buildtocur[ngl.ng[cp2]]: cp2);
         const float rr2=nsearch::Distance2(posp1,pos[p2]);
-        if(rr2<=csp.kernelsize2 && rr2>=ALMOSTZERO)pirb++;
-        picb++;
+        if(rr2<=csp.kernelsize2 && rr2>=ALMOSTZERO)pirbp1++;
+        picbp1++;
       }
     }
     //-Sum results.
-    const int cth=omp_get_thread_num()*OMP_STRIDE;
-    npith[cth  ]+=picb;
-    npith[cth+1]+=pirb;
+    picb+=picbp1;
+    pirb+=pirbp1;
   }
   //-Counts fluid PIs;
   const int inpb=int(npb);
   const int inp =int(np);
   #ifdef OMP_USE
-    #pragma omp parallel for schedule (guided)
+    #pragma omp parallel for schedule (guided) reduction(+:picf,pirf)
   #endif
   for(int p1=inpb;p1<inp;p1++){
-    unsigned picf=0,pirf=0;
+    unsigned picfp1=0,pirfp1=0;
     const tdouble3 posp1=pos[p1];
     //-Search for bound & fluid neighbours in adjacent cells.
     for(byte tpfluid=0;tpfluid<=1;tpfluid++){
-      const StNgSearch ngs=nsearch::Init(dcell[p1],!tpfluid,dvd);
+      const StNgSearch ngs=(usengl? nsearch::InitNgList(): nsearch::Init(dcell[p1],!tpfluid,dvd));
       for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
-        const tuint2 pif=nsearch::ParticleRange(y,z,ngs,dvd);
-        for(unsigned p2=pif.x;p2<pif.y;p2++){
+        const tuint2 pif=(usengl? nsearch::ParticleRangeNgList(y,p1,!tpfluid,ngl): nsearch::ParticleRange(y,z,ngs,dvd));
+        for(unsigned cp2=pif.x;cp2<pif.y;cp2++){
+          const unsigned p2=(usengl? ngl.buildtocur[ngl.ng[cp2]]: cp2);
           const float rr2=nsearch::Distance2(posp1,pos[p2]);
-          if(rr2<=csp.kernelsize2 && rr2>=ALMOSTZERO)pirf++;
-          picf++;
+          if(rr2<=csp.kernelsize2 && rr2>=ALMOSTZERO)pirfp1++;
+          picfp1++;
         }
       }
     }
     //-Sum results.
-    const int cth=omp_get_thread_num()*OMP_STRIDE;
-    npith[cth+2]+=picf;
-    npith[cth+3]+=pirf;
+    picf+=picfp1;
+    pirf+=pirfp1;
   }
   //-Sum total results.
   StPipsInfo v;
   v.nstep=nstep;
   v.tstep=tstep;
   v.tsim= tsim;
-  v.pirf=v.pirb=v.picf=v.picb=0;
-  for(int th=0;th<ompthreads;th++){
-    int cth=th*OMP_STRIDE;
-    v.picb+=npith[cth++];
-    v.pirb+=npith[cth++];
-    v.picf+=npith[cth++];
-    v.pirf+=npith[cth  ];
-  }
+  v.picb=picb;
+  v.pirb=pirb;
+  v.picf=picf;
+  v.pirf=pirf;
   //-Stores results.
   Data.push_back(v);
   NextNstep+=StepsNum;
@@ -21,6 +21,8 @@
 //:# =========
 //:# - Contabiliza numero de interacciones entre particulas para calcular PIPS
 //:#   (Particle Interactions Per Second). 03-06-2020
+//:# - Opcion para contar las interacciones en el propio calculo de fuerzas en
+//:#   CPU en todos los pasos. (17-10-2026)
 //:#############################################################################
 
 /// \file JDsPips.h \brief Declares the class \ref JDsPips.
@@ -68,6 +70,11 @@ protected:
   std::vector<StPipsInfo> Data;
   unsigned NewData;
 
+  //-Exact counters from force interaction (only with Counters).
+  unsigned StepInter;  ///<Number of force interactions since last stored data.
+  ullong StepPirf,StepPirb,StepPicf,StepPicb;  ///<Counters since last stored data.
+  ullong TotPirf,TotPirb,TotPicf,TotPicb;      ///<Counters of the whole simulation.
+
   unsigned SizeResultAux;
   ullong* ResultAux;  //-To copy final result from GPU memory. [SizeResultAux]
 
@@ -82,9 +89,10 @@ public:
   const unsigned StepsNum;  ///<Number of steps per interval to compute PIPS.
   const bool SvData;        ///<Store and save all data.
   const unsigned Ntimes;    ///<Interaction number per step (Verlet:1, Symplectic:2).
+  const bool Counters;      ///<PIs are counted in every force interaction instead of sampled (CPU only).
 
 public:
-  JDsPips(bool cpu,unsigned stepsnum,bool svdata,unsigned ntimes);
+  JDsPips(bool cpu,unsigned stepsnum,bool svdata,unsigned ntimes,bool counters=false);
   ~JDsPips();
   long long GetAllocMemory()const;
 
@@ -92,13 +100,18 @@ public:
 
   double GetGPIPS(double tsim)const;
   std::string GetTotalPIsInfo()const;
+  std::string GetHitRatioInfo()const;
 
   bool CheckRun(unsigned nstep)const{ return(nstep>=NextNstep); }
 
+  void AddInteraction(ullong pirf,ullong pirb,ullong picf,ullong picb);
+  void ComputeCounters(unsigned nstep,double tstep,double tsim);
+
   void ComputeCpu(unsigned nstep,double tstep,double tsim
-    ,const StCteSph &csp,int ompthreads
+    ,const StCteSph &csp
     ,unsigned np,unsigned npb,unsigned npbok
-    ,const StDivDataCpu &dvd,const unsigned *dcell,const tdouble3 *pos);
+    ,const StDivDataCpu &dvd,const unsigned *dcell,const tdouble3 *pos
+    ,const StNgListCpu &ngl);
 
 #ifdef _WITHGPU
   void ComputeGpu(unsigned nstep,double tstep,double tsim
@@ -21,6 +21,10 @@
 #include "JDsTimers.h"
 #include "Functions.h"
 #include "JLog2.h"
+#include "JSaveCsv2.h"
+#include <fstream>
+#include <cstring>
+#include <algorithm>
 
 using namespace std;
 
@@ -33,6 +37,7 @@ using namespace std;
 JDsTimers::JDsTimers(std::string classname){
   ClassName=classname;
   List=new StDsTimer[TIMERSIZE];
+  ThTime=NULL;
   Reset();
 }
 
@@ -43,6 +48,7 @@ JDsTimers::~JDsTimers(){
   DestructorActive=true;
   Reset();
   delete[] List; List=NULL;
+  delete[] ThTime; ThTime=NULL;
 }
 
 //==============================================================================
@@ -52,6 +58,8 @@ void JDsTimers::Reset(){
   for(int c=0;c<TIMERSIZE;c++)ResetTimer(c);
   CtMax=0;
   SvTimers=false;
+  delete[] ThTime; ThTime=NULL;
+  ThreadsNum=0;
 }
 
 //==============================================================================
@@ -63,6 +71,8 @@ void JDsTimers::ResetTimer(unsigned c){
   t.timer.Reset();
   t.time=0;
   t.level=0;
+  t.parent=-1;
+  t.thread=false;
   t.name="";
 }
 
@@ -79,13 +89,94 @@ void JDsTimers::AddTimer(unsigned c,std::string name,unsigned level,bool active)
   if(c>CtMax)CtMax=c;
 }
 
+//==============================================================================
+/// Add timer to list as a sub-phase of parent timer (parent must be defined).
+/// When thread is true, busy time of each thread is also recorded.
+/// Anhade timer a la lista como subfase del timer parent (debe estar definido).
+/// Cuando thread es true, tambien se registra el tiempo de cada hilo.
+//==============================================================================
+void JDsTimers::AddSubTimer(unsigned c,std::string name,unsigned parent,bool thread){
+  if(parent>=TIMERSIZE || List[parent].name.empty())Run_Exceptioon("Parent timer is not defined.");
+  AddTimer(c,name,List[parent].level+1,List[parent].active);
+  List[c].parent=int(parent);
+  List[c].thread=thread;
+}
+
+//==============================================================================
+/// Allocates memory for per-thread times (only when timers are enabled).
+/// Reserva memoria para tiempos por hilo (solo cuando los timers estan activos).
+//==============================================================================
+void JDsTimers::ConfigThreads(unsigned threads){
+  delete[] ThTime; ThTime=NULL;
+  ThreadsNum=0;
+  if(SvTimers && threads){
+    try{
+      ThTime=new double[size_t(threads)*TIMERSIZE];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon("Could not allocate the requested memory.");
+    }
+    ThreadsNum=threads;
+    memset(ThTime,0,sizeof(double)*ThreadsNum*TIMERSIZE);
+  }
+}
+
 //==============================================================================
 /// Initialises the time accumulated by all timers.
 //==============================================================================
 void JDsTimers::ResetTimes(){
   for(unsigned c=0;c<=CtMax;c++)List[c].time=0; 
+  if(ThTime)memset(ThTime,0,sizeof(double)*ThreadsNum*TIMERSIZE);
 }  
 
+//==============================================================================
+/// Returns order of timers for output (each timer followed by its sub-timers).
+/// Devuelve orden de los timers para salida (cada timer seguido de sus subtimers).
+//==============================================================================
+void JDsTimers::GetOrder(std::vector<unsigned> &order)const{
+  order.clear();
+  std::vector<int> stack;
+  for(int c=int(CtMax);c>=0;c--)if(List[c].parent<0 && !List[c].name.empty())stack.push_back(c);
+  while(!stack.empty()){
+    const int c=stack.back(); stack.pop_back();
+    order.push_back(unsigned(c));
+    for(int cs=int(CtMax);cs>=0;cs--)if(List[cs].parent==c)stack.push_back(cs);
+  }
+}
+
+//==============================================================================
+/// Returns full name of timer including its parents (e.g. CF-Forces/CF-Fluid).
+/// Devuelve nombre completo del timer incluyendo sus padres.
+//==============================================================================
+std::string JDsTimers::TimerPath(unsigned c)const{
+  string ret=List[c].name;
+  for(int cp=List[c].parent;cp>=0;cp=List[cp].parent)ret=List[cp].name+"/"+ret;
+  return(ret);
+}
+
+//==============================================================================
+/// Computes minimum, maximum and mean time of threads. Returns false when the 
+/// timer does not record per-thread times.
+/// Calcula tiempo minimo, maximo y medio de los hilos. Devuelve false cuando el
+/// timer no registra tiempos por hilo.
+//==============================================================================
+bool JDsTimers::GetThStats(unsigned c,double &thmin,double &thmax,double &thmean)const{
+  thmin=thmax=thmean=0;
+  bool ret=false;
+  if(ThTime && List[c].active && List[c].thread){
+    double tsum=0;
+    ret=true;
+    for(unsigned th=0;th<ThreadsNum;th++){
+      const double t=ThTime[th*TIMERSIZE+c];
+      thmin=(th? min(thmin,t): t);
+      thmax=(th? max(thmax,t): t);
+      tsum+=t;
+    }
+    thmean=tsum/ThreadsNum;
+  }
+  return(ret);
+}
+
 //==============================================================================
 /// Returns string with the name of timer and value (empty for inactive timers).
 //==============================================================================
@@ -99,6 +190,11 @@ std::string JDsTimers::TimerToText(unsigned c,unsigned maxlen)const{
     ret=ret+": ";
     if(t.time)ret=ret+fun::DoubleStr(t.time/1000.,"%f")+" sec.";
     else      ret=ret+"0 sec.";
+    double thmin,thmax,thmean;
+    if(GetThStats(c,thmin,thmax,thmean)){
+      ret=ret+fun::PrintStr("  [threads:%u  min:%f  max:%f  imbalance:%.1f%%]"
+        ,ThreadsNum,thmin/1000.,thmax/1000.,(thmean? (thmax/thmean-1.)*100.: 0.));
+    }
   }
   return(ret);
 }
@@ -112,8 +208,10 @@ void JDsTimers::ShowTimes(std::string title,JLog2 *log,bool onlyfile)const{
   if(!SvTimers)log->Print("none",mode);
   else{
     const unsigned maxlen=33;
-    for(unsigned c=0;c<=CtMax;c++){
-      const string tx=TimerToText(c,maxlen);
+    std::vector<unsigned> order;
+    GetOrder(order);
+    for(unsigned co=0;co<unsigned(order.size());co++){
+      const string tx=TimerToText(order[co],maxlen);
       if(!tx.empty())log->Print(tx,mode);
     }
   }
@@ -125,8 +223,88 @@ void JDsTimers::ShowTimes(std::string title,JLog2 *log,bool onlyfile)const{
 /// Devuelve string con nombres y valores de los timers activos.
 //==============================================================================
 void JDsTimers::GetTimersInfo(std::string &hinfo,std::string &dinfo)const{
-  for(unsigned c=0;c<=CtMax;c++)if(List[c].active){
-    hinfo=hinfo+";"+List[c].name;
-    dinfo=dinfo+";"+fun::DoubleStr(List[c].time/1000.);
+  std::vector<unsigned> order;
+  GetOrder(order);
+  for(unsigned co=0;co<unsigned(order.size());co++){
+    const unsigned c=order[co];
+    if(List[c].active){
+      hinfo=hinfo+";"+TimerPath(c);
+      dinfo=dinfo+";"+fun::DoubleStr(List[c].time/1000.);
+    }
+  }
+}
+
+//==============================================================================
+/// Appends accumulated times of active timers to CSV file (one row per PART).
+/// Anhade tiempos acumulados de los timers activos al fichero CSV (una fila por PART).
+//==============================================================================
+void JDsTimers::SaveCsvPart(std::string file,bool csvsepcoma,unsigned part
+  ,double timestep,unsigned nstep)const
+{
+  std::vector<unsigned> order;
+  GetOrder(order);
+  const unsigned nt=unsigned(order.size());
+  jcsv::JSaveCsv2 scsv(file,true,csvsepcoma);
+  if(!scsv.GetAppendMode()){
+    //-Saves head.
+    scsv.SetHead();
+    scsv << "Part;Time [s];Nstep";
+    for(unsigned co=0;co<nt;co++)if(List[order[co]].active)scsv << TimerPath(order[co])+" [s]";
+    for(unsigned co=0;co<nt;co++)if(List[order[co]].active && List[order[co]].thread && ThTime){
+      const string name=TimerPath(order[co]);
+      scsv << name+" ThMin [s]" << name+" ThMax [s]" << name+" ThImbalance [%]";
+    }
+    scsv << jcsv::Endl();
+  }
+  //-Saves data.
+  scsv.SetData();
+  scsv << part << timestep << nstep;
+  for(unsigned co=0;co<nt;co++)if(List[order[co]].active)scsv << List[order[co]].time/1000.;
+  for(unsigned co=0;co<nt;co++)if(List[order[co]].active && List[order[co]].thread && ThTime){
+    double thmin,thmax,thmean;
+    GetThStats(order[co],thmin,thmax,thmean);
+    scsv << thmin/1000. << thmax/1000. << (thmean? (thmax/thmean-1.)*100.: 0.);
+  }
+  scsv << jcsv::Endl();
+  scsv.SaveData();
+}
+
+//==============================================================================
+/// Saves tree of active timers with accumulated and per-thread times in JSON 
+/// format (the file is overwritten each PART).
+/// Graba arbol de timers activos con tiempos acumulados y por hilo en formato
+/// JSON (el fichero se sobrescribe en cada PART).
+//==============================================================================
+void JDsTimers::SaveJsonPart(std::string file,unsigned part,double timestep,unsigned nstep)const{
+  std::vector<unsigned> order;
+  GetOrder(order);
+  const unsigned nt=unsigned(order.size());
+  ofstream pf;
+  pf.open(file.c_str());
+  if(!pf)Run_ExceptioonFile("Cannot open the file.",file);
+  pf << "{\n";
+  pf << fun::PrintStr("  \"part\": %u,\n  \"time\": %.9g,\n  \"nstep\": %u,\n  \"threads\": %u,\n",part,timestep,nstep,ThreadsNum);
+  pf << "  \"timers\": [";
+  bool first=true;
+  for(unsigned co=0;co<nt;co++){
+    const unsigned c=order[co];
+    const StDsTimer &t=List[c];
+    if(t.active){
+      pf << (first? "\n": ",\n");
+      first=false;
+      pf << fun::PrintStr("    {\"name\": \"%s\", \"path\": \"%s\", \"level\": %u, \"parent\": \"%s\", \"time\": %.6f"
+        ,t.name.c_str(),TimerPath(c).c_str(),t.level,(t.parent>=0? List[t.parent].name.c_str(): ""),t.time/1000.);
+      double thmin,thmax,thmean;
+      if(GetThStats(c,thmin,thmax,thmean)){
+        pf << fun::PrintStr(", \"thmin\": %.6f, \"thmax\": %.6f, \"thmean\": %.6f, \"imbalance\": %.3f, \"thtimes\": ["
+          ,thmin/1000.,thmax/1000.,thmean/1000.,(thmean? (thmax/thmean-1.)*100.: 0.));
+        for(unsigned th=0;th<ThreadsNum;th++)pf << (th? ", ": "") << fun::PrintStr("%.6f",ThTime[th*TIMERSIZE+c]/1000.);
+        pf << "]";
+      }
+      pf << "}";
+    }
   }
+  pf << "\n  ]\n}\n";
+  if(pf.fail())Run_ExceptioonFile("File writing failure.",file);
+  pf.close();
 }
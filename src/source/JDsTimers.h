@@ -24,6 +24,9 @@
 #include "JObject.h"
 #include "TypesDef.h"
 #include "JTimer.h"
+#include "OmpDefs.h"
+#include <string>
+#include <vector>
 
 class JLog2;
 
@@ -33,6 +36,8 @@ typedef struct{
   JTimer timer;
   double time;
   unsigned level;
+  int parent;        ///<Id of parent timer (-1 for root timers).
+  bool thread;       ///<Records busy time of each OpenMP thread.
   std::string name;
 }StDsTimer; 
 
@@ -51,9 +56,16 @@ protected:
   unsigned CtMax;
   bool SvTimers;
 
+  unsigned ThreadsNum;  ///<Number of threads with per-thread times.
+  double *ThTime;       ///<Accumulated time of each thread [ThreadsNum*TIMERSIZE] (in miliseconds).
+
   void ResetTimer(unsigned c);
   void AddTimer(unsigned c,std::string name,unsigned level,bool active);
+  void AddSubTimer(unsigned c,std::string name,unsigned parent,bool thread);
   std::string TimerToText(unsigned c,unsigned maxlen)const;
+  std::string TimerPath(unsigned c)const;
+  void GetOrder(std::vector<unsigned> &order)const;
+  bool GetThStats(unsigned c,double &thmin,double &thmax,double &thmean)const;
 
   /// Marks start of timer.
   inline void TimerStart(unsigned c){ if(List[c].active)List[c].timer.Start(); }
@@ -67,6 +79,25 @@ protected:
     }
   }
 
+  /// Returns start time of the calling thread for TimerThStop() (in seconds).
+  inline double TimerThStart()const{
+   #ifdef OMP_USE
+    return(ThTime? omp_get_wtime(): 0);
+   #else
+    return(0);
+   #endif
+  }
+
+  /// Accumulates busy time of the calling thread (inside an OpenMP region).
+  inline void TimerThStop(unsigned c,double tini){
+   #ifdef OMP_USE
+    if(ThTime && List[c].active){
+      const unsigned th=unsigned(omp_get_thread_num());
+      if(th<ThreadsNum)ThTime[th*TIMERSIZE+c]+=(omp_get_wtime()-tini)*1000.;
+    }
+   #endif
+  }
+
 
 public:
   JDsTimers(std::string classname);
@@ -74,9 +105,13 @@ public:
 
   void Reset();
   void ResetTimes();
+  void ConfigThreads(unsigned threads);
   
   void ShowTimes(std::string title,JLog2 *log,bool onlyfile=false)const;
   void GetTimersInfo(std::string &hinfo,std::string &dinfo)const;
+
+  void SaveCsvPart(std::string file,bool csvsepcoma,unsigned part,double timestep,unsigned nstep)const;
+  void SaveJsonPart(std::string file,unsigned part,double timestep,unsigned nstep)const;
 };
 
 #endif
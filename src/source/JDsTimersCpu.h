@@ -26,23 +26,30 @@
 /// List of possible timers to define for CPU executions.
 typedef enum{
    TMC_Init=0
-  ,TMC_NlLimits=1
-  ,TMC_NlMakeSort=2
-  ,TMC_NlSortData=3
-  ,TMC_NlOutCheck=4
-  ,TMC_CfPreForces=5
-  ,TMC_CfForces=6
-  ,TMC_SuShifting=7
-  ,TMC_SuComputeStep=8
-  ,TMC_SuFloating=9
-  ,TMC_SuMotion=10
-  ,TMC_SuPeriodic=11
-  ,TMC_SuResizeNp=12
-  ,TMC_SuSavePart=13
-  ,TMC_SuChrono=14
-  ,TMC_SuMoorings=15
-  ,TMC_SuInOut=16
-  ,TMC_SuGauges=17
+  ,TMC_NlCellDiv=1
+  ,TMC_NlLimits=2
+  ,TMC_NlMakeSort=3
+  ,TMC_NlSortData=4
+  ,TMC_NlOutCheck=5
+  ,TMC_CfPreForces=6
+  ,TMC_CfForces=7
+  ,TMC_SuShifting=8
+  ,TMC_SuComputeStep=9
+  ,TMC_SuFloating=10
+  ,TMC_SuMotion=11
+  ,TMC_SuPeriodic=12
+  ,TMC_SuResizeNp=13
+  ,TMC_SuSavePart=14
+  ,TMC_SuChrono=15
+  ,TMC_SuMoorings=16
+  ,TMC_SuInOut=17
+  ,TMC_SuGauges=18
+  ,TMC_NlNgList=19
+  ,TMC_NlPreSort=20
+  ,TMC_CfMdbcCorrection=21
+  ,TMC_CfFluid=22
+  ,TMC_CfBound=23
+  ,TMC_CfDem=24
 }TpTimersCPU;
 
 //##############################################################################
@@ -61,14 +68,13 @@ public:
 
   //==============================================================================
   /// Configures timers for CPU executions.
+  /// Sub-timers are shown nested under their parent timer.
   //==============================================================================
   void Config(bool svtimers){
     Reset();
     SvTimers=svtimers;
     Add(TMC_Init         ,"VA-Init"       ,0,SvTimers);
-    Add(TMC_NlLimits     ,"NL-Limits"     ,0,SvTimers);
-    Add(TMC_NlMakeSort   ,"NL-MakeSort"   ,0,SvTimers);
-    Add(TMC_NlSortData   ,"NL-SortData"   ,0,SvTimers);
+    Add(TMC_NlCellDiv    ,"NL-CellDiv"    ,0,SvTimers);
     Add(TMC_NlOutCheck   ,"NL-OutCheck"   ,0,SvTimers);
     Add(TMC_CfPreForces  ,"CF-PreForces"  ,0,SvTimers);
     Add(TMC_CfForces     ,"CF-Forces"     ,0,SvTimers);
@@ -83,6 +89,15 @@ public:
     Add(TMC_SuMoorings   ,"SU-Moorings"   ,0,SvTimers);
     Add(TMC_SuInOut      ,"SU-InOut"      ,0,SvTimers);
     Add(TMC_SuGauges     ,"SU-Gauges"     ,0,SvTimers);
+    Add(TMC_NlNgList     ,"NL-NgList"     ,0,SvTimers);
+    AddSub(TMC_NlLimits        ,"NL-Limits"        ,TMC_NlCellDiv  ,false);
+    AddSub(TMC_NlMakeSort      ,"NL-MakeSort"      ,TMC_NlCellDiv  ,false);
+    AddSub(TMC_NlPreSort       ,"NL-PreSort"       ,TMC_NlMakeSort ,false);
+    AddSub(TMC_NlSortData      ,"NL-SortData"      ,TMC_NlCellDiv  ,false);
+    AddSub(TMC_CfMdbcCorrection,"CF-MdbcCorrection",TMC_CfPreForces,false);
+    AddSub(TMC_CfFluid         ,"CF-Fluid"         ,TMC_CfForces   ,true);
+    AddSub(TMC_CfBound         ,"CF-Bound"         ,TMC_CfForces   ,true);
+    AddSub(TMC_CfDem           ,"CF-DEM"           ,TMC_CfForces   ,false);
   }
   
   //==============================================================================
@@ -92,6 +107,13 @@ public:
     AddTimer(unsigned(ct),name,level,active); 
   }
 
+  //==============================================================================
+  /// Add sub-timer of parent timer to list (with per-thread times or not).
+  //==============================================================================
+  void AddSub(TpTimersCPU ct,std::string name,TpTimersCPU parent,bool thread){ 
+    AddSubTimer(unsigned(ct),name,unsigned(parent),thread); 
+  }
+
   //==============================================================================
   /// Marks start of timer.
   //==============================================================================
@@ -101,6 +123,16 @@ public:
   /// Marks end of timer and accumulates time.
   //==============================================================================
   inline void TmStop(TpTimersCPU ct){ TimerStop(unsigned(ct)); }
+
+  //==============================================================================
+  /// Returns start time of current thread (call inside OpenMP region).
+  //==============================================================================
+  inline double TmThStart()const{ return(TimerThStart()); }
+
+  //==============================================================================
+  /// Accumulates busy time of current thread (call inside OpenMP region).
+  //==============================================================================
+  inline void TmThStop(TpTimersCPU ct,double tini){ TimerThStop(unsigned(ct),tini); }
 };
 
 #endif
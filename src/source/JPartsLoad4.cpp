@@ -22,8 +22,17 @@
 #include "Functions.h"
 #include "JPartDataBi4.h"
 #include "JRadixSort.h"
+#include "OmpDefs.h"
 #include <climits>
 #include <cfloat>
+#include <vector>
+
+#ifndef WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -103,14 +112,20 @@ llong JPartsLoad4::GetAllocMemory()const{
 }
 
 //==============================================================================
-/// Sorts values according to vsort[].
-/// Ordena valores segun vsort[].
+/// Returns true when boundary (fixed and moving) particles are the first ones.
+/// Devuelve true cuando las particulas de contorno (fijas y moviles) son las primeras.
 //==============================================================================
-template<typename T> T* JPartsLoad4::SortParticles(const unsigned *vsort,unsigned count,T *v)const{
-  T* v2=new T[count];
-  for(unsigned p=0;p<count;p++)v2[p]=v[vsort[p]];
-  delete[] v;
-  return(v2);
+bool JPartsLoad4::BoundFirst()const{
+  const unsigned nbound=unsigned(CaseNfixed+CaseNmoving);
+  if(nbound>Count)return(false);
+  //-Idp values are unique so the first nbound particles must have Idp<nbound.
+  const int n=int(nbound);
+  int nerr=0;
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) reduction(+:nerr) if(UseOmp && n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++)if(Idp[p]>=nbound)nerr++;
+  return(!nerr);
 }
 
 //==============================================================================
@@ -118,13 +133,7 @@ template<typename T> T* JPartsLoad4::SortParticles(const unsigned *vsort,unsigne
 /// Comprubeba orden de particulas de contorno.
 //==============================================================================
 void JPartsLoad4::CheckSortParticles(){
-  const unsigned nbound=unsigned(CaseNfixed+CaseNmoving);
-  if(nbound){
-    unsigned lastbound=0;
-    //-Computes position of last boundary particle.
-    for(unsigned p=0;p<Count;p++)if(Idp[p]<nbound && p>lastbound)lastbound=p;
-    if(lastbound+1!=nbound)Run_Exceptioon("Order of boundary (fixed and moving) particles is invalid.");
-  }
+  if(!BoundFirst())Run_Exceptioon("Order of boundary (fixed and moving) particles is invalid.");
 }
 
 //==============================================================================
@@ -133,9 +142,13 @@ void JPartsLoad4::CheckSortParticles(){
 //==============================================================================
 void JPartsLoad4::SortParticles(){
   //-Checks order. | Comprueba orden.
-  bool sorted=true;
-  for(unsigned p=1;p<Count && sorted;p++)sorted=(Idp[p-1]<Idp[p]);
-  if(!sorted){
+  const int n=int(Count);
+  int nerr=0;
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) reduction(+:nerr) if(UseOmp && n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=1;p<n;p++)if(Idp[p-1]>=Idp[p])nerr++;
+  if(nerr){
     //-Sorts points according to id. | Ordena puntos segun id.
     JRadixSort rs(UseOmp);
     rs.Sort(true,Count,Idp);
@@ -144,6 +157,141 @@ void JPartsLoad4::SortParticles(){
   }
 }
 
+//==============================================================================
+/// Opens the structure of the indicated piece and returns the filename.
+/// Abre la estructura de la pieza indicada y devuelve el nombre de fichero.
+//==============================================================================
+std::string JPartsLoad4::OpenPiece(JPartDataBi4 &pd,const std::string &dir
+  ,const std::string &casename,unsigned piece)const
+{
+  string file;
+  if(!PartBegin){
+    pd.LoadFileCase(dir,casename,piece,Npiece);
+    file=dir+JPartDataBi4::GetFileNameCase(casename,piece,Npiece);
+  }
+  else{
+    pd.LoadFilePart(dir,PartBegin,piece,Npiece);
+    file=dir+JPartDataBi4::GetFileNamePart(PartBegin,piece,Npiece);
+  }
+  return(file);
+}
+
+//==============================================================================
+/// Maps the file in memory for reading and returns NULL when it is not possible.
+/// Mapea el fichero en memoria para lectura y devuelve NULL cuando no es posible.
+//==============================================================================
+const byte* JPartsLoad4::MapFile(const std::string &file,llong &size){
+  const byte *ptr=NULL;
+  size=0;
+  #ifndef WIN32
+    const int fd=open(file.c_str(),O_RDONLY);
+    if(fd>=0){
+      struct stat st;
+      if(!fstat(fd,&st) && st.st_size>0){
+        void *map=mmap(NULL,size_t(st.st_size),PROT_READ,MAP_PRIVATE,fd,0);
+        if(map!=MAP_FAILED){
+          madvise(map,size_t(st.st_size),MADV_WILLNEED);
+          ptr=(const byte*)map;
+          size=llong(st.st_size);
+        }
+      }
+      close(fd);
+    }
+  #endif
+  return(ptr);
+}
+
+//==============================================================================
+/// Frees the memory mapped with MapFile().
+/// Libera la memoria mapeada con MapFile().
+//==============================================================================
+void JPartsLoad4::UnmapFile(const byte *ptr,llong size){
+  #ifndef WIN32
+    if(ptr)munmap((void*)ptr,size_t(size));
+  #endif
+}
+
+//==============================================================================
+/// Loads particles of the piece starting at pini reading the arrays directly
+/// from the file mapped in memory. Returns false when the file can not be mapped.
+/// Carga particulas de la pieza a partir de pini leyendo los arrays directamente
+/// del fichero mapeado en memoria. Devuelve false cuando no se puede mapear.
+//==============================================================================
+bool JPartsLoad4::LoadPieceMapped(const JPartDataBi4 &pd,const std::string &file
+  ,unsigned pini,unsigned npok,bool omp)
+{
+  //-Obtains position of arrays in file. | Obtiene posicion de los arrays en fichero.
+  const JBinaryDataArray *arpos=(PosSingle? pd.GetArray("Pos",JBinaryDataDef::DatFloat3): pd.GetArray("Posd",JBinaryDataDef::DatDouble3));
+  const JBinaryDataArray *arrays[4]={pd.GetArray("Idp",JBinaryDataDef::DatUint),arpos
+    ,pd.GetArray("Vel",JBinaryDataDef::DatFloat3),pd.GetArray("Rhop",JBinaryDataDef::DatFloat)};
+  for(unsigned c=0;c<4;c++)if(arrays[c]->GetFileDataPos()<0)return(false);
+  //-Maps file in memory. | Mapea fichero en memoria.
+  llong fsize=0;
+  const byte *fdata=MapFile(file,fsize);
+  if(!fdata)return(false);
+  const byte *ptrs[4];
+  bool err=false;
+  for(unsigned c=0;c<4 && !err;c++){
+    const JBinaryDataArray *ar=arrays[c];
+    const llong sdata=llong(JBinaryDataDef::SizeOfType(ar->GetType()))*npok;
+    err=(ar->GetFileDataCount()!=npok || ar->GetFileDataPos()+sdata>fsize);
+    ptrs[c]=fdata+ar->GetFileDataPos();
+  }
+  if(err){
+    UnmapFile(fdata,fsize);
+    Run_ExceptioonFile("Size of particle arrays does not match the file.",file);
+  }
+  //-Copies data of particles. | Copia datos de particulas.
+  const unsigned *idp=(const unsigned *)ptrs[0];
+  const tfloat3 *vel=(const tfloat3 *)ptrs[2];
+  const float *rhop=(const float *)ptrs[3];
+  const int n=int(npok);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(omp && n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<n;p++){
+    const unsigned p2=pini+unsigned(p);
+    Idp[p2]=idp[p];
+    Pos[p2]=(PosSingle? ToTDouble3(((const tfloat3 *)ptrs[1])[p]): ((const tdouble3 *)ptrs[1])[p]);
+    const tfloat3 v=vel[p];
+    VelRhop[p2]=TFloat4(v.x,v.y,v.z,rhop[p]);
+  }
+  UnmapFile(fdata,fsize);
+  return(true);
+}
+
+//==============================================================================
+/// Loads particles of the piece starting at pini.
+/// Carga particulas de la pieza a partir de pini.
+//==============================================================================
+void JPartsLoad4::LoadPiece(const JPartDataBi4 &pd,const std::string &file
+  ,unsigned pini,unsigned npok,bool omp)
+{
+  if(npok && !LoadPieceMapped(pd,file,pini,npok,omp)){
+    tfloat3 *auxf3=NULL;
+    float *auxf=NULL;
+    try{
+      auxf3=new tfloat3[npok];
+      auxf=new float[npok];
+    }
+    catch(const std::bad_alloc){
+      delete[] auxf3; auxf3=NULL;
+      Run_Exceptioon("Could not allocate the requested memory.");
+    }
+    if(PosSingle){
+      pd.Get_Pos(npok,auxf3);
+      for(unsigned p=0;p<npok;p++)Pos[pini+p]=ToTDouble3(auxf3[p]);
+    }
+    else pd.Get_Posd(npok,Pos+pini);
+    pd.Get_Idp(npok,Idp+pini);  
+    pd.Get_Vel(npok,auxf3);  
+    pd.Get_Rhop(npok,auxf);  
+    for(unsigned p=0;p<npok;p++)VelRhop[pini+p]=TFloat4(auxf3[p].x,auxf3[p].y,auxf3[p].z,auxf[p]);
+    delete[] auxf3; auxf3=NULL;
+    delete[] auxf;  auxf=NULL;
+  }
+}
+
 //==============================================================================
 /// It loads particles of bi4 file and it orders them by Id.
 /// Carga particulas de fichero bi4 y las ordena por Id.
@@ -197,60 +345,75 @@ void JPartsLoad4::LoadParticles(const std::string &casedir,const std::string &ca
     SymplecticDtPre=pd.GetPart()->GetvDouble("SymplecticDtPre",true,0);
     DemDtForce=pd.GetPart()->GetvDouble("DemDtForce",true,0);
   }
-  //-Calculates number of particles. | Calcula numero de particulas.
-  unsigned sizetot=pd.Get_Npok();
-  for(unsigned piece=1;piece<Npiece;piece++){
-    JPartDataBi4 pd2;
-    if(!PartBegin)pd2.LoadFileCase(dir,casename,piece,Npiece);
-    else pd2.LoadFilePart(dir,PartBegin,piece,Npiece);
-    sizetot+=pd.Get_Npok();
+  //-Calculates number of particles of each piece. | Calcula numero de particulas de cada pieza.
+  const string file0=dir+(!PartBegin? JPartDataBi4::GetFileNameCase(casename,0,Npiece): JPartDataBi4::GetFileNamePart(PartBegin,0,Npiece));
+  const bool omppieces=(UseOmp && Npiece>1);
+  std::vector<unsigned> pieceini(Npiece+1,0);
+  pieceini[1]=pd.Get_Npok();
+  string errtx;
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (dynamic) if(omppieces)
+  #endif
+  for(int piece=1;piece<int(Npiece);piece++){
+    try{
+      JPartDataBi4 pd2;
+      OpenPiece(pd2,dir,casename,unsigned(piece));
+      pieceini[piece+1]=pd2.Get_Npok();
+    }
+    catch(const std::exception &e){
+      #ifdef OMP_USE
+        #pragma omp critical
+      #endif
+      {
+        if(errtx.empty())errtx=e.what();
+      }
+    }
+  }
+  if(!errtx.empty())Run_Exceptioon(errtx);
+  for(unsigned piece=0;piece<Npiece;piece++){
+    if(ullong(pieceini[piece])+pieceini[piece+1]>UINT_MAX)Run_Exceptioon("Number of particles is too large.");
+    pieceini[piece+1]+=pieceini[piece];
   }
+  const unsigned sizetot=pieceini[Npiece];
   //-Allocates memory.
   AllocMemory(sizetot);
-  //-Loads particles.
-  {
-    unsigned ntot=0;
-    unsigned auxsize=0;
-    tfloat3 *auxf3=NULL;
-    float *auxf=NULL;
-    for(unsigned piece=0;piece<Npiece;piece++){
-      if(piece){
-        if(!PartBegin)pd.LoadFileCase(dir,casename,piece,Npiece);
-        else pd.LoadFilePart(dir,PartBegin,piece,Npiece);
+  //-Loads particles of several pieces in parallel or of one piece using all threads.
+  //-Carga particulas de varias piezas en paralelo o de una pieza usando todos los hilos.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (dynamic) if(omppieces)
+  #endif
+  for(int piece=0;piece<int(Npiece);piece++){
+    try{
+      const unsigned pini=pieceini[piece];
+      const unsigned npok=pieceini[piece+1]-pini;
+      if(!piece)LoadPiece(pd,file0,pini,npok,UseOmp && !omppieces);
+      else{
+        JPartDataBi4 pd2;
+        const string file=OpenPiece(pd2,dir,casename,unsigned(piece));
+        if(pd2.Get_Npok()!=npok)Run_ExceptioonFile("Number of particles in piece does not match.",file);
+        LoadPiece(pd2,file,pini,npok,false);
       }
-      const unsigned npok=pd.Get_Npok();
-      if(npok){
-        if(auxsize<npok){
-          auxsize=npok;
-          delete[] auxf3; auxf3=NULL;
-          delete[] auxf;  auxf=NULL;
-          auxf3=new tfloat3[auxsize];
-          auxf=new float[auxsize];
-        }
-        if(PosSingle){
-          pd.Get_Pos(npok,auxf3);
-          for(unsigned p=0;p<npok;p++)Pos[ntot+p]=ToTDouble3(auxf3[p]);
-        }
-        else pd.Get_Posd(npok,Pos+ntot);
-        pd.Get_Idp(npok,Idp+ntot);  
-        pd.Get_Vel(npok,auxf3);  
-        pd.Get_Rhop(npok,auxf);  
-        for(unsigned p=0;p<npok;p++)VelRhop[ntot+p]=TFloat4(auxf3[p].x,auxf3[p].y,auxf3[p].z,auxf[p]);
+    }
+    catch(const std::exception &e){
+      #ifdef OMP_USE
+        #pragma omp critical
+      #endif
+      {
+        if(errtx.empty())errtx=e.what();
       }
-      ntot+=npok;
     }
-    delete[] auxf3; auxf3=NULL;
-    delete[] auxf;  auxf=NULL;
   }
+  if(!errtx.empty())Run_Exceptioon(errtx);
   //-In simulations 2D, if PosY is invalid then calculates starting from position of particles.
   if(Simulate2DPosY==DBL_MAX){
     if(!sizetot)Run_Exceptioon("Number of particles is invalid to calculates Y in 2D simulations.");
     Simulate2DPosY=Pos[0].y;
   }
+  //-Sorts particles according to Id only when boundary particles are not the first ones (e.g. several pieces).
+  //-Ordena particulas por Id solo cuando las particulas de contorno no son las primeras (ej. varias piezas).
+  if(!BoundFirst())SortParticles();
   //-Checks order of boundary particles.
   CheckSortParticles();
-  //-Sorts particles according to Id. | Ordena particulas por Id.
-  //SortParticles();
 }
 
 //==============================================================================
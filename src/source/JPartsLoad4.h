@@ -34,6 +34,10 @@
 //:# - No reordena paraticulas para reducir diferencias usando restart. (23-04-2018)
 //:# - Improved definition of the periodic conditions. (27-04-2018)
 //:# - Mejora la gestion de excepciones. (06-05-2020)
+//:# - Carga de los arrays de particulas mapeando el fichero en memoria y carga
+//:#   de varias piezas en paralelo. (17-10-2026)
+//:# - Solo reordena por Idp cuando las particulas de contorno no estan al
+//:#   principio, usando JRadixSort con OpenMP. (17-10-2026)
 //:#############################################################################
 
 /// \file JPartsLoad4.h \brief Declares the class \ref JPartsLoad4.
@@ -45,6 +49,9 @@
 #include "JPeriodicDef.h"
 #include "JObject.h"
 #include <cstring>
+#include <string>
+
+class JPartDataBi4;
 
 //##############################################################################
 //# JPartsLoad4
@@ -93,9 +100,14 @@ protected:
   tfloat4 *VelRhop;
 
   void AllocMemory(unsigned count);
-  template<typename T> T* SortParticles(const unsigned *vsort,unsigned count,T *v)const;
+  bool BoundFirst()const;
   void CheckSortParticles();
   void SortParticles();
+  std::string OpenPiece(JPartDataBi4 &pd,const std::string &dir,const std::string &casename,unsigned piece)const;
+  static const byte* MapFile(const std::string &file,llong &size);
+  static void UnmapFile(const byte *ptr,llong size);
+  bool LoadPieceMapped(const JPartDataBi4 &pd,const std::string &file,unsigned pini,unsigned npok,bool omp);
+  void LoadPiece(const JPartDataBi4 &pd,const std::string &file,unsigned pini,unsigned npok,bool omp);
   void CalculateCasePos();
 
 public:
@@ -19,9 +19,12 @@
 /// \file JRadixSort.cpp \brief Implements the class \ref JRadixSort.
 
 #include "JRadixSort.h"
+#include "JTimer.h"
 #include <string>
 #include <cstring>
 #include <climits>
+#include <cstdio>
+#include <vector>
 #include <algorithm>
 
 using namespace std;
@@ -37,6 +40,7 @@ JRadixSort::JRadixSort(bool useomp):UseOmp(useomp && CompiledOMP()){
   Data32=NULL; Data64=NULL;
   PrevData32=NULL; PrevData64=NULL;
   BeginKeys=NULL;
+  BlockKeys=NULL;
   Index=NULL; PrevIndex=NULL;
   Reset();
 }
@@ -66,6 +70,8 @@ void JRadixSort::Reset(){
   delete[] PrevData64; PrevData64=NULL;
   Size=Nbits=Nkeys=0;
   delete[] BeginKeys; BeginKeys=NULL;
+  Nblocks=0;
+  delete[] BlockKeys; BlockKeys=NULL;
   delete[] Index; Index=NULL;
   delete[] PrevIndex; PrevIndex=NULL;
 }
@@ -290,10 +296,123 @@ template<class T> void JRadixSort::SortStepIndex(unsigned ck,const T* data,T* da
 }
 
 //==============================================================================
-/// Crea e inicializa el vector Index[].
-/// Creates and initializes the Index[] array.
+/// Realiza un paso de ordenacion con varios hilos. Cada bloque de datos cuenta
+/// sus claves y las escribe en su posicion usando buffers de write-combining,
+/// de forma que el resultado es estable y no depende del numero de hilos.
+/// Performs a sorting step with several threads. Each block of data counts its
+/// keys and writes them in their position using write-combining buffers, so
+/// the result is stable and does not depend on the number of threads.
 //==============================================================================
-void JRadixSort::IndexCreate(){
+template<class T> void JRadixSort::SortStepOmp(unsigned ck,const T* data,T* data2,const unsigned *index,unsigned *index2){
+  const unsigned ckmov=ck*KEYSBITS;
+  const int nblk=int(Nblocks);
+  const unsigned sblk=(Size+Nblocks-1)/Nblocks;
+  //-Cuenta numero de valores de cada clave en cada bloque.
+  //-Counts number of values of each key in each block.
+  #ifdef OMP_USE_RADIXSORT
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int cb=0;cb<nblk;cb++){
+    unsigned *nk=BlockKeys+KEYSRANGE*cb;
+    memset(nk,0,sizeof(unsigned)*KEYSRANGE);
+    const unsigned pini=min(Size,sblk*unsigned(cb));
+    const unsigned pfin=min(Size,pini+sblk);
+    for(unsigned p=pini;p<pfin;p++)nk[(data[p]>>ckmov)&KEYSMASK]++;
+  }
+  //-Calcula posicion inicial de cada clave en cada bloque.
+  //-Computes initial position of each key in each block.
+  unsigned pos=0;
+  for(unsigned k=0;k<unsigned(KEYSRANGE);k++)for(unsigned cb=0;cb<Nblocks;cb++){
+    unsigned *nk=BlockKeys+KEYSRANGE*cb+k;
+    const unsigned n=*nk;
+    *nk=pos;
+    pos+=n;
+  }
+  //-Escribe valores de cada bloque en su posicion.
+  //-Writes values of each block in their position.
+  #ifdef OMP_USE_RADIXSORT
+    #pragma omp parallel for schedule (static,1)
+  #endif
+  for(int cb=0;cb<nblk;cb++){
+    const unsigned WCSIZE=WCBYTES/sizeof(T);
+    T wcdata[KEYSRANGE*WCSIZE];
+    unsigned wcindex[KEYSRANGE*WCSIZE];
+    unsigned wcn[KEYSRANGE];
+    memset(wcn,0,sizeof(unsigned)*KEYSRANGE);
+    unsigned *p2=BlockKeys+KEYSRANGE*cb;
+    const unsigned pini=min(Size,sblk*unsigned(cb));
+    const unsigned pfin=min(Size,pini+sblk);
+    for(unsigned p=pini;p<pfin;p++){
+      const T v=data[p];
+      const unsigned k=unsigned((v>>ckmov)&KEYSMASK);
+      const unsigned w=k*WCSIZE+wcn[k];
+      wcdata[w]=v;
+      if(index)wcindex[w]=index[p];
+      if(++wcn[k]==WCSIZE){
+        memcpy(data2+p2[k],wcdata+k*WCSIZE,sizeof(T)*WCSIZE);
+        if(index)memcpy(index2+p2[k],wcindex+k*WCSIZE,sizeof(unsigned)*WCSIZE);
+        p2[k]+=WCSIZE;
+        wcn[k]=0;
+      }
+    }
+    //-Escribe los valores que quedan en los buffers.
+    //-Writes the values that remain in the buffers.
+    for(unsigned k=0;k<unsigned(KEYSRANGE);k++)if(wcn[k]){
+      memcpy(data2+p2[k],wcdata+k*WCSIZE,sizeof(T)*wcn[k]);
+      if(index)memcpy(index2+p2[k],wcindex+k*WCSIZE,sizeof(unsigned)*wcn[k]);
+      p2[k]+=wcn[k];
+    }
+  }
+}
+
+//==============================================================================
+/// Indica si el paso ck cambia el orden, es decir, si no todos los valores
+/// tienen la misma clave.
+/// Returns true when step ck changes the order, i.e. not all the values have
+/// the same key.
+//==============================================================================
+bool JRadixSort::StepUseful(unsigned ck)const{
+  const unsigned *bk=BeginKeys+(ck*KEYSRANGE);
+  for(unsigned c=0;c<unsigned(KEYSRANGE);c++){
+    const unsigned n=(c+1<unsigned(KEYSRANGE)? bk[c+1]: Size)-bk[c];
+    if(n)return(n!=Size);
+  }
+  return(false);
+}
+
+//==============================================================================
+/// Ordena las claves con todos los pasos necesarios. Con index tambien ordena
+/// PrevIndex[] y el resultado queda en Index[].
+/// Sorts the keys with all the needed steps. With index it also sorts
+/// PrevIndex[] and the result is stored in Index[].
+//==============================================================================
+template<class T> void JRadixSort::SortKeys(T *&prevdata,T *&data,bool index){
+  const int threads=omp_get_max_threads();
+  const bool omp=(UseOmp && threads>1 && Size>=OMPMINSIZE);
+  if(omp && !BlockKeys){
+    Nblocks=unsigned(threads);
+    try{
+      BlockKeys=new unsigned[Nblocks*KEYSRANGE];
+    }
+    catch(const std::bad_alloc){
+      Run_Exceptioon("Cannot allocate the requested memory.");
+    }
+  }
+  for(unsigned ck=0;ck<Nkeys;ck++)if(StepUseful(ck)){
+    if(omp)SortStepOmp(ck,prevdata,data,(index? PrevIndex: NULL),(index? Index: NULL));
+    else if(index)SortStepIndex(ck,prevdata,data,PrevIndex,Index);
+    else SortStep(ck,prevdata,data);
+    if(index)swap(PrevIndex,Index);
+    swap(prevdata,data);
+  }
+  if(index)swap(PrevIndex,Index);
+}
+
+//==============================================================================
+/// Crea e inicializa el vector Index[] con valores consecutivos o con values[].
+/// Creates and initializes the Index[] array with consecutive values or values[].
+//==============================================================================
+void JRadixSort::IndexCreate(const unsigned *values){
   const int threads=omp_get_max_threads();
   //-Reserva memoria.
   //-Allocates memeory.
@@ -308,7 +427,7 @@ void JRadixSort::IndexCreate(){
   //-Carga PrevIndex[] con valores consecutivos.
   //-Loads PrevIndex[] with consecutive values.
   if(!UseOmp || threads<2){//-Secuencial. //-Sequential.
-    for(unsigned c2=0;c2<Size;c2++)PrevIndex[c2]=c2;
+    for(unsigned c2=0;c2<Size;c2++)PrevIndex[c2]=(values? values[c2]: c2);
   }
   else{//-con OpenMP.
     const int nk=int(Size/OMPSIZE)+1;
@@ -322,7 +441,7 @@ void JRadixSort::IndexCreate(){
     for(int c=0;c<nk;c++){
       const unsigned c2ini=OMPSIZE*c;
       const unsigned c2fin=c2ini+(c+1<nk? OMPSIZE: rk);
-      for(unsigned c2=c2ini;c2<c2fin;c2++)PrevIndex[c2]=c2;
+      for(unsigned c2=c2ini;c2<c2fin;c2++)PrevIndex[c2]=(values? values[c2]: c2);
     }
   }
 }
@@ -336,18 +455,10 @@ void JRadixSort::Sort(bool makeindex,unsigned size,unsigned *data,unsigned nbits
   Nbits=nbits; Size=size; 
   Type32=true; InitData32=data; PrevData32=data;
   AllocMemory(Size);
-  if(makeindex)IndexCreate();
+  if(makeindex)IndexCreate(NULL);
   LoadBeginKeys<unsigned>(PrevData32);
-  for(unsigned ck=0;ck<Nkeys;ck++){
-    if(makeindex){
-      SortStepIndex(ck,PrevData32,Data32,PrevIndex,Index);
-      swap(PrevIndex,Index);
-    }
-    else SortStep(ck,PrevData32,Data32);
-    swap(PrevData32,Data32);
-  }
+  SortKeys<unsigned>(PrevData32,Data32,makeindex);
   if(makeindex){ 
-    swap(PrevIndex,Index);
     delete[] PrevIndex; PrevIndex=NULL;
   }
   //-Copia los datos en el puntero recibido como parametro.
@@ -364,18 +475,10 @@ void JRadixSort::Sort(bool makeindex,unsigned size,ullong *data,unsigned nbits){
   Nbits=nbits; Size=size; 
   Type32=false; InitData64=data; PrevData64=data;
   AllocMemory(Size);
-  if(makeindex)IndexCreate();
+  if(makeindex)IndexCreate(NULL);
   LoadBeginKeys<ullong>(PrevData64);
-  for(unsigned ck=0;ck<Nkeys;ck++){
-    if(makeindex){
-      SortStepIndex(ck,PrevData64,Data64,PrevIndex,Index);
-      swap(PrevIndex,Index);
-    }
-    else SortStep(ck,PrevData64,Data64);
-    swap(PrevData64,Data64);
-  }
+  SortKeys<ullong>(PrevData64,Data64,makeindex);
   if(makeindex){ 
-    swap(PrevIndex,Index);
     delete[] PrevIndex; PrevIndex=NULL;
   }
   //-Copia los datos en el puntero recibido como parametro.
@@ -383,6 +486,50 @@ void JRadixSort::Sort(bool makeindex,unsigned size,ullong *data,unsigned nbits){
   if(PrevData64!=InitData64)memcpy(InitData64,PrevData64,sizeof(ullong)*Size);
 }
 
+//==============================================================================
+/// Ordena valores de data y reordena values[] de la misma forma.
+/// Reorders data values and reorders values[] in the same way.
+//==============================================================================
+void JRadixSort::Sort(unsigned size,unsigned *data,unsigned *values,unsigned nbits){
+  Reset();
+  Nbits=nbits; Size=size; 
+  Type32=true; InitData32=data; PrevData32=data;
+  AllocMemory(Size);
+  IndexCreate(values);
+  LoadBeginKeys<unsigned>(PrevData32);
+  SortKeys<unsigned>(PrevData32,Data32,true);
+  //-Copia los datos en los punteros recibidos como parametro.
+  //-Copies data in the pointers received as parameters.
+  if(PrevData32!=InitData32)memcpy(InitData32,PrevData32,sizeof(unsigned)*Size);
+  memcpy(values,Index,sizeof(unsigned)*Size);
+  //-Index[] contiene values[] y no es valido para SortData().
+  //-Index[] contains values[] and it is not valid for SortData().
+  delete[] Index; Index=NULL;
+  delete[] PrevIndex; PrevIndex=NULL;
+}
+
+//==============================================================================
+/// Ordena valores de data y reordena values[] de la misma forma.
+/// Reorders data values and reorders values[] in the same way.
+//==============================================================================
+void JRadixSort::Sort(unsigned size,ullong *data,unsigned *values,unsigned nbits){
+  Reset();
+  Nbits=nbits; Size=size; 
+  Type32=false; InitData64=data; PrevData64=data;
+  AllocMemory(Size);
+  IndexCreate(values);
+  LoadBeginKeys<ullong>(PrevData64);
+  SortKeys<ullong>(PrevData64,Data64,true);
+  //-Copia los datos en los punteros recibidos como parametro.
+  //-Copies data in the pointers received as parameters.
+  if(PrevData64!=InitData64)memcpy(InitData64,PrevData64,sizeof(ullong)*Size);
+  memcpy(values,Index,sizeof(unsigned)*Size);
+  //-Index[] contiene values[] y no es valido para SortData().
+  //-Index[] contains values[] and it is not valid for SortData().
+  delete[] Index; Index=NULL;
+  delete[] PrevIndex; PrevIndex=NULL;
+}
+
 //==============================================================================
 /// Crea indice para ordenacion pero sin modificar los datos pasados.
 /// Creates sorting index without modifying the processed data.
@@ -540,4 +687,72 @@ void JRadixSort::DgCheckResult64()const{
   if(p!=Size)Run_Exceptioon("The order is not correct");
 }
 
+//==============================================================================
+/// Compara RadixSort con std::sort para n claves aleatorias de tipo T (clave+
+/// indice y clave+valores) y comprueba los resultados. Devuelve false cuando
+/// los resultados son distintos.
+/// Compares RadixSort against std::sort for n random keys of type T (key+index
+/// and key+payload) and checks the results. Returns false when the results
+/// are different.
+//==============================================================================
+template<class T> bool JRadixSort::BenchmarkT(unsigned n){
+  //-Random keys (xorshift64). | Claves aleatorias (xorshift64).
+  std::vector<T> keys(n);
+  ullong seed=88172645463325252ull;
+  for(unsigned p=0;p<n;p++){
+    seed^=seed<<13; seed^=seed>>7; seed^=seed<<17;
+    keys[p]=T(seed);
+  }
+  JTimer tm;
+  //-Reference with std::sort of pairs (key,index), same order as a stable sort.
+  //-Referencia con std::sort de parejas (clave,indice), mismo orden que una ordenacion estable.
+  std::vector< std::pair<T,unsigned> > ref(n);
+  for(unsigned p=0;p<n;p++)ref[p]=std::make_pair(keys[p],p);
+  tm.Start();
+  std::sort(ref.begin(),ref.end());
+  tm.Stop();
+  const double tstd=tm.GetElapsedTimeD();
+  //-RadixSort of keys with index. | RadixSort de claves con indice.
+  JRadixSort rs(true);
+  std::vector<T> data(keys);
+  std::vector<unsigned> ids(n),res(n);
+  for(unsigned p=0;p<n;p++)ids[p]=p;
+  tm.Start();
+  rs.Sort(true,n,&data[0]);
+  tm.Stop();
+  const double tindex=tm.GetElapsedTimeD();
+  rs.SortData(n,&ids[0],&res[0]);
+  bool ok=true;
+  for(unsigned p=0;p<n && ok;p++)ok=(data[p]==ref[p].first && res[p]==ref[p].second);
+  //-RadixSort of keys with payload. | RadixSort de claves con valores.
+  const unsigned fpay=2654435761u;
+  data=keys;
+  for(unsigned p=0;p<n;p++)ids[p]=p*fpay;
+  tm.Start();
+  rs.Sort(n,&data[0],&ids[0]);
+  tm.Stop();
+  const double tpay=tm.GetElapsedTimeD();
+  for(unsigned p=0;p<n && ok;p++)ok=(data[p]==ref[p].first && ids[p]==ref[p].second*fpay);
+  printf("  %-8s %5uM  std::sort:%9.1f ms  key+index:%9.1f ms (x%4.1f)  key+payload:%9.1f ms (x%4.1f)  %s\n"
+    ,(sizeof(T)==4? "unsigned": "ullong"),n/1000000,tstd,tindex,tstd/tindex,tpay,tstd/tpay,(ok? "ok": "ERROR"));
+  return(ok);
+}
 
+//==============================================================================
+/// Compara RadixSort con std::sort para 1M, 10M y 100M claves (hasta nmax
+/// millones) de tipo unsigned y ullong. Devuelve false cuando algun resultado
+/// es distinto.
+/// Compares RadixSort against std::sort for 1M, 10M and 100M keys (up to nmax
+/// millions) of type unsigned and ullong. Returns false when some result is 
+/// different.
+//==============================================================================
+bool JRadixSort::RunBenchmark(unsigned nmax){
+  printf("\nRadixSort benchmark (threads: %d)\n",(CompiledOMP()? omp_get_max_threads(): 1));
+  bool ok=true;
+  for(unsigned nm=1;nm<=nmax && nm<=100;nm*=10){
+    const unsigned n=nm*1000000;
+    ok=BenchmarkT<unsigned>(n) && ok;
+    ok=BenchmarkT<ullong>(n) && ok;
+  }
+  return(ok);
+}
@@ -33,6 +33,12 @@
 //:# - Se usa _WITHOMP_RADIXSORT para compilacion con OMP. (07-07-2016)
 //:# - Se usa OMP_USE_RADIXSORT definido en OmpDefs.h para compilacion con OMP. (04-01-2017)
 //:# - Mejora la gestion de excepciones. (06-05-2020)
+//:# - Ordenacion paralela con histogramas por bloque y escritura de claves
+//:#   mediante buffers de write-combining. El resultado no depende del numero
+//:#   de hilos. (17-10-2026)
+//:# - Omite las pasadas en las que todas las claves tienen el mismo digito. (17-10-2026)
+//:# - Nuevo modo de ordenacion con valores asociados (key+payload). (17-10-2026)
+//:# - Nuevo metodo RunBenchmark() para comparar con std::sort. (17-10-2026)
 //:#############################################################################
 
 /// \file JRadixSort.h \brief Declares the class  \ref JRadixSort.
@@ -56,6 +62,8 @@ class JRadixSort : protected JObject
 private:
   static const int OMPSTRIDE=200;
   static const int OMPSIZE=1024;
+  static const unsigned OMPMINSIZE=65536;  ///<Minimum number of values to sort with several threads.
+  static const unsigned WCBYTES=64;        ///<Size of write-combining buffers per key (one cache line).
 
   const bool UseOmp;
 
@@ -81,17 +89,25 @@ private:
 
   unsigned *BeginKeys;
 
+  unsigned Nblocks;      ///<Number of blocks for parallel sorting.
+  unsigned *BlockKeys;   ///<Position of each key for each block [Nblocks*KEYSRANGE].
+
   void AllocMemory(unsigned s);
   template<class T> void LoadBeginKeys(const T* data);
+  bool StepUseful(unsigned ck)const;
 
   template<class T> unsigned TBitsSize(T v,unsigned smax)const;
   template<class T> unsigned TCalcNbits(unsigned size,const T *data)const;
   template<class T> void SortStep(unsigned ck,const T* data,T* data2);
   template<class T> void SortStepIndex(unsigned ck,const T* data,T* data2,const unsigned *index,unsigned *index2);
+  template<class T> void SortStepOmp(unsigned ck,const T* data,T* data2,const unsigned *index,unsigned *index2);
+  template<class T> void SortKeys(T *&prevdata,T *&data,bool index);
 
   template<class T> void TSortData(unsigned size,const T *data,T *result);
 
-  void IndexCreate();
+  void IndexCreate(const unsigned *values);
+
+  template<class T> static bool BenchmarkT(unsigned n);
 
 public:
   JRadixSort(bool useomp);
@@ -99,6 +115,7 @@ public:
   void Reset();
 
   static bool CompiledOMP();
+  static bool RunBenchmark(unsigned nmax);
 
   void Sort(bool makeindex,unsigned size,unsigned *data,unsigned nbits);
   void Sort(bool makeindex,unsigned size,ullong *data,unsigned nbits);
@@ -106,6 +123,12 @@ public:
   void Sort(bool makeindex,unsigned size,unsigned *data){ Sort(makeindex,size,data,CalcNbits(size,data)); }
   void Sort(bool makeindex,unsigned size,ullong *data){ Sort(makeindex,size,data,CalcNbits(size,data)); }
 
+  void Sort(unsigned size,unsigned *data,unsigned *values,unsigned nbits);
+  void Sort(unsigned size,ullong *data,unsigned *values,unsigned nbits);
+
+  void Sort(unsigned size,unsigned *data,unsigned *values){ Sort(size,data,values,CalcNbits(size,data)); }
+  void Sort(unsigned size,ullong *data,unsigned *values){ Sort(size,data,values,CalcNbits(size,data)); }
+
   void MakeIndex(unsigned size,const unsigned *data){ MakeIndex(size,data,CalcNbits(size,data)); }
   void MakeIndex(unsigned size,const ullong *data){ MakeIndex(size,data,CalcNbits(size,data)); }
 
@@ -60,6 +60,7 @@
 #include "JLinearValue.h"
 #include "JPartNormalData.h"
 #include "JDataArrays.h"
+#include "JDsPartWriter.h"
 #include "JOutputCsv.h"
 #include "JVtkLib.h"
 #include "JNumexLib.h"
@@ -78,6 +79,7 @@ JSph::JSph(bool cpu,bool mgpu,bool withmpi):Cpu(cpu),Mgpu(mgpu),WithMpi(withmpi)
   DataBi4=NULL;
   DataOutBi4=NULL;
   DataFloatBi4=NULL;
+  PartWriter=NULL;
   SvExtraDataBi4=NULL;
   PartsOut=NULL;
   Log=NULL;
@@ -118,6 +120,7 @@ JSph::JSph(bool cpu,bool mgpu,bool withmpi):Cpu(cpu),Mgpu(mgpu),WithMpi(withmpi)
 //==============================================================================
 JSph::~JSph(){
   DestructorActive=true;
+  delete PartWriter;     PartWriter=NULL;
   delete DataBi4;        DataBi4=NULL;
   delete DataOutBi4;     DataOutBi4=NULL;
   delete DataFloatBi4;   DataFloatBi4=NULL;
@@ -203,7 +206,9 @@ void JSph::InitVars(){
   SvExtraParts="";
   SvRes=false;
   SvTimers=false;
+  SvTimersPart=false;
   SvDomainVtk=false;
+  SvPartsAsync=0;
 
   KernelH=CteB=Gamma=RhopZero=0;
   CFLnumber=0;
@@ -513,7 +518,9 @@ void JSph::LoadConfig(const JSphCfgRun *cfg){
   SvNormals=cfg->SvNormals;
   SvRes=cfg->SvRes;
   SvTimers=cfg->SvTimers;
+  SvTimersPart=(SvTimers && cfg->SvTimersPart);
   SvDomainVtk=cfg->SvDomainVtk;
+  SvPartsAsync=unsigned(cfg->SvPartsAsync);
 
   printf("\n");
   RunTimeDate=fun::GetDateTime();
@@ -542,7 +549,7 @@ void JSph::LoadConfig(const JSphCfgRun *cfg){
   LoadCaseConfig(cfg);
 
   //-PIPS configuration.
-  if(cfg->PipsMode)DsPips=new JDsPips(Cpu,cfg->PipsSteps,(cfg->PipsMode==2),(TStep==STEP_Symplectic? 2: 1));
+  if(cfg->PipsMode)DsPips=new JDsPips(Cpu,cfg->PipsSteps,(cfg->PipsMode==2),(TStep==STEP_Symplectic? 2: 1),cfg->PipsCounters);
 }
 
 //==============================================================================
@@ -1485,6 +1492,8 @@ void JSph::VisuConfig(){
   Log->Print(fun::VarStr("SaveFtAce",SaveFtAce));
   if(FtMotSave)Log->Printf("SaveFtMotion=%s  (tout:%g)",(FtMotSave? "True": "False"),FtMotSave->GetTimeOut()); //<vs_ftmottionsv>
   Log->Print(fun::VarStr("SvTimers",SvTimers));
+  Log->Print(fun::VarStr("SvTimersPart",SvTimersPart));
+  Log->Print(fun::VarStr("SvPartsAsync",SvPartsAsync));
   if(DsPips)Log->Print(fun::VarStr("PIPS-steps",DsPips->StepsNum));
   //-Boundary. 
   Log->Print(fun::VarStr("Boundary",GetBoundName(TBoundary)));
@@ -2444,6 +2453,11 @@ void JSph::ConfigSaveData(unsigned piece,unsigned pieces,std::string div){
   //-Creates object to store excluded particles until recordering. 
   //-Crea objeto para almacenar las particulas excluidas hasta su grabacion.
   PartsOut=new JDsPartsOut();
+  //-Creates object to store particle files in background.
+  //-Crea objeto para grabar ficheros de particulas en segundo plano.
+  if(SvPartsAsync && (DataBi4 || (SvData&SDAT_Csv) || (SvData&SDAT_Vtk))){
+    PartWriter=new JDsPartWriter(this,SvPartsAsync);
+  }
 }
 
 //<vs_ftmottionsv_ini>  
@@ -2575,31 +2589,28 @@ void JSph::AddBasicArrays(JDataArrays &arrays,unsigned np,const tdouble3 *pos
 }
 
 //==============================================================================
-/// Stores files of particle data.
-/// Graba los ficheros de datos de particulas.
+/// Stores files of particle data in bi4, VTK and CSV formats. It can be called 
+/// from the background thread of JDsPartWriter, so only values in info are used.
+/// Graba ficheros de datos de particulas en formato bi4, VTK y CSV. Puede ser 
+/// llamado desde el hilo de JDsPartWriter, por eso solo usa los valores de info.
 //==============================================================================
-void JSph::SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays
-  ,unsigned ndom,const tdouble3 *vdom,const StInfoPartPlus *infoplus)
+void JSph::SavePartFiles(const StPartSaveInfo &info,const JDataArrays& arrays
+  ,unsigned ndom,const tdouble3 *vdom)
 {
+  const unsigned npok=info.npok;
   //-Stores particle data and/or information in bi4 format.
   //-Graba datos de particulas y/o informacion en formato bi4.
   if(DataBi4){
     tfloat3* posf3=NULL;
-    TimerPart.Stop();
-    tdouble3 domainmin=vdom[0];
-    tdouble3 domainmax=vdom[1];
-    for(unsigned c=1;c<ndom;c++){
-      domainmin=MinValues(domainmin,vdom[c*2  ]);
-      domainmax=MaxValues(domainmax,vdom[c*2+1]);
-    }
-    JBinaryData* bdpart=DataBi4->AddPartInfo(Part,TimeStep,npok,nout,Nstep,TimerPart.GetElapsedTimeD()/1000.,domainmin,domainmax,TotalNp);
-    if(TStep==STEP_Symplectic)bdpart->SetvDouble("SymplecticDtPre",SymplecticDtPre);
-    if(UseDEM)bdpart->SetvDouble("DemDtForce",DemDtForce); //(DEM)
-    if(infoplus && SvData&SDAT_Info){
-      bdpart->SetvDouble("dtmean",(!Nstep? 0: (TimeStep-TimeStepM1)/(Nstep-PartNstep)));
-      bdpart->SetvDouble("dtmin",(!Nstep? 0: PartDtMin));
-      bdpart->SetvDouble("dtmax",(!Nstep? 0: PartDtMax));
-      if(FixedDt)bdpart->SetvDouble("dterror",FixedDt->GetDtError(true));
+    JBinaryData* bdpart=DataBi4->AddPartInfo(info.part,info.timestep,npok,info.nout,info.nstep,info.tpart,info.domainmin,info.domainmax,info.totalnp);
+    if(TStep==STEP_Symplectic)bdpart->SetvDouble("SymplecticDtPre",info.symplecticdtpre);
+    if(UseDEM)bdpart->SetvDouble("DemDtForce",info.demdtforce); //(DEM)
+    if(info.infoplusdef){
+      const StInfoPartPlus *infoplus=&info.infoplus;
+      bdpart->SetvDouble("dtmean",info.dtmean);
+      bdpart->SetvDouble("dtmin",info.dtmin);
+      bdpart->SetvDouble("dtmax",info.dtmax);
+      if(info.dterrordef)bdpart->SetvDouble("dterror",info.dterror);
       bdpart->SetvDouble("timesim",infoplus->timesim);
       bdpart->SetvUint("nct",infoplus->nct);
       bdpart->SetvUint("npbin",infoplus->npbin);
@@ -2633,7 +2644,7 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays
       const unsigned *idp =arrays.GetArrayUint   ("Idp");
       const tfloat3  *vel =arrays.GetArrayFloat3 ("Vel");
       const float    *rhop=arrays.GetArrayFloat  ("Rhop");
-      if(SvPosDouble || (SvExtraDataBi4 && SvExtraDataBi4->CheckSave(Part))){
+      if(info.svposdouble){
         DataBi4->AddPartData(npok,idp,pos,vel,rhop);
       }
       else{
@@ -2678,16 +2689,64 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays
     arrays2.MoveArray(arrays2.Count()-1,4);
     //-Defines fields to be stored.
     if(SvData&SDAT_Vtk){
-      JVtkLib::SaveVtkData(DirDataOut+fun::FileNameSec("PartVtk.vtk",Part),arrays2,"Pos");
+      JVtkLib::SaveVtkData(DirDataOut+fun::FileNameSec("PartVtk.vtk",info.part),arrays2,"Pos");
     }
     if(SvData&SDAT_Csv){ 
       JOutputCsv ocsv(AppInfo.GetCsvSepComa());
-      ocsv.SaveCsv(DirDataOut+fun::FileNameSec("PartCsv.csv",Part),arrays2);
+      ocsv.SaveCsv(DirDataOut+fun::FileNameSec("PartCsv.csv",info.part),arrays2);
     }
     //-Deallocate of memory.
     delete[] posf3;
     delete[] type; 
   }
+}
+
+//==============================================================================
+/// Stores files of particle data. Files of bi4, VTK and CSV formats are 
+/// stored by background thread when PartWriter is active.
+/// Graba los ficheros de datos de particulas. Los ficheros bi4, VTK y CSV se 
+/// graban en segundo plano cuando PartWriter esta activo.
+//==============================================================================
+void JSph::SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays
+  ,unsigned ndom,const tdouble3 *vdom,const StInfoPartPlus *infoplus)
+{
+  //-Stores particle data in bi4, VTK and/or CSV formats.
+  //-Graba datos de particulas en formato bi4, VTK y/o CSV.
+  if(DataBi4 || (SvData&SDAT_Csv) || (SvData&SDAT_Vtk)){
+    //-Collects values of current PART. | Recopila valores del PART actual.
+    StPartSaveInfo info;
+    memset(&info,0,sizeof(StPartSaveInfo));
+    TimerPart.Stop();
+    info.part=Part;
+    info.nstep=Nstep;
+    info.timestep=TimeStep;
+    info.tpart=TimerPart.GetElapsedTimeD()/1000.;
+    info.npok=npok;
+    info.nout=nout;
+    info.totalnp=TotalNp;
+    info.domainmin=vdom[0];
+    info.domainmax=vdom[1];
+    for(unsigned c=1;c<ndom;c++){
+      info.domainmin=MinValues(info.domainmin,vdom[c*2  ]);
+      info.domainmax=MaxValues(info.domainmax,vdom[c*2+1]);
+    }
+    info.svposdouble=(SvPosDouble || (SvExtraDataBi4 && SvExtraDataBi4->CheckSave(Part)));
+    info.symplecticdtpre=SymplecticDtPre;
+    info.demdtforce=DemDtForce;
+    if(infoplus && SvData&SDAT_Info){
+      info.infoplusdef=true;
+      info.infoplus=*infoplus;
+      info.dtmean=(!Nstep? 0: (TimeStep-TimeStepM1)/(Nstep-PartNstep));
+      info.dtmin=(!Nstep? 0: PartDtMin);
+      info.dtmax=(!Nstep? 0: PartDtMax);
+      info.dterrordef=(FixedDt!=NULL);
+      if(FixedDt)info.dterror=FixedDt->GetDtError(true);
+    }
+    //-Copies data to be stored by background thread or stores files.
+    //-Copia datos para grabar en segundo plano o graba los ficheros.
+    if(PartWriter)PartWriter->AddPart(info,arrays,ndom,vdom);
+    else SavePartFiles(info,arrays,ndom,vdom);
+  }
 
   //-Stores data of excluded particles.
   if(DataOutBi4 && PartsOut->GetCount()){
@@ -2710,6 +2769,14 @@ void JSph::SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays
   PartsOut->Clear();
 }
 
+//==============================================================================
+/// Waits until all pending particle files are stored by background thread.
+/// Espera hasta que se graben todos los ficheros de particulas pendientes.
+//==============================================================================
+void JSph::SavePartDataWait(){
+  if(PartWriter)PartWriter->WaitAll();
+}
+
 //==============================================================================
 /// Generates data output files.
 /// Genera los ficheros de salida de datos.
@@ -3029,6 +3096,7 @@ void JSph::ShowResume(bool stop,float tsim,float ttot,bool all,std::string infop
     if(DsPips){
       Log->Printf("Particle Interactions Per Second.: %.8f GPIPS",DsPips->GetGPIPS(tsim));
       Log->Printf("Total particle interactions (f+b): %s",DsPips->GetTotalPIsInfo().c_str());
+      Log->Printf("Real/checked interactions........: %s",DsPips->GetHitRatioInfo().c_str());
     }
     Log->Printf("PART files.......................: %d",Part-PartIni);
     while(!infoplus.empty()){
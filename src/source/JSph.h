@@ -81,6 +81,7 @@ class JDataArrays;
 class JNumexLib;
 class JFtMotionSave; //<vs_ftmottionsv>
 class JDsExtraDataSave;
+class JDsPartWriter;
 
 //##############################################################################
 //# XML format of execution parameters in _FmtXML__Parameters.xml.
@@ -93,6 +94,8 @@ class JDsExtraDataSave;
 
 class JSph : protected JObject
 {
+  friend class JDsPartWriter;
+
 public:
 /// Structure with constants for the Cubic Spline kernel.
   typedef struct {
@@ -118,6 +121,29 @@ public:
     llong memorynctused;
   }StInfoPartPlus;
 
+/// Structure with the values of one PART required to store particle files (bi4, VTK and CSV).
+  typedef struct {
+    unsigned part;       ///<Number of PART.
+    unsigned nstep;      ///<Number of steps.
+    double timestep;     ///<Simulation time of PART.
+    double tpart;        ///<Runtime since last PART (seconds).
+    unsigned npok;       ///<Number of stored particles.
+    unsigned nout;       ///<Number of new excluded particles.
+    unsigned totalnp;    ///<Total number of simulated particles.
+    tdouble3 domainmin;  ///<Minimum position of domain.
+    tdouble3 domainmax;  ///<Maximum position of domain.
+    bool svposdouble;    ///<Position is stored using double precision.
+    double symplecticdtpre; ///<Previous dt of Symplectic algorithm.
+    double demdtforce;   ///<Dt for tangencial acceleration (DEM).
+    double dtmean;       ///<Mean dt of PART.
+    double dtmin;        ///<Minimum dt of PART.
+    double dtmax;        ///<Maximum dt of PART.
+    bool dterrordef;     ///<Indicates dterror is defined.
+    double dterror;      ///<Error of FixedDt.
+    bool infoplusdef;    ///<Indicates infoplus is defined.
+    StInfoPartPlus infoplus; ///<Extra information about the execution.
+  }StPartSaveInfo;
+
 private:
   //-Configuration variables to compute the case limits.
   //-Variables de configuracion para calcular el limite del caso.
@@ -130,6 +156,7 @@ private:
   JPartDataBi4 *DataBi4;            ///<To store particles and info in bi4 format.      | Para grabar particulas e info en formato bi4.
   JPartOutBi4Save *DataOutBi4;      ///<To store excluded particles in bi4 format.      | Para grabar particulas excluidas en formato bi4.
   JPartFloatBi4Save *DataFloatBi4;  ///<To store floating data in bi4 format.           | Para grabar datos de floatings en formato bi4.
+  JDsPartWriter *PartWriter;        ///<Stores particle files using a background thread. | Graba ficheros de particulas usando un hilo en segundo plano.
 
   //-Total number of excluded particles according to reason for exclusion.
   //-Numero acumulado de particulas excluidas segun motivo.
@@ -228,7 +255,9 @@ protected:
   byte SvData;               ///<Combination of the TpSaveDat values.                            | Combinacion de valores TpSaveDat.                                                      
   bool SvRes;                ///<Creates file with execution summary.                            | Graba fichero con resumen de ejecucion.
   bool SvTimers;             ///<Computes the time for each process.                             | Obtiene tiempo para cada proceso.
+  bool SvTimersPart;         ///<Saves timers in CSV and JSON files for each PART.               | Graba timers en ficheros CSV y JSON en cada PART.
   bool SvDomainVtk;          ///<Stores VTK file with the domain of particles of each PART file. | Graba fichero vtk con el dominio de las particulas en cada Part. 
+  unsigned SvPartsAsync;     ///<Number of PARTs queued for writing by background thread (0:disabled). | Numero de PARTs en cola para grabar en segundo plano (0:desactivado).
   //bool SvInterCount;       ///<Computes and saves number of interactions.                      | Calcula y graba el numero de interacciones.
 
   //-Constants for computation (from input configuration).
@@ -488,7 +517,9 @@ protected:
   tfloat3* GetPointerDataFloat3(unsigned n,const tdouble3* v)const;
   void AddBasicArrays(JDataArrays &arrays,unsigned np,const tdouble3 *pos
     ,const unsigned *idp,const tfloat3 *vel,const float *rhop)const;
+  void SavePartFiles(const StPartSaveInfo &info,const JDataArrays& arrays,unsigned ndom,const tdouble3 *vdom);
   void SavePartData(unsigned npok,unsigned nout,const JDataArrays& arrays,unsigned ndom,const tdouble3 *vdom,const StInfoPartPlus *infoplus);
+  void SavePartDataWait();
   void SaveData(unsigned npok,const JDataArrays& arrays,unsigned ndom,const tdouble3 *vdom,const StInfoPartPlus *infoplus);
 
   void CheckTermination();
@@ -44,8 +44,16 @@ void JSphCfgRun::Reset(){
   SvExtraParts="undefined";
   OmpThreads=0;
   SvTimers=true;
+  SvTimersPart=false;
   CellDomFixed=false;
   CellMode=CELLMODE_Full;
+  CellOrder=CELLORDER_Linear;
+  NgListSkin=0;
+  PeriHaloMargin=0;
+  PosCellCpu=true;
+  HugePagesCpu=false;
+  FusedCorrCpu=false;
+  SimdMode=0;
   TBoundary=0; SlipMode=0; MdbcFastSingle=-1; MdbcThreshold=-1;
   DomainMode=0;
   DomainFixedMin=DomainFixedMax=TDouble3(0);
@@ -63,6 +71,7 @@ void JSphCfgRun::Reset(){
   SvNormals=false; 
   SvRes=true; 
   SvDomainVtk=false;
+  SvPartsAsync=2;
   CaseName=""; RunName=""; DirOut=""; DirDataOut=""; 
   PartBegin=0; PartBeginFirst=0; PartBeginDir="";
   RestartChrono=false;
@@ -73,7 +82,8 @@ void JSphCfgRun::Reset(){
   NstepsBreak=0;
   SvAllSteps=false;
   NoRtimes=true;
-  PipsMode=0; PipsSteps=100;
+  RadixBench=0;
+  PipsMode=0; PipsSteps=100; PipsCounters=false;
   CreateDirs=true;
   CsvSepComa=false;
 }
@@ -112,6 +122,36 @@ void JSphCfgRun::VisuInfo()const{
   printf("        full      Lowest and the least expensive in memory (by default)\n");
   printf("        half      Fastest and the most expensive in memory\n");
   printf("    -cellfixed:<0/1>  Cell domain is fixed according maximum domain size\n");
+  printf("    -cellorder:<mode> Only for CPU execution, ordering of cell rows (y,z) used\n");
+  printf("                      to sort particles so close cells are close in memory\n");
+  printf("        linear    Rows in z-y order (by default)\n");
+  printf("        morton    Rows according to Morton (Z-order) curve\n");
+  printf("        hilbert   Rows according to Hilbert curve\n");
+  printf("    -nglist:<float>   Only for CPU execution, uses a persistent neighbour list\n");
+  printf("                      with skin distance as a factor of kernel size (0.1 is a\n");
+  printf("                      typical value). It is not used with periodic conditions\n");
+  printf("                      (default=0, disabled)\n");
+  printf("    -perihalo:<float> Only for CPU execution, periodic particles are updated\n");
+  printf("                      from their source particles and they are only created\n");
+  printf("                      again when particles cross the halo margin, given as a\n");
+  printf("                      factor of kernel size (0.1 is a typical value)\n");
+  printf("                      (default=0, disabled)\n");
+  printf("    -poscell:<0/1>    Only for CPU execution, interaction uses positions relative\n");
+  printf("                      to cells in single precision instead of double precision\n");
+  printf("                      positions (default=1)\n");
+  printf("    -hugepages:<0/1>  Only for CPU execution, particle arrays are aligned to 2 MB\n");
+  printf("                      and use transparent huge pages when available (default=0)\n");
+  printf("    -fusedcorr:<0/1>  Only for CPU execution, Symplectic-Corrector applies\n");
+  printf("                      shifting, integration and damping with planes to fluid\n");
+  printf("                      particles in one pass. Results may differ in the last\n");
+  printf("                      bits from the reference separate path (default=0)\n");
+  printf("    -simd:<mode>      Only for CPU execution, uses SIMD instructions for fluid\n");
+  printf("                      interaction with Wendland kernel and artificial viscosity\n");
+  printf("        none      Original interaction (by default)\n");
+  printf("        auto      Best instruction set available on the current CPU\n");
+  printf("        generic   Interaction on SoA data without explicit SIMD instructions\n");
+  printf("        avx2      Interaction using AVX2 (8 neighbours at once)\n");
+  printf("        avx512    Interaction using AVX-512 (16 neighbours at once)\n");
   printf("\n");
 
   printf("  Formulation options:\n");
@@ -186,10 +226,16 @@ void JSphCfgRun::VisuInfo()const{
   printf("    -svnormals:<0/1> Saves normal vector of boundary particles (default=0)\n");
   printf("    -svres:<0/1>     Generates file that summarises the execution process\n");
   printf("    -svtimers:<0/1>  Obtains timing for each individual process\n");
+  printf("    -svtimerspart:<0/1>  Saves accumulated timers (nested and per thread)\n");
+  printf("        in RunTimers.csv and RunTimers.json for each PART (default=0)\n");
   printf("    -svdomainvtk:<0/1>  Generates VTK file with domain limits\n");
+  printf("    -svasync:<int>   Number of PARTs that can be queued for writing in a\n");
+  printf("                     background thread (0=disabled, 2 by default)\n");
 /////////|---------1---------2---------3---------4---------5---------6---------7--------X8
-  printf("    -svpips:<mode>:n  Compute PIPS of simulation each n steps (100 by default),\n");
-  printf("       mode options: 0=disabled (by default), 1=no save details, 2=save details\n");
+  printf("    -svpips:<mode>:n:<0/1>  Compute PIPS of simulation each n steps (100 by\n");
+  printf("       default), mode options: 0=disabled (by default), 1=no save details,\n");
+  printf("       2=save details. The last option counts the interactions of all steps\n");
+  printf("       inside the force computation (CPU only, 0 by default)\n");
   printf("\n");
   printf("    -createdirs:<0/1> Creates full path for output files\n");
   printf("                      (value by default is read from DsphConfig.xml or 1)\n");
@@ -201,6 +247,9 @@ void JSphCfgRun::VisuInfo()const{
   printf("    -nsteps:<uint>  Maximum number of steps allowed (activates nortimes)\n");
   printf("    -svsteps:<0/1>  Saves a PART for each step (activates nortimes)\n");
   printf("    -nortimes:<0/1> Removes execution dependent values from bi4 files\n");
+  printf("    -radixbench:<uint>  Compares RadixSort against std::sort for 1M, 10M and\n");
+  printf("       100M keys (up to the given millions, 100 by default) and checks the\n");
+  printf("       results. The simulation is not executed\n");
   printf("\n");
 
   printf("  Examples:\n");
@@ -228,6 +277,13 @@ void JSphCfgRun::VisuConfig()const{
   fun::PrintVar("  SvPosDouble",SvPosDouble,ln);
   fun::PrintVar("  OmpThreads",OmpThreads,ln);
   fun::PrintVar("  CellMode",GetNameCellMode(CellMode),ln);
+  fun::PrintVar("  CellOrder",GetNameCellOrder(CellOrder),ln);
+  fun::PrintVar("  NgListSkin",NgListSkin,ln);
+  fun::PrintVar("  PeriHaloMargin",PeriHaloMargin,ln);
+  fun::PrintVar("  PosCellCpu",PosCellCpu,ln);
+  fun::PrintVar("  HugePagesCpu",HugePagesCpu,ln);
+  fun::PrintVar("  FusedCorrCpu",FusedCorrCpu,ln);
+  fun::PrintVar("  SimdMode",SimdMode,ln);
   fun::PrintVar("  TStep",TStep,ln);
   fun::PrintVar("  VerletSteps",VerletSteps,ln);
   fun::PrintVar("  TKernel",TKernel,ln);
@@ -239,7 +295,9 @@ void JSphCfgRun::VisuConfig()const{
   fun::PrintVar("  Shifting",Shifting,ln);
   fun::PrintVar("  SvRes",SvRes,ln);
   fun::PrintVar("  SvTimers",SvTimers,ln);
+  fun::PrintVar("  SvTimersPart",SvTimersPart,ln);
   fun::PrintVar("  SvDomainVtk",SvDomainVtk,ln);
+  fun::PrintVar("  SvPartsAsync",SvPartsAsync,ln);
   fun::PrintVar("  Sv_Binx",Sv_Binx,ln);
   fun::PrintVar("  Sv_Info",Sv_Info,ln);
   fun::PrintVar("  Sv_Vtk",Sv_Vtk,ln);
@@ -301,7 +359,34 @@ void JSphCfgRun::LoadOpts(string *optlis,int optn,int lv,const std::string &file
         else ok=false;
         if(!ok)ErrorParm(opt,c,lv,file);
       }
+      else if(txword=="CELLORDER"){
+        const string tx=fun::StrUpper(txoptfull);
+        if(tx=="LINEAR")CellOrder=CELLORDER_Linear;
+        else if(tx=="MORTON")CellOrder=CELLORDER_Morton;
+        else if(tx=="HILBERT")CellOrder=CELLORDER_Hilbert;
+        else ErrorParm(opt,c,lv,file);
+      }
       else if(txword=="CELLFIXED")CellDomFixed=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="NGLIST"){
+        NgListSkin=(txoptfull!=""? float(atof(txoptfull.c_str())): 0.1f);
+        if(NgListSkin<0 || NgListSkin>1.f)ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="PERIHALO"){
+        PeriHaloMargin=(txoptfull!=""? float(atof(txoptfull.c_str())): 0.1f);
+        if(PeriHaloMargin<0 || PeriHaloMargin>1.f)ErrorParm(opt,c,lv,file);
+      }
+      else if(txword=="POSCELL")PosCellCpu=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="HUGEPAGES")HugePagesCpu=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="FUSEDCORR")FusedCorrCpu=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="SIMD"){
+        const string tx=fun::StrUpper(txoptfull);
+        if(tx=="NONE")SimdMode=0;
+        else if(tx=="AUTO" || tx=="")SimdMode=-1;
+        else if(tx=="GENERIC")SimdMode=1;
+        else if(tx=="AVX2")SimdMode=2;
+        else if(tx=="AVX512")SimdMode=3;
+        else ErrorParm(opt,c,lv,file);
+      }
       else if(txword=="DBC")          { TBoundary=1; SlipMode=0; }
       else if(txword=="MDBC")         { TBoundary=2; SlipMode=1; }
       else if(txword=="MDBC_NOSLIP")  { TBoundary=2; SlipMode=2; }
@@ -363,7 +448,11 @@ void JSphCfgRun::LoadOpts(string *optlis,int optn,int lv,const std::string &file
       else if(txword=="SVNORMALS")SvNormals=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
       else if(txword=="SVRES")SvRes=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
       else if(txword=="SVTIMERS")SvTimers=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="SVTIMERSPART")SvTimersPart=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
       else if(txword=="SVDOMAINVTK")SvDomainVtk=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="SVASYNC"){
+        SvPartsAsync=(txoptfull!=""? atoi(txoptfull.c_str()): 2); if(SvPartsAsync<0)SvPartsAsync=0;
+      }
       else if(txword=="SV"){
         string txop=fun::StrUpper(txoptfull);
         while(!txop.empty()){
@@ -427,10 +516,15 @@ void JSphCfgRun::LoadOpts(string *optlis,int optn,int lv,const std::string &file
         if(SvAllSteps)NoRtimes=true;
       }
       else if(txword=="NORTIMES")NoRtimes=(txoptfull!=""? atoi(txoptfull.c_str()): 1)!=0;
+      else if(txword=="RADIXBENCH"){
+        RadixBench=(txoptfull!=""? unsigned(atoi(txoptfull.c_str())): 100);
+        if(!RadixBench)ErrorParm(opt,c,lv,file);
+      }
       else if(txword=="SVPIPS"){
         PipsMode=(unsigned)atoi(txopt1.c_str());
         if(PipsMode>2)ErrorParm(opt,c,lv,file);
         if(!txopt2.empty())PipsSteps=(unsigned)atoi(txopt2.c_str());
+        if(!txopt3.empty())PipsCounters=(atoi(txopt3.c_str())!=0);
       }
       else if(txword=="OPT"&&c+1<optn){ LoadFile(optlis[c+1],lv+1); c++; }
       else if(txword=="H"||txword=="HELP"||txword=="?")PrintInfo=true;
@@ -47,6 +47,13 @@ public:
 
   bool CellDomFixed;    ///<The Cell domain is fixed according maximum domain size.
   TpCellMode CellMode;  ///<Cell division mode.
+  TpCellOrder CellOrder;  ///<Ordering of cell rows for particle sort on CPU (CELLORDER_Linear by default).
+  float NgListSkin;     ///<Skin distance of neighbour list on CPU as a factor of KernelSize (0:disabled by default).
+  float PeriHaloMargin; ///<Margin of persistent halo of periodic particles on CPU as a factor of KernelSize (0:disabled by default).
+  bool PosCellCpu;      ///<Interaction on CPU uses positions relative to cells in single precision (default=true).
+  bool HugePagesCpu;    ///<Particle arrays on CPU are aligned to 2 MB and use huge pages (default=false).
+  bool FusedCorrCpu;    ///<Symplectic-Corrector on CPU applies shifting, integration and plane damping in one pass instead of the reference separate path (default=false).
+  int SimdMode;         ///<SIMD interaction on CPU: 0:None (by default), 1:Generic, 2:AVX2, 3:AVX-512, -1:Auto.
   int TBoundary;        ///<Boundary method: 0:None, 1:DBC (by default), 2:mDBC (SlipMode: 1:DBC vel=0)
   int SlipMode;         ///<Slip mode for mDBC: 0:None, 1:DBC vel=0, 2:No-slip, 3:Free slip (default=1).
   int MdbcFastSingle;   ///<Matrix calculations are done in single precision (default=1). 
@@ -71,7 +78,9 @@ public:
   bool SvNormals; ///<Saves normals VTK each PART (default=0).
   bool SvRes;
   bool SvTimers;
+  bool SvTimersPart;  ///<Saves timers in CSV and JSON files for each PART (default=0).
   bool SvDomainVtk;
+  int SvPartsAsync;  ///<Number of PARTs queued for writing by background thread (0:disabled, 2 by default).
   std::string CaseName,RunName,DirOut,DirDataOut;
   std::string PartBeginDir;
   unsigned PartBegin,PartBeginFirst;
@@ -86,9 +95,11 @@ public:
   int NstepsBreak;  ///<Maximum number of steps allowed (debug).
   bool SvAllSteps;  ///<Saves a PART for each step (debug).
   bool NoRtimes;    ///<Removes execution dependent values from bi4 files (debug).
+  unsigned RadixBench; ///<Runs benchmark of JRadixSort against std::sort up to the given millions of keys instead of simulation (0:disabled by default).
 
   unsigned PipsMode;   ///<Defines mode of PIPS calculation (0:No computed (default), 1:Computed, 2:computed and save detail).
   unsigned PipsSteps;  ///<Number of steps per interval to compute PIPS (100 by default).
+  bool PipsCounters;   ///<Counts PIs inside the force computation of all steps (CPU only).
 
 public:
   JSphCfgRun();
@@ -42,8 +42,12 @@
 #include "JDsGaugeSystem.h"
 #include "JSphInOut.h"
 #include "JSphShifting.h"
+#include "JDsNgListCpu.h"
+#include "JDsPeriodicHaloCpu.h"
 
 #include <climits>
+#include <vector>
+#include <cstring>
 
 using namespace std;
 
@@ -55,6 +59,8 @@ JSphCpu::JSphCpu(bool withmpi):JSph(true,false,withmpi){
   CellDiv=NULL;
   ArraysCpu=new JArraysCpu;
   Timersc=new JDsTimersCpu;
+  NgList=NULL;
+  PeriHalo=NULL;
   InitVars();
 }
 
@@ -67,6 +73,8 @@ JSphCpu::~JSphCpu(){
   FreeCpuMemoryFixed();
   delete ArraysCpu; ArraysCpu=NULL;
   delete Timersc;   Timersc=NULL;
+  delete NgList;    NgList=NULL;
+  delete PeriHalo;  PeriHalo=NULL;
 }
 
 //==============================================================================
@@ -89,12 +97,32 @@ void JSphCpu::InitVars(){
   Arc=NULL; Acec=NULL; Deltac=NULL;
   ShiftPosfsc=NULL;               //-Shifting.
   Pressc=NULL;
+  PressDivide=false;
+  PosCellc=NULL;
   RidpMove=NULL; 
+  RidpMoveOk=false;
   FtRidp=NULL;
+  FtRidpOk=false;
   FtoForces=NULL;
   FtoForcesRes=NULL;
+  CellOrder=CELLORDER_Linear;
+  NgListSkin=0;
+  PeriHaloMargin=0;
+  PeriPosMin=PeriPosMax=TDouble3(0);
+  UsePosCell=false;
+  SimdMode=SIMD_None;
+  FusedCorr=false;
+  InterCounters=false;
   FreeCpuMemoryParticles();
   FreeCpuMemoryFixed();
+  //-Particle arrays reordered in divide. | Arrays de particulas reordenados en el divide.
+  SortArrays.clear();
+  AddSortArray(&Idpc);   AddSortArray(&Codec); AddSortArray(&Dcellc);
+  AddSortArray(&Posc);   AddSortArray(&Velrhopc);
+  AddSortArray(&VelrhopM1c);                      //-Verlet
+  AddSortArray(&PosPrec); AddSortArray(&VelrhopPrec); //-Symplectic
+  AddSortArray(&SpsTauc);                         //-Laminar+SPS.
+  AddSortArray(&BoundNormalc); AddSortArray(&MotionVelc); //-mDBC
 }
 
 //==============================================================================
@@ -159,6 +187,7 @@ void JSphCpu::AllocCpuMemoryParticles(unsigned np,float over){
   #endif
   ArraysCpu->AddArrayCount(JArraysCpu::SIZE_4B,5);  //-idp,ar,viscdt,dcell,prrhop
   if(DDTArray)ArraysCpu->AddArrayCount(JArraysCpu::SIZE_4B,1);  //-delta
+  if(TBoundary!=BC_MDBC && !InOut)ArraysCpu->AddArrayCount(JArraysCpu::SIZE_4B,1);  //-press computed in divide (kept until interaction)
   ArraysCpu->AddArrayCount(JArraysCpu::SIZE_12B,1); //-ace
   ArraysCpu->AddArrayCount(JArraysCpu::SIZE_16B,2); //-velrhop,poscell
   ArraysCpu->AddArrayCount(JArraysCpu::SIZE_24B,2); //-pos
@@ -186,6 +215,10 @@ void JSphCpu::AllocCpuMemoryParticles(unsigned np,float over){
   //-Shows the allocated memory.
   MemCpuParticles=ArraysCpu->GetAllocMemoryCpu();
   PrintSizeNp(CpuParticlesSize,MemCpuParticles,0);
+  //-Shows the alignment and placement on NUMA nodes of allocated memory.
+  const string numa=ArraysCpu->GetNumaInfo();
+  Log->Printf("**CPU memory for particles aligned to %s%s",(ArraysCpu->GetHugePages()? "2 MB (huge pages)": "64 bytes")
+    ,(numa.empty()? "": (" - NUMA pages: "+numa).c_str()));
 }
 
 //==============================================================================
@@ -305,6 +338,8 @@ llong JSphCpu::GetAllocMemoryCpu()const{
   s+=MemCpuFixed;
   //-Reserved in other objects.
   if(MLPistons)s+=MLPistons->GetAllocMemoryCpu();
+  if(NgList)s+=NgList->GetAllocMemory();
+  if(PeriHalo)s+=PeriHalo->GetAllocMemory();
   return(s);
 }
 
@@ -381,7 +416,6 @@ void JSphCpu::ConfigOmp(const JSphCfgRun *cfg){
   if(Cpu && cfg->OmpThreads!=1){
     OmpThreads=cfg->OmpThreads;
     if(OmpThreads<=0)OmpThreads=max(omp_get_num_procs(),1);
-    if(OmpThreads>OMP_MAXTHREADS)OmpThreads=OMP_MAXTHREADS;
     omp_set_num_threads(OmpThreads);
     Log->Printf("Threads by host for parallel execution: %d",omp_get_max_threads());
   }
@@ -394,6 +428,23 @@ void JSphCpu::ConfigOmp(const JSphCfgRun *cfg){
 #endif
 }
 
+//==============================================================================
+/// Configures instruction set for SIMD fluid interaction according to the
+/// current CPU.
+/// Configura el juego de instrucciones para la interaccion SIMD del fluido
+/// segun la CPU actual.
+//==============================================================================
+void JSphCpu::ConfigSimd(const JSphCfgRun *cfg){
+  SimdMode=SIMD_None;
+  if(cfg->SimdMode!=0){
+    const TpSimdMode available=fsimd::GetSimdAvailable();
+    const TpSimdMode mode=(cfg->SimdMode<0? available: TpSimdMode(cfg->SimdMode));
+    if(mode>available)Log->PrintfWarning("SIMD mode %s is not available on this CPU, so %s is used."
+      ,fsimd::GetSimdModeName(mode),fsimd::GetSimdModeName(available));
+    SimdMode=(mode>available? available: mode);
+  }
+}
+
 //==============================================================================
 /// Configures execution mode in CPU.
 /// Configura modo de ejecucion en CPU.
@@ -403,9 +454,25 @@ void JSphCpu::ConfigRunMode(){
   //-Defines RunMode.
   RunMode="";
   if(Stable)RunMode=RunMode+(!RunMode.empty()? " - ": "") + "Stable";
-  RunMode=RunMode+(!RunMode.empty()? " - ": "") + "Pos-Double";
+  if(UsePosCell && Symmetry){
+    Log->PrintWarning("PosCell is not used with symmetry, so double precision positions are used in interaction.");
+    UsePosCell=false;
+  }
+  RunMode=RunMode+(!RunMode.empty()? " - ": "") + (UsePosCell? "Pos-Cell": "Pos-Double");
   if(OmpThreads==1)RunMode=RunMode+(!RunMode.empty()? " - ": "") + "Single core";
   else             RunMode=RunMode+(!RunMode.empty()? " - ": "") + fun::PrintStr("OpenMP(Threads:%d)",OmpThreads); 
+  //-Checks SIMD interaction is compatible with the configuration.
+  if(SimdMode!=SIMD_None){
+    const bool simdok=(TKernel==KERNEL_Wendland && FtMode==FTMODE_None && TVisco==VISCO_Artificial && !Shifting && !Symmetry);
+    if(!simdok){
+      Log->PrintWarning("SIMD interaction is only supported with Wendland kernel, artificial viscosity and without floatings, shifting or symmetry, so the original interaction is used.");
+      SimdMode=SIMD_None;
+    }
+    else RunMode=RunMode+(!RunMode.empty()? " - ": "") + fun::PrintStr("SIMD(%s)",fsimd::GetSimdModeName(SimdMode));
+  }
+  //-Checks fused update of Symplectic-Corrector is useful (only with shifting or damping with planes).
+  if(FusedCorr)FusedCorr=(TStep==STEP_Symplectic && (Shifting || Damping) && (!Damping || Damping->OnlyPlanes()));
+  if(FusedCorr)RunMode=RunMode+(!RunMode.empty()? " - ": "") + "FusedCorr";
   //-Shows RunMode.
   Log->Print(" ");
   Log->Print(fun::VarStr("RunMode",RunMode));
@@ -438,18 +505,22 @@ void JSphCpu::PreInteractionVars_Forces(unsigned np,unsigned npb){
   if(SpsGradvelc)memset(SpsGradvelc+npb,0,sizeof(tsymatrix3f)*npf);  //SpsGradvelc[]=(0,0,0,0,0,0).
 
   //-Select particles for shifting.
-  if(ShiftPosfsc)Shifting->InitCpu(npf,npb,Posc,ShiftPosfsc);
+  if(ShiftPosfsc)Shifting->InitCpu(npf,npb,Posc,ShiftPosfsc,DivData);
 
   //-Adds variable acceleration from input configuration.
   if(AccInput)AccInput->RunCpu(TimeStep,Gravity,npf,npb,Codec,Posc,Velrhopc,Acec);
 
-  //-Prepare press values for interaction.
-  const int n=int(np);
-  #ifdef OMP_USE
-    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
-  #endif
-  for(int p=0;p<n;p++){
-    Pressc[p]=fsph::ComputePress(Velrhopc[p].w,CSP);
+  //-Prepare press and PosCell values for interaction (press may be computed in divide).
+  const bool press=!PressDivide;
+  if(press || PosCellc){
+    const int n=int(np);
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int p=0;p<n;p++){
+      if(press)Pressc[p]=fsph::ComputePress(Velrhopc[p].w,CSP);
+      if(PosCellc)PosCellc[p]=nsearch::PosCellCalc(Posc[p],Dcellc[p],DivData);
+    }
   }
 }
 
@@ -464,7 +535,8 @@ void JSphCpu::PreInteraction_Forces(){
   Acec=ArraysCpu->ReserveFloat3();
   if(DDTArray)Deltac=ArraysCpu->ReserveFloat();
   if(Shifting)ShiftPosfsc=ArraysCpu->ReserveFloat4();
-  Pressc=ArraysCpu->ReserveFloat();
+  if(!PressDivide)Pressc=ArraysCpu->ReserveFloat();
+  if(UsePosCell)PosCellc=ArraysCpu->ReserveFloat4();
   if(TVisco==VISCO_LaminarSPS)SpsGradvelc=ArraysCpu->ReserveSymatrix3f();
 
   //-Initialise arrays.
@@ -538,287 +610,505 @@ void JSphCpu::PosInteraction_Forces(){
   ArraysCpu->Free(Deltac);       Deltac=NULL;
   ArraysCpu->Free(ShiftPosfsc);  ShiftPosfsc=NULL;
   ArraysCpu->Free(Pressc);       Pressc=NULL;
+  PressDivide=false;
+  ArraysCpu->Free(PosCellc);     PosCellc=NULL;
   ArraysCpu->Free(SpsGradvelc);  SpsGradvelc=NULL;
 }
 
 //==============================================================================
 /// Perform interaction between particles. Bound-Fluid/Float
+/// The code for symmetry is only compiled with sym and with pips the checked
+/// and real interactions are added to pic and pir.
 /// Realiza interaccion entre particulas. Bound-Fluid/Float
+/// El codigo para simetria solo se compila con sym y con pips las interacciones
+/// comprobadas y reales se suman a pic y pir.
 //==============================================================================
-template<TpKernel tker,TpFtMode ftmode> void JSphCpu::InteractionForcesBound
-  (unsigned n,unsigned pinit,StDivDataCpu divdata,const unsigned *dcell
-  ,const tdouble3 *pos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
-  ,float &viscdt,float *ar)const
+template<TpKernel tker,TpFtMode ftmode,bool sym,bool pips> void JSphCpu::InteractionForcesBound
+  (unsigned n,unsigned pinit,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
+  ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+  ,float &viscdt,float *ar,ullong &pir,ullong &pic)const
 {
-  //-Initialize viscth to calculate max viscdt with OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
-  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
-  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  const bool ngl=(nglist.ng!=NULL); //-Uses neighbour list instead of cells. | Usa lista de vecinos en lugar de celdas.
+  const bool pscel=(poscell!=NULL); //-Uses PosCell instead of double positions. | Usa PosCell en lugar de posiciones double.
   //-Starts execution using OpenMP.
   const int pfin=int(pinit+n);
   #ifdef OMP_USE
-    #pragma omp parallel for schedule (guided)
+    #pragma omp parallel
   #endif
-  for(int p1=int(pinit);p1<pfin;p1++){
-    float visc=0,arp1=0;
-
-    //-Load data of particle p1. | Carga datos de particula p1.
-    const tdouble3 posp1=pos[p1];
-    const bool rsymp1=(Symmetry && posp1.y<=KernelSize); //<vs_syymmetry>
-    const tfloat4 velrhop1=velrhop[p1];
-
-    //-Search for neighbours in adjacent cells.
-    const StNgSearch ngs=nsearch::Init(dcell[p1],false,divdata);
-    for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
-      const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
-
-      //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
-      //---------------------------------------------------------------------------------------------
-      bool rsym=false; //<vs_syymmetry>
-      for(unsigned p2=pif.x;p2<pif.y;p2++){
-        const float drx=float(posp1.x-pos[p2].x);
-              float dry=float(posp1.y-pos[p2].y);
-        if(rsym)    dry=float(posp1.y+pos[p2].y); //<vs_syymmetry>
-        const float drz=float(posp1.z-pos[p2].z);
-        const float rr2=drx*drx+dry*dry+drz*drz;
-        if(rr2<=KernelSize2 && rr2>=ALMOSTZERO){
-          //-Computes kernel.
-          const float fac=fsph::GetKernel_Fac<tker>(CSP,rr2);
-          const float frx=fac*drx,fry=fac*dry,frz=fac*drz; //-Gradients.
-
-          //===== Get mass of particle p2 ===== 
-          float massp2=MassFluid; //-Contains particle mass of incorrect fluid. | Contiene masa de particula por defecto fluid.
-          bool compute=true;      //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
-          if(USE_FLOATING){
-            bool ftp2=CODE_IsFloating(code[p2]);
-            if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
-            compute=!(USE_FTEXTERNAL && ftp2); //-Deactivate when using DEM/Chrono and/or bound-float. | Se desactiva cuando se usa DEM/Chrono y es bound-float.
-          }
+  {
+    const double thtini=Timersc->TmThStart(); //-Busy time of thread. | Tiempo de trabajo del hilo.
+    float viscth=0; //-Max viscdt of thread. | Viscdt maximo del hilo.
+    ullong pirth=0,picth=0; //-Real and checked interactions of thread. | Interacciones reales y comprobadas del hilo.
+    #ifdef OMP_USE
+      #pragma omp for schedule (guided) nowait
+    #endif
+    for(int p1=int(pinit);p1<pfin;p1++){
+      float visc=0,arp1=0;
 
-          if(compute){
-            //-Density derivative (Continuity equation).
-            tfloat4 velrhop2=velrhop[p2];
-            if(rsym)velrhop2.y=-velrhop2.y; //<vs_syymmetry>
-            const float dvx=velrhop1.x-velrhop2.x, dvy=velrhop1.y-velrhop2.y, dvz=velrhop1.z-velrhop2.z;
-            if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz)*(velrhop1.w/velrhop2.w);
+      //-Load data of particle p1. | Carga datos de particula p1.
+      const tdouble3 posp1=pos[p1];
+      const bool rsymp1=(sym && posp1.y<=KernelSize); //<vs_syymmetry>
+      const tfloat4 pscellp1=(pscel? poscell[p1]: TFloat4(0));
+      const tint3 celp1=(pscel? nsearch::PosCellGetCell(pscellp1,divdata): TInt3(0));
+      const tfloat4 velrhop1=velrhop[p1];
+
+      //-Search for neighbours in adjacent cells or in neighbour list.
+      const StNgSearch ngs=(ngl? nsearch::InitNgList(): nsearch::Init(dcell[p1],false,divdata));
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=(ngl? nsearch::ParticleRangeNgList(y,p1,false,nglist): nsearch::ParticleRange(y,z,ngs,divdata));
+
+        //-Interaction of boundary with type Fluid/Float | Interaccion de Bound con varias Fluid/Float.
+        //---------------------------------------------------------------------------------------------
+        bool rsym=false; //<vs_syymmetry>
+        for(unsigned cp2=pif.x;cp2<pif.y;cp2++){
+          const unsigned p2=(ngl? nglist.buildtocur[nglist.ng[cp2]]: cp2);
+          const tfloat4 dr=(pscel? nsearch::PosCellDistances(pscellp1,celp1,poscell[p2],divdata): nsearch::Distances(posp1,pos[p2]));
+          const float drx=dr.x;
+                float dry=dr.y;
+          if(sym && rsym)dry=float(posp1.y+pos[p2].y); //<vs_syymmetry>
+          const float drz=dr.z;
+          const float rr2=drx*drx+dry*dry+drz*drz;
+          if(pips)picth++;
+          if(rr2<=KernelSize2 && rr2>=ALMOSTZERO){
+            if(pips)pirth++;
+            //-Computes kernel.
+            const float fac=fsph::GetKernel_Fac<tker>(CSP,rr2);
+            const float frx=fac*drx,fry=fac*dry,frz=fac*drz; //-Gradients.
+
+            //===== Get mass of particle p2 ===== 
+            float massp2=MassFluid; //-Contains particle mass of incorrect fluid. | Contiene masa de particula por defecto fluid.
+            bool compute=true;      //-Deactivate when using DEM and/or bound-float. | Se desactiva cuando se usa DEM y es bound-float.
+            if(USE_FLOATING){
+              bool ftp2=CODE_IsFloating(code[p2]);
+              if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
+              compute=!(USE_FTEXTERNAL && ftp2); //-Deactivate when using DEM/Chrono and/or bound-float. | Se desactiva cuando se usa DEM/Chrono y es bound-float.
+            }
 
-            {//-Viscosity.
-              const float dot=drx*dvx + dry*dvy + drz*dvz;
-              const float dot_rr2=dot/(rr2+Eta2);
-              visc=max(dot_rr2,visc);
+            if(compute){
+              //-Density derivative (Continuity equation).
+              tfloat4 velrhop2=velrhop[p2];
+              if(sym && rsym)velrhop2.y=-velrhop2.y; //<vs_syymmetry>
+              const float dvx=velrhop1.x-velrhop2.x, dvy=velrhop1.y-velrhop2.y, dvz=velrhop1.z-velrhop2.z;
+              if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz)*(velrhop1.w/velrhop2.w);
+
+              {//-Viscosity.
+                const float dot=drx*dvx + dry*dvy + drz*dvz;
+                const float dot_rr2=dot/(rr2+Eta2);
+                visc=max(dot_rr2,visc);
+              }
             }
+            if(sym){                                                    //<vs_syymmetry>
+              rsym=(rsymp1 && !rsym && float(posp1.y-dry)<=KernelSize); //<vs_syymmetry>
+              if(rsym)cp2--;                                            //<vs_syymmetry>
+            }                                                           //<vs_syymmetry>
           }
-          rsym=(rsymp1 && !rsym && float(posp1.y-dry)<=KernelSize); //<vs_syymmetry>
-          if(rsym)p2--;                                             //<vs_syymmetry>
+          else if(sym)rsym=false;                                       //<vs_syymmetry>
         }
-        else rsym=false;                                            //<vs_syymmetry>
+      }
+      //-Sum results together. | Almacena resultados.
+      if(arp1||visc){
+        ar[p1]+=arp1;
+        if(visc>viscth)viscth=visc;
       }
     }
-    //-Sum results together. | Almacena resultados.
-    if(arp1||visc){
-      ar[p1]+=arp1;
-      const int th=omp_get_thread_num();
-      if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
+    Timersc->TmThStop(TMC_CfBound,thtini);
+    #ifdef OMP_USE
+      #pragma omp critical
+    #endif
+    {
+      if(viscdt<viscth)viscdt=viscth; //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+      if(pips){ pir+=pirth; pic+=picth; }
     }
   }
-  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
-  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
 }
 
 //==============================================================================
 /// Perform interaction between particles: Fluid/Float-Fluid/Float or Fluid/Float-Bound
+/// The code for symmetry is only compiled with sym and with pips the checked
+/// and real interactions are added to pic and pir. With epi the final values of
+/// each particle are completed (2D, Delta-SPH) and the maximum ace^2 is stored in acemax.
 /// Realiza interaccion entre particulas: Fluid/Float-Fluid/Float or Fluid/Float-Bound
+/// El codigo para simetria solo se compila con sym y con pips las interacciones
+/// comprobadas y reales se suman a pic y pir. Con epi se completan los valores
+/// finales de cada particula (2D, Delta-SPH) y se guarda el ace^2 maximo en acemax.
 //==============================================================================
-template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift> 
+template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym,bool pips,bool epi> 
   void JSphCpu::InteractionForcesFluid(unsigned n,unsigned pinit,bool boundp2,float visco
-  ,StDivDataCpu divdata,const unsigned *dcell
+  ,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
   ,const tsymatrix3f* tau,tsymatrix3f* gradvel
-  ,const tdouble3 *pos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+  ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
   ,const float *press,const tfloat3 *dengradcorr
   ,float &viscdt,float *ar,tfloat3 *ace,float *delta
-  ,TpShifting shiftmode,tfloat4 *shiftposfs)const
+  ,TpShifting shiftmode,tfloat4 *shiftposfs,ullong &pir,ullong &pic,float &acemax)const
 {
-  //-Initialize viscth to calculate viscdt maximo con OpenMP. | Inicializa viscth para calcular visdt maximo con OpenMP.
-  float viscth[OMP_MAXTHREADS*OMP_STRIDE];
-  for(int th=0;th<OmpThreads;th++)viscth[th*OMP_STRIDE]=0;
+  const bool ngl=(nglist.ng!=NULL); //-Uses neighbour list instead of cells. | Usa lista de vecinos en lugar de celdas.
+  const bool pscel=(poscell!=NULL); //-Uses PosCell instead of double positions. | Usa PosCell en lugar de posiciones double.
   //-Initialise execution with OpenMP. | Inicia ejecucion con OpenMP.
   const int pfin=int(pinit+n);
   #ifdef OMP_USE
-    #pragma omp parallel for schedule (guided)
+    #pragma omp parallel
   #endif
-  for(int p1=int(pinit);p1<pfin;p1++){
-    float visc=0,arp1=0,deltap1=0;
-    tfloat3 acep1=TFloat3(0);
-    tsymatrix3f gradvelp1={0,0,0,0,0,0};
-
-    //-Variables for Shifting.
-    tfloat4 shiftposfsp1;
-    if(shift)shiftposfsp1=shiftposfs[p1];
-
-    //-Obtain data of particle p1 in case of floating objects. | Obtiene datos de particula p1 en caso de existir floatings.
-    bool ftp1=false;     //-Indicate if it is floating. | Indica si es floating.
-    if(USE_FLOATING){
-      ftp1=CODE_IsFloating(code[p1]);
-      if(ftp1 && tdensity!=DDT_None)deltap1=FLT_MAX; //-DDT is not applied to floating particles.
-      if(ftp1 && shift)shiftposfsp1.x=FLT_MAX;  //-For floating objects do not calculate shifting. | Para floatings no se calcula shifting.
-    }
-
-    //-Obtain data of particle p1.
-    const tdouble3 posp1=pos[p1];
-    const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
-    const float rhopp1=velrhop[p1].w;
-    const float pressp1=press[p1];
-    const tsymatrix3f taup1=(tvisco==VISCO_Artificial? gradvelp1: tau[p1]);
-    const bool rsymp1=(Symmetry && posp1.y<=KernelSize); //<vs_syymmetry>
-
-    //-Search for neighbours in adjacent cells.
-    const StNgSearch ngs=nsearch::Init(dcell[p1],boundp2,divdata);
-    for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
-      const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
-
-      //-Interaction of Fluid with type Fluid or Bound. | Interaccion de Fluid con varias Fluid o Bound.
-      //------------------------------------------------------------------------------------------------
-      bool rsym=false; //<vs_syymmetry>
-      for(unsigned p2=pif.x;p2<pif.y;p2++){
-        const float drx=float(posp1.x-pos[p2].x);
-              float dry=float(posp1.y-pos[p2].y);
-        if(rsym)    dry=float(posp1.y+pos[p2].y); //<vs_syymmetry>
-        const float drz=float(posp1.z-pos[p2].z);
-        const float rr2=drx*drx+dry*dry+drz*drz;
-        if(rr2<=KernelSize2 && rr2>=ALMOSTZERO){
-          //-Computes kernel.
-          const float fac=fsph::GetKernel_Fac<tker>(CSP,rr2);
-          const float frx=fac*drx,fry=fac*dry,frz=fac*drz; //-Gradients.
-
-          //===== Get mass of particle p2 ===== 
-          float massp2=(boundp2? MassBound: MassFluid); //-Contiene masa de particula segun sea bound o fluid.
-          bool ftp2=false;    //-Indicate if it is floating | Indica si es floating.
-          bool compute=true;  //-Deactivate when using DEM and if it is of type float-float or float-bound | Se desactiva cuando se usa DEM y es float-float o float-bound.
-          if(USE_FLOATING){
-            ftp2=CODE_IsFloating(code[p2]);
-            if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
-            #ifdef DELTA_HEAVYFLOATING
-              if(ftp2 && tdensity==DDT_DDT && massp2<=(MassFluid*1.2f))deltap1=FLT_MAX;
-            #else
-              if(ftp2 && tdensity==DDT_DDT)deltap1=FLT_MAX;
-            #endif
-            if(ftp2 && shift && shiftmode==SHIFT_NoBound)shiftposfsp1.x=FLT_MAX; //-With floating objects do not use shifting. | Con floatings anula shifting.
-            compute=!(USE_FTEXTERNAL && ftp1 && (boundp2 || ftp2)); //-Deactivate when using DEM and if it is of type float-float or float-bound. | Se desactiva cuando se usa DEM y es float-float o float-bound.
-          }
+  {
+    const double thtini=Timersc->TmThStart(); //-Busy time of thread. | Tiempo de trabajo del hilo.
+    float viscth=0; //-Max viscdt of thread. | Viscdt maximo del hilo.
+    float acemaxth=0; //-Max ace^2 of thread. | Ace^2 maximo del hilo.
+    ullong pirth=0,picth=0; //-Real and checked interactions of thread. | Interacciones reales y comprobadas del hilo.
+    #ifdef OMP_USE
+      #pragma omp for schedule (guided) nowait
+    #endif
+    for(int p1=int(pinit);p1<pfin;p1++){
+      float visc=0,arp1=0,deltap1=0;
+      tfloat3 acep1=TFloat3(0);
+      tsymatrix3f gradvelp1={0,0,0,0,0,0};
+
+      //-Variables for Shifting.
+      tfloat4 shiftposfsp1;
+      if(shift)shiftposfsp1=shiftposfs[p1];
+
+      //-Obtain data of particle p1 in case of floating objects. | Obtiene datos de particula p1 en caso de existir floatings.
+      bool ftp1=false;     //-Indicate if it is floating. | Indica si es floating.
+      if(USE_FLOATING){
+        ftp1=CODE_IsFloating(code[p1]);
+        if(ftp1 && tdensity!=DDT_None)deltap1=FLT_MAX; //-DDT is not applied to floating particles.
+        if(ftp1 && shift)shiftposfsp1.x=FLT_MAX;  //-For floating objects do not calculate shifting. | Para floatings no se calcula shifting.
+      }
 
-          tfloat4 velrhop2=velrhop[p2];
-          if(rsym)velrhop2.y=-velrhop2.y; //<vs_syymmetry>
+      //-Obtain data of particle p1.
+      const tdouble3 posp1=pos[p1];
+      const tfloat3 velp1=TFloat3(velrhop[p1].x,velrhop[p1].y,velrhop[p1].z);
+      const float rhopp1=velrhop[p1].w;
+      const float pressp1=press[p1];
+      const tsymatrix3f taup1=(tvisco==VISCO_Artificial? gradvelp1: tau[p1]);
+      const bool rsymp1=(sym && posp1.y<=KernelSize); //<vs_syymmetry>
+      const tfloat4 pscellp1=(pscel? poscell[p1]: TFloat4(0));
+      const tint3 celp1=(pscel? nsearch::PosCellGetCell(pscellp1,divdata): TInt3(0));
+
+      //-Search for neighbours in adjacent cells or in neighbour list.
+      const StNgSearch ngs=(ngl? nsearch::InitNgList(): nsearch::Init(dcell[p1],boundp2,divdata));
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=(ngl? nsearch::ParticleRangeNgList(y,p1,boundp2,nglist): nsearch::ParticleRange(y,z,ngs,divdata));
+
+        //-Interaction of Fluid with type Fluid or Bound. | Interaccion de Fluid con varias Fluid o Bound.
+        //------------------------------------------------------------------------------------------------
+        bool rsym=false; //<vs_syymmetry>
+        for(unsigned cp2=pif.x;cp2<pif.y;cp2++){
+          const unsigned p2=(ngl? nglist.buildtocur[nglist.ng[cp2]]: cp2);
+          const tfloat4 dr=(pscel? nsearch::PosCellDistances(pscellp1,celp1,poscell[p2],divdata): nsearch::Distances(posp1,pos[p2]));
+          const float drx=dr.x;
+                float dry=dr.y;
+          if(sym && rsym)dry=float(posp1.y+pos[p2].y); //<vs_syymmetry>
+          const float drz=dr.z;
+          const float rr2=drx*drx+dry*dry+drz*drz;
+          if(pips)picth++;
+          if(rr2<=KernelSize2 && rr2>=ALMOSTZERO){
+            if(pips)pirth++;
+            //-Computes kernel.
+            const float fac=fsph::GetKernel_Fac<tker>(CSP,rr2);
+            const float frx=fac*drx,fry=fac*dry,frz=fac*drz; //-Gradients.
+
+            //===== Get mass of particle p2 ===== 
+            float massp2=(boundp2? MassBound: MassFluid); //-Contiene masa de particula segun sea bound o fluid.
+            bool ftp2=false;    //-Indicate if it is floating | Indica si es floating.
+            bool compute=true;  //-Deactivate when using DEM and if it is of type float-float or float-bound | Se desactiva cuando se usa DEM y es float-float o float-bound.
+            if(USE_FLOATING){
+              ftp2=CODE_IsFloating(code[p2]);
+              if(ftp2)massp2=FtObjs[CODE_GetTypeValue(code[p2])].massp;
+              #ifdef DELTA_HEAVYFLOATING
+                if(ftp2 && tdensity==DDT_DDT && massp2<=(MassFluid*1.2f))deltap1=FLT_MAX;
+              #else
+                if(ftp2 && tdensity==DDT_DDT)deltap1=FLT_MAX;
+              #endif
+              if(ftp2 && shift && shiftmode==SHIFT_NoBound)shiftposfsp1.x=FLT_MAX; //-With floating objects do not use shifting. | Con floatings anula shifting.
+              compute=!(USE_FTEXTERNAL && ftp1 && (boundp2 || ftp2)); //-Deactivate when using DEM and if it is of type float-float or float-bound. | Se desactiva cuando se usa DEM y es float-float o float-bound.
+            }
 
-          //-Velocity derivative (Momentum equation).
-          if(compute){
-            const float prs=(pressp1+press[p2])/(rhopp1*velrhop2.w) + (tker==KERNEL_Cubic? fsph::GetKernelCubic_Tensil(CSP,rr2,rhopp1,pressp1,velrhop2.w,press[p2]): 0);
-            const float p_vpm=-prs*massp2;
-            acep1.x+=p_vpm*frx; acep1.y+=p_vpm*fry; acep1.z+=p_vpm*frz;
-          }
+            tfloat4 velrhop2=velrhop[p2];
+            if(sym && rsym)velrhop2.y=-velrhop2.y; //<vs_syymmetry>
 
-          //-Density derivative (Continuity equation).
-          const float dvx=velp1.x-velrhop2.x, dvy=velp1.y-velrhop2.y, dvz=velp1.z-velrhop2.z;
-          if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz)*(rhopp1/velrhop2.w);
-
-          const float cbar=(float)Cs0;
-          //-Density Diffusion Term (Molteni and Colagrossi 2009).
-          if(tdensity==DDT_DDT && deltap1!=FLT_MAX){
-            const float rhop1over2=rhopp1/velrhop2.w;
-            const float visc_densi=DDTkh*cbar*(rhop1over2-1.f)/(rr2+Eta2);
-            const float dot3=(drx*frx+dry*fry+drz*frz);
-            const float delta=visc_densi*dot3*massp2;
-            //deltap1=(boundp2? FLT_MAX: deltap1+delta);
-            deltap1=(boundp2 && TBoundary==BC_DBC? FLT_MAX: deltap1+delta);
-          }
-          //-Density Diffusion Term (Fourtakas et al 2019).
-          if((tdensity==DDT_DDT2 || (tdensity==DDT_DDT2Full && !boundp2)) && deltap1!=FLT_MAX && !ftp2){
-            const float rh=1.f+DDTgz*drz;
-            const float drhop=RhopZero*pow(rh,1.f/Gamma)-RhopZero;    
-            const float visc_densi=DDTkh*cbar*((velrhop2.w-rhopp1)-drhop)/(rr2+Eta2);
-            const float dot3=(drx*frx+dry*fry+drz*frz);
-            const float delta=visc_densi*dot3*massp2/velrhop2.w;
-            deltap1=(boundp2? FLT_MAX: deltap1-delta); //-blocks it makes it boil - bloody DBC
-          }
-          
-          //-Shifting correction.
-          if(shift && shiftposfsp1.x!=FLT_MAX){
-            const float massrhop=massp2/velrhop2.w;
-            const bool noshift=(boundp2 && (shiftmode==SHIFT_NoBound || (shiftmode==SHIFT_NoFixed && CODE_IsFixed(code[p2]))));
-            shiftposfsp1.x=(noshift? FLT_MAX: shiftposfsp1.x+massrhop*frx); //-For boundary do not use shifting. | Con boundary anula shifting.
-            shiftposfsp1.y+=massrhop*fry;
-            shiftposfsp1.z+=massrhop*frz;
-            shiftposfsp1.w-=massrhop*(drx*frx+dry*fry+drz*frz);
-          }
+            //-Velocity derivative (Momentum equation).
+            if(compute){
+              const float prs=(pressp1+press[p2])/(rhopp1*velrhop2.w) + (tker==KERNEL_Cubic? fsph::GetKernelCubic_Tensil(CSP,rr2,rhopp1,pressp1,velrhop2.w,press[p2]): 0);
+              const float p_vpm=-prs*massp2;
+              acep1.x+=p_vpm*frx; acep1.y+=p_vpm*fry; acep1.z+=p_vpm*frz;
+            }
 
-          //===== Viscosity ===== 
-          if(compute){
-            const float dot=drx*dvx + dry*dvy + drz*dvz;
-            const float dot_rr2=dot/(rr2+Eta2);
-            visc=max(dot_rr2,visc);
-            if(tvisco==VISCO_Artificial){//-Artificial viscosity.
-              if(dot<0){
-                const float amubar=KernelH*dot_rr2;  //amubar=CTE.h*dot/(rr2+CTE.eta2);
-                const float robar=(rhopp1+velrhop2.w)*0.5f;
-                const float pi_visc=(-visco*cbar*amubar/robar)*massp2;
-                acep1.x-=pi_visc*frx; acep1.y-=pi_visc*fry; acep1.z-=pi_visc*frz;
-              }
+            //-Density derivative (Continuity equation).
+            const float dvx=velp1.x-velrhop2.x, dvy=velp1.y-velrhop2.y, dvz=velp1.z-velrhop2.z;
+            if(compute)arp1+=massp2*(dvx*frx+dvy*fry+dvz*frz)*(rhopp1/velrhop2.w);
+
+            const float cbar=(float)Cs0;
+            //-Density Diffusion Term (Molteni and Colagrossi 2009).
+            if(tdensity==DDT_DDT && deltap1!=FLT_MAX){
+              const float rhop1over2=rhopp1/velrhop2.w;
+              const float visc_densi=DDTkh*cbar*(rhop1over2-1.f)/(rr2+Eta2);
+              const float dot3=(drx*frx+dry*fry+drz*frz);
+              const float delta=visc_densi*dot3*massp2;
+              //deltap1=(boundp2? FLT_MAX: deltap1+delta);
+              deltap1=(boundp2 && TBoundary==BC_DBC? FLT_MAX: deltap1+delta);
             }
-            else if(tvisco==VISCO_LaminarSPS){//-Laminar+SPS viscosity. 
-              {//-Laminar contribution.
-                const float robar2=(rhopp1+velrhop2.w);
-                const float temp=4.f*visco/((rr2+Eta2)*robar2);  //-Simplification of: temp=2.0f*visco/((rr2+CTE.eta2)*robar); robar=(rhopp1+velrhop2.w)*0.5f;
-                const float vtemp=massp2*temp*(drx*frx+dry*fry+drz*frz);  
-                acep1.x+=vtemp*dvx; acep1.y+=vtemp*dvy; acep1.z+=vtemp*dvz;
-              }
-              //-SPS turbulence model.
-              float tau_xx=taup1.xx,tau_xy=taup1.xy,tau_xz=taup1.xz; //-taup1 is always zero when p1 is not a fluid particle. | taup1 siempre es cero cuando p1 no es fluid.
-              float tau_yy=taup1.yy,tau_yz=taup1.yz,tau_zz=taup1.zz;
-              if(!boundp2 && !ftp2){//-When p2 is a fluid particle. 
-                tau_xx+=tau[p2].xx; tau_xy+=tau[p2].xy; tau_xz+=tau[p2].xz;
-                tau_yy+=tau[p2].yy; tau_yz+=tau[p2].yz; tau_zz+=tau[p2].zz;
+            //-Density Diffusion Term (Fourtakas et al 2019).
+            if((tdensity==DDT_DDT2 || (tdensity==DDT_DDT2Full && !boundp2)) && deltap1!=FLT_MAX && !ftp2){
+              const float rh=1.f+DDTgz*drz;
+              const float drhop=RhopZero*pow(rh,1.f/Gamma)-RhopZero;    
+              const float visc_densi=DDTkh*cbar*((velrhop2.w-rhopp1)-drhop)/(rr2+Eta2);
+              const float dot3=(drx*frx+dry*fry+drz*frz);
+              const float delta=visc_densi*dot3*massp2/velrhop2.w;
+              deltap1=(boundp2? FLT_MAX: deltap1-delta); //-blocks it makes it boil - bloody DBC
+            }
+            
+            //-Shifting correction.
+            if(shift && shiftposfsp1.x!=FLT_MAX){
+              const float massrhop=massp2/velrhop2.w;
+              const bool noshift=(boundp2 && (shiftmode==SHIFT_NoBound || (shiftmode==SHIFT_NoFixed && CODE_IsFixed(code[p2]))));
+              shiftposfsp1.x=(noshift? FLT_MAX: shiftposfsp1.x+massrhop*frx); //-For boundary do not use shifting. | Con boundary anula shifting.
+              shiftposfsp1.y+=massrhop*fry;
+              shiftposfsp1.z+=massrhop*frz;
+              shiftposfsp1.w-=massrhop*(drx*frx+dry*fry+drz*frz);
+            }
+
+            //===== Viscosity ===== 
+            if(compute){
+              const float dot=drx*dvx + dry*dvy + drz*dvz;
+              const float dot_rr2=dot/(rr2+Eta2);
+              visc=max(dot_rr2,visc);
+              if(tvisco==VISCO_Artificial){//-Artificial viscosity.
+                if(dot<0){
+                  const float amubar=KernelH*dot_rr2;  //amubar=CTE.h*dot/(rr2+CTE.eta2);
+                  const float robar=(rhopp1+velrhop2.w)*0.5f;
+                  const float pi_visc=(-visco*cbar*amubar/robar)*massp2;
+                  acep1.x-=pi_visc*frx; acep1.y-=pi_visc*fry; acep1.z-=pi_visc*frz;
+                }
               }
-              acep1.x+=massp2*(tau_xx*frx + tau_xy*fry + tau_xz*frz);
-              acep1.y+=massp2*(tau_xy*frx + tau_yy*fry + tau_yz*frz);
-              acep1.z+=massp2*(tau_xz*frx + tau_yz*fry + tau_zz*frz);
-              //-Velocity gradients.
-              if(!ftp1){//-When p1 is a fluid particle. 
-                const float volp2=-massp2/velrhop2.w;
-                float dv=dvx*volp2; gradvelp1.xx+=dv*frx; gradvelp1.xy+=dv*fry; gradvelp1.xz+=dv*frz;
-                      dv=dvy*volp2; gradvelp1.xy+=dv*frx; gradvelp1.yy+=dv*fry; gradvelp1.yz+=dv*frz;
-                      dv=dvz*volp2; gradvelp1.xz+=dv*frx; gradvelp1.yz+=dv*fry; gradvelp1.zz+=dv*frz;
-                //-To compute tau terms we assume that gradvel.xy=gradvel.dudy+gradvel.dvdx, gradvel.xz=gradvel.dudz+gradvel.dwdx, gradvel.yz=gradvel.dvdz+gradvel.dwdy
-                //-so only 6 elements are needed instead of 3x3.
+              else if(tvisco==VISCO_LaminarSPS){//-Laminar+SPS viscosity. 
+                {//-Laminar contribution.
+                  const float robar2=(rhopp1+velrhop2.w);
+                  const float temp=4.f*visco/((rr2+Eta2)*robar2);  //-Simplification of: temp=2.0f*visco/((rr2+CTE.eta2)*robar); robar=(rhopp1+velrhop2.w)*0.5f;
+                  const float vtemp=massp2*temp*(drx*frx+dry*fry+drz*frz);  
+                  acep1.x+=vtemp*dvx; acep1.y+=vtemp*dvy; acep1.z+=vtemp*dvz;
+                }
+                //-SPS turbulence model.
+                float tau_xx=taup1.xx,tau_xy=taup1.xy,tau_xz=taup1.xz; //-taup1 is always zero when p1 is not a fluid particle. | taup1 siempre es cero cuando p1 no es fluid.
+                float tau_yy=taup1.yy,tau_yz=taup1.yz,tau_zz=taup1.zz;
+                if(!boundp2 && !ftp2){//-When p2 is a fluid particle. 
+                  tau_xx+=tau[p2].xx; tau_xy+=tau[p2].xy; tau_xz+=tau[p2].xz;
+                  tau_yy+=tau[p2].yy; tau_yz+=tau[p2].yz; tau_zz+=tau[p2].zz;
+                }
+                acep1.x+=massp2*(tau_xx*frx + tau_xy*fry + tau_xz*frz);
+                acep1.y+=massp2*(tau_xy*frx + tau_yy*fry + tau_yz*frz);
+                acep1.z+=massp2*(tau_xz*frx + tau_yz*fry + tau_zz*frz);
+                //-Velocity gradients.
+                if(!ftp1){//-When p1 is a fluid particle. 
+                  const float volp2=-massp2/velrhop2.w;
+                  float dv=dvx*volp2; gradvelp1.xx+=dv*frx; gradvelp1.xy+=dv*fry; gradvelp1.xz+=dv*frz;
+                        dv=dvy*volp2; gradvelp1.xy+=dv*frx; gradvelp1.yy+=dv*fry; gradvelp1.yz+=dv*frz;
+                        dv=dvz*volp2; gradvelp1.xz+=dv*frx; gradvelp1.yz+=dv*fry; gradvelp1.zz+=dv*frz;
+                  //-To compute tau terms we assume that gradvel.xy=gradvel.dudy+gradvel.dvdx, gradvel.xz=gradvel.dudz+gradvel.dwdx, gradvel.yz=gradvel.dvdz+gradvel.dwdy
+                  //-so only 6 elements are needed instead of 3x3.
+                }
               }
             }
+            if(sym){                                                    //<vs_syymmetry>
+              rsym=(rsymp1 && !rsym && float(posp1.y-dry)<=KernelSize); //<vs_syymmetry>
+              if(rsym)cp2--;                                            //<vs_syymmetry>
+            }                                                           //<vs_syymmetry>
           }
-          rsym=(rsymp1 && !rsym && float(posp1.y-dry)<=KernelSize); //<vs_syymmetry>
-          if(rsym)p2--;                                             //<vs_syymmetry>
+          else if(sym)rsym=false;                                       //<vs_syymmetry>
+        }
+      }
+      //-Sum results together. | Almacena resultados.
+      if(shift||arp1||acep1.x||acep1.y||acep1.z||visc){
+        if(tdensity!=DDT_None){
+          if(delta)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
+          else if(deltap1!=FLT_MAX)arp1+=deltap1;
+        }
+        ar[p1]+=arp1;
+        ace[p1]=ace[p1]+acep1;
+        if(visc>viscth)viscth=visc;
+        if(tvisco==VISCO_LaminarSPS){
+          gradvel[p1].xx+=gradvelp1.xx;
+          gradvel[p1].xy+=gradvelp1.xy;
+          gradvel[p1].xz+=gradvelp1.xz;
+          gradvel[p1].yy+=gradvelp1.yy;
+          gradvel[p1].yz+=gradvelp1.yz;
+          gradvel[p1].zz+=gradvelp1.zz;
+        }
+        if(shift)shiftposfs[p1]=shiftposfsp1;
+      }
+      //-Fused epilogue: 2D zeroing, Delta-SPH and maximum ace (only in the last fluid interaction).
+      //-Epilogo fusionado: anula 2D, Delta-SPH y ace maxima (solo en la ultima interaccion del fluido).
+      if(epi){
+        tfloat3 acef=ace[p1];
+        if(Simulate2D){ acef.y=0; ace[p1].y=0; }
+        if(delta && delta[p1]!=FLT_MAX)ar[p1]+=delta[p1];
+        const typecode cod=code[p1];
+        if(CODE_IsNormal(cod) && !CODE_IsFluidInout(cod)){
+          const float a2=acef.x*acef.x+acef.y*acef.y+acef.z*acef.z;
+          if(acemaxth<a2)acemaxth=a2;
         }
-        else rsym=false;                                            //<vs_syymmetry>
       }
     }
-    //-Sum results together. | Almacena resultados.
-    if(shift||arp1||acep1.x||acep1.y||acep1.z||visc){
-      if(tdensity!=DDT_None){
-        if(delta)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
-        else if(deltap1!=FLT_MAX)arp1+=deltap1;
+    Timersc->TmThStop(TMC_CfFluid,thtini);
+    #ifdef OMP_USE
+      #pragma omp critical
+    #endif
+    {
+      if(viscdt<viscth)viscdt=viscth; //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+      if(pips){ pir+=pirth; pic+=picth; }
+      if(epi && acemax<acemaxth)acemax=acemaxth;
+    }
+  }
+}
+
+//==============================================================================
+/// Perform interaction between particles: Fluid-Fluid or Fluid-Bound using SIMD
+/// instructions (only Wendland kernel and artificial viscosity without floatings,
+/// shifting or symmetry). Neighbours inside the kernel are copied to SoA arrays
+/// in single precision to compute 8 or 16 neighbours at once. With pips the
+/// checked and real interactions are added to pic and pir. With epi the fused
+/// epilogue of InteractionForcesFluid() is also applied.
+/// Realiza interaccion entre particulas: Fluid-Fluid or Fluid-Bound usando
+/// instrucciones SIMD. Los vecinos dentro del kernel se copian en arrays SoA en
+/// simple precision para calcular 8 o 16 vecinos a la vez. Con pips las
+/// interacciones comprobadas y reales se suman a pic y pir. Con epi tambien se
+/// aplica el epilogo fusionado de InteractionForcesFluid().
+//==============================================================================
+template<TpDensity tdensity,bool pips,bool epi> void JSphCpu::InteractionForcesFluidSimd
+  (unsigned n,unsigned pinit,bool boundp2,float visco
+  ,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
+  ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const float *press
+  ,float &viscdt,float *ar,tfloat3 *ace,float *delta,ullong &pir,ullong &pic,float &acemax)const
+{
+  const bool ngl=(nglist.ng!=NULL); //-Uses neighbour list instead of cells. | Usa lista de vecinos en lugar de celdas.
+  const bool pscel=(poscell!=NULL); //-Uses PosCell instead of double positions. | Usa PosCell en lugar de posiciones double.
+  const TpSimdMode simdmode=SimdMode;
+  //-Any neighbour cancels DDT with boundaries. | Cualquier vecino anula DDT con contorno.
+  const bool ddtinf=(boundp2 && ((tdensity==DDT_DDT && TBoundary==BC_DBC) || tdensity==DDT_DDT2));
+  const bool ddt2=(tdensity==DDT_DDT2 || (tdensity==DDT_DDT2Full && !boundp2));
+  const int ddtmode=(ddtinf? 0: (tdensity==DDT_DDT? 1: (ddt2? 2: 0)));
+  //-Constants of interaction. | Constantes de la interaccion.
+  fsimd::StSimdCtes ctes;
+  ctes.massp2=(boundp2? MassBound: MassFluid);
+  ctes.kernelh=KernelH;
+  ctes.bwen=CSP.kwend.bwen;
+  ctes.eta2=Eta2;
+  ctes.viscocbar=visco*float(Cs0);
+  ctes.ddtkhcbar=DDTkh*float(Cs0);
+  ctes.ddtmode=ddtmode;
+  //-Initialise execution with OpenMP. | Inicia ejecucion con OpenMP.
+  const int pfin=int(pinit+n);
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    const double thtini=Timersc->TmThStart(); //-Busy time of thread. | Tiempo de trabajo del hilo.
+    float viscth=0; //-Max viscdt of thread. | Viscdt maximo del hilo.
+    float acemaxth=0; //-Max ace^2 of thread. | Ace^2 maximo del hilo.
+    ullong pirth=0,picth=0; //-Real and checked interactions of thread. | Interacciones reales y comprobadas del hilo.
+    //-SoA memory of thread for neighbours. | Memoria SoA del hilo para vecinos.
+    const unsigned narrays=10;
+    unsigned simdsize=0;
+    std::vector<float> simdbuf;
+    fsimd::StSimdData sd;
+    #ifdef OMP_USE
+      #pragma omp for schedule (guided) nowait
+    #endif
+    for(int p1=int(pinit);p1<pfin;p1++){
+      //-Obtain data of particle p1.
+      const tdouble3 posp1=pos[p1];
+      const tfloat4 pscellp1=(pscel? poscell[p1]: TFloat4(0));
+      const tint3 celp1=(pscel? nsearch::PosCellGetCell(pscellp1,divdata): TInt3(0));
+      const tfloat4 velrhop1=velrhop[p1];
+
+      //-Copies neighbours inside kernel to SoA arrays. | Copia vecinos dentro del kernel en arrays SoA.
+      unsigned nn=0;
+      const StNgSearch ngs=(ngl? nsearch::InitNgList(): nsearch::Init(dcell[p1],boundp2,divdata));
+      for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+        const tuint2 pif=(ngl? nsearch::ParticleRangeNgList(y,p1,boundp2,nglist): nsearch::ParticleRange(y,z,ngs,divdata));
+        for(unsigned cp2=pif.x;cp2<pif.y;cp2++){
+          const unsigned p2=(ngl? nglist.buildtocur[nglist.ng[cp2]]: cp2);
+          const tfloat4 dr=(pscel? nsearch::PosCellDistances(pscellp1,celp1,poscell[p2],divdata): nsearch::Distances(posp1,pos[p2]));
+          const float drx=dr.x,dry=dr.y,drz=dr.z,rr2=dr.w;
+          if(pips)picth++;
+          if(rr2<=KernelSize2 && rr2>=ALMOSTZERO){
+            if(nn+SIMD_PADDING>=simdsize){
+              //-Resizes SoA memory keeping current neighbours. | Redimensiona memoria SoA manteniendo los vecinos actuales.
+              const unsigned size2=(simdsize? simdsize*2: 256);
+              std::vector<float> buf2(size_t(size2)*narrays);
+              for(unsigned c=0;c<narrays && nn;c++)memcpy(buf2.data()+size_t(size2)*c,simdbuf.data()+size_t(simdsize)*c,sizeof(float)*nn);
+              simdbuf.swap(buf2);
+              simdsize=size2;
+              float *ptr=simdbuf.data();
+              sd.drx =ptr;  sd.dry  =ptr+simdsize;   sd.drz=ptr+simdsize*2; sd.rr2=ptr+simdsize*3;
+              sd.dvx =ptr+simdsize*4;  sd.dvy=ptr+simdsize*5; sd.dvz=ptr+simdsize*6;
+              sd.rhop=ptr+simdsize*7;  sd.press=ptr+simdsize*8; sd.drhop=ptr+simdsize*9;
+            }
+            const tfloat4 velrhop2=velrhop[p2];
+            sd.drx[nn]=drx; sd.dry[nn]=dry; sd.drz[nn]=drz; sd.rr2[nn]=rr2;
+            sd.dvx[nn]=velrhop1.x-velrhop2.x;
+            sd.dvy[nn]=velrhop1.y-velrhop2.y;
+            sd.dvz[nn]=velrhop1.z-velrhop2.z;
+            sd.rhop[nn]=velrhop2.w;
+            sd.press[nn]=press[p2];
+            if(ddtmode==2){
+              const float rh=1.f+DDTgz*drz;
+              sd.drhop[nn]=RhopZero*pow(rh,1.f/Gamma)-RhopZero;
+            }
+            nn++;
+          }
+        }
       }
-      ar[p1]+=arp1;
-      ace[p1]=ace[p1]+acep1;
-      const int th=omp_get_thread_num();
-      if(visc>viscth[th*OMP_STRIDE])viscth[th*OMP_STRIDE]=visc;
-      if(tvisco==VISCO_LaminarSPS){
-        gradvel[p1].xx+=gradvelp1.xx;
-        gradvel[p1].xy+=gradvelp1.xy;
-        gradvel[p1].xz+=gradvelp1.xz;
-        gradvel[p1].yy+=gradvelp1.yy;
-        gradvel[p1].yz+=gradvelp1.yz;
-        gradvel[p1].zz+=gradvelp1.zz;
+
+      if(pips)pirth+=nn;
+      if(nn){
+        //-Fills up to SIMD_PADDING with neutral neighbours. | Completa hasta SIMD_PADDING con vecinos neutros.
+        const unsigned npad=(nn+SIMD_PADDING-1)/SIMD_PADDING*SIMD_PADDING;
+        for(unsigned c=nn;c<npad;c++){
+          sd.drx[c]=sd.dry[c]=sd.drz[c]=0; sd.rr2[c]=1.f;
+          sd.dvx[c]=sd.dvy[c]=sd.dvz[c]=0;
+          sd.rhop[c]=1.f; sd.press[c]=0; sd.drhop[c]=0;
+        }
+        //-Computes interaction with all neighbours. | Calcula interaccion con todos los vecinos.
+        fsimd::StSimdCtes ctesp1=ctes;
+        ctesp1.rhopp1=velrhop1.w;
+        ctesp1.pressp1=press[p1];
+        fsimd::StSimdRes res;
+        fsimd::InteractionFluid(simdmode,npad,sd,ctesp1,res);
+        float arp1=res.ar;
+        const float deltap1=(ddtinf? FLT_MAX: res.delta);
+        //-Sum results together. | Almacena resultados.
+        if(arp1||res.ace.x||res.ace.y||res.ace.z||res.visc){
+          if(tdensity!=DDT_None){
+            if(delta)delta[p1]=(delta[p1]==FLT_MAX || deltap1==FLT_MAX? FLT_MAX: delta[p1]+deltap1);
+            else if(deltap1!=FLT_MAX)arp1+=deltap1;
+          }
+          ar[p1]+=arp1;
+          ace[p1]=ace[p1]+res.ace;
+          if(res.visc>viscth)viscth=res.visc;
+        }
       }
-      if(shift)shiftposfs[p1]=shiftposfsp1;
+      //-Fused epilogue: 2D zeroing, Delta-SPH and maximum ace (only in the last fluid interaction).
+      //-Epilogo fusionado: anula 2D, Delta-SPH y ace maxima (solo en la ultima interaccion del fluido).
+      if(epi){
+        tfloat3 acef=ace[p1];
+        if(Simulate2D){ acef.y=0; ace[p1].y=0; }
+        if(delta && delta[p1]!=FLT_MAX)ar[p1]+=delta[p1];
+        const typecode cod=code[p1];
+        if(CODE_IsNormal(cod) && !CODE_IsFluidInout(cod)){
+          const float a2=acef.x*acef.x+acef.y*acef.y+acef.z*acef.z;
+          if(acemaxth<a2)acemaxth=a2;
+        }
+      }
+    }
+    Timersc->TmThStop(TMC_CfFluid,thtini);
+    #ifdef OMP_USE
+      #pragma omp critical
+    #endif
+    {
+      if(viscdt<viscth)viscdt=viscth; //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
+      if(pips){ pir+=pirth; pic+=picth; }
+      if(epi && acemax<acemaxth)acemax=acemaxth;
     }
   }
-  //-Keep max value in viscdt. | Guarda en viscdt el valor maximo.
-  for(int th=0;th<OmpThreads;th++)if(viscdt<viscth[th*OMP_STRIDE])viscdt=viscth[th*OMP_STRIDE];
 }
 
 //==============================================================================
@@ -831,96 +1121,103 @@ void JSphCpu::InteractionForcesDEM(unsigned nfloat,StDivDataCpu divdata,const un
   ,const typecode *code,const unsigned *idp
   ,float &viscdt,tfloat3 *ace)const
 {
-  //-Initialise demdtth to calculate max demdt with OpenMP. | Inicializa demdtth para calcular demdt maximo con OpenMP.
-  float demdtth[OMP_MAXTHREADS*OMP_STRIDE];
-  for(int th=0;th<OmpThreads;th++)demdtth[th*OMP_STRIDE]=-FLT_MAX;
   //-Initialise execution with OpenMP. | Inicia ejecucion con OpenMP.
   const int nft=int(nfloat);
+  float demdt=-FLT_MAX;
   #ifdef OMP_USE
-    #pragma omp parallel for schedule (guided)
+    #pragma omp parallel
   #endif
-  for(int cf=0;cf<nft;cf++){
-    const unsigned p1=ftridp[cf];
-    if(p1!=UINT_MAX){
-      float demdtp1=0;
-      tfloat3 acep1=TFloat3(0);
-
-      //-Get data of particle p1.
-      const tdouble3 posp1=pos[p1];
-      const typecode tavp1=CODE_GetTypeAndValue(code[p1]);
-      const float masstotp1=demdata[tavp1].mass;
-      const float taup1=demdata[tavp1].tau;
-      const float kfricp1=demdata[tavp1].kfric;
-      const float restitup1=demdata[tavp1].restitu;
-      const float ftmassp1=demdata[tavp1].massp;
-
-      //-Search for neighbours in adjacent cells (first bound and then fluid+floating).
-      for(byte tpfluid=0;tpfluid<=1;tpfluid++){
-        const StNgSearch ngs=nsearch::Init(dcell[p1],!tpfluid,divdata);
-        for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
-          const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
-
-          //-Interaction of Floating Object particles with type Fluid or Bound. | Interaccion de Floating con varias Fluid o Bound.
-          //-----------------------------------------------------------------------------------------------------------------------
-          for(unsigned p2=pif.x;p2<pif.y;p2++)if(CODE_IsNotFluid(code[p2]) && tavp1!=CODE_GetTypeAndValue(code[p2])){
-            const float drx=float(posp1.x-pos[p2].x);
-            const float dry=float(posp1.y-pos[p2].y);
-            const float drz=float(posp1.z-pos[p2].z);
-            const float rr2=drx*drx+dry*dry+drz*drz;
-            const float rad=sqrt(rr2);
-
-            //-Calculate max value of demdt. | Calcula valor maximo de demdt.
-            const typecode tavp2=CODE_GetTypeAndValue(code[p2]);
-            const float masstotp2=demdata[tavp2].mass;
-            const float taup2=demdata[tavp2].tau;
-            const float kfricp2=demdata[tavp2].kfric;
-            const float restitup2=demdata[tavp2].restitu;
-            //const StDemData *demp2=demobjs+CODE_GetTypeAndValue(code[p2]);
-
-            const float nu_mass=(!tpfluid? masstotp1/2: masstotp1*masstotp2/(masstotp1+masstotp2)); //-Con boundary toma la propia masa del floating 1.
-            const float kn=4/(3*(taup1+taup2))*sqrt(float(Dp)/4); //-Generalized rigidity - Lemieux 2008.
-            const float dvx=velrhop[p1].x-velrhop[p2].x, dvy=velrhop[p1].y-velrhop[p2].y, dvz=velrhop[p1].z-velrhop[p2].z; //vji
-            const float nx=drx/rad, ny=dry/rad, nz=drz/rad; //normal_ji               
-            const float vn=dvx*nx+dvy*ny+dvz*nz; //vji.nji
-            const float demvisc=0.2f/(3.21f*(pow(nu_mass/kn,0.4f)*pow(fabs(vn),-0.2f))/40.f);
-            if(demdtp1<demvisc)demdtp1=demvisc;
-
-            const float over_lap=1.0f*float(Dp)-rad; //-(ri+rj)-|dij|
-            if(over_lap>0.0f){ //-Contact.
-              //-Normal.
-              const float eij=(restitup1+restitup2)/2;
-              const float gn=-(2.0f*log(eij)*sqrt(nu_mass*kn))/(sqrt(float(PI)+log(eij)*log(eij))); //-Generalized damping - Cummins 2010.
-              //const float gn=0.08f*sqrt(nu_mass*sqrt(float(Dp)/2)/((taup1+taup2)/2)); //-Generalized damping - Lemieux 2008.
-              const float rep=kn*pow(over_lap,1.5f);
-              const float fn=rep-gn*pow(over_lap,0.25f)*vn;
-              float acef=fn/ftmassp1; //-Divides by the mass of particle to obtain the acceleration.
-              acep1.x+=(acef*nx); acep1.y+=(acef*ny); acep1.z+=(acef*nz); //-Force is applied in the normal between the particles.
-              //-Tangential.
-              const float dvxt=dvx-vn*nx, dvyt=dvy-vn*ny, dvzt=dvz-vn*nz; //Vji_t
-              const float vt=sqrt(dvxt*dvxt + dvyt*dvyt + dvzt*dvzt);
-              float tx=0, ty=0, tz=0; //-Tang vel unit vector.
-              if(vt!=0){ tx=dvxt/vt; ty=dvyt/vt; tz=dvzt/vt; }
-              const float ft_elast=2*(kn*float(DemDtForce)-gn)*vt/7; //-Elastic frictional string -->  ft_elast=2*(kn*fdispl-gn*vt)/7; fdispl=dtforce*vt;
-              const float kfric_ij=(kfricp1+kfricp2)/2;
-              float ft=kfric_ij*fn*tanh(8*vt);  //-Coulomb.
-              ft=(ft<ft_elast? ft: ft_elast);   //-Not above yield criteria, visco-elastic model.
-              acef=ft/ftmassp1; //-Divides by the mass of particle to obtain the acceleration.
-              acep1.x+=(acef*tx); acep1.y+=(acef*ty); acep1.z+=(acef*tz);
-            } 
+  {
+    float demdtth=-FLT_MAX; //-Max demdt of thread. | Demdt maximo del hilo.
+    #ifdef OMP_USE
+      #pragma omp for schedule (guided) nowait
+    #endif
+    for(int cf=0;cf<nft;cf++){
+      const unsigned p1=ftridp[cf];
+      if(p1!=UINT_MAX){
+        float demdtp1=0;
+        tfloat3 acep1=TFloat3(0);
+
+        //-Get data of particle p1.
+        const tdouble3 posp1=pos[p1];
+        const typecode tavp1=CODE_GetTypeAndValue(code[p1]);
+        const float masstotp1=demdata[tavp1].mass;
+        const float taup1=demdata[tavp1].tau;
+        const float kfricp1=demdata[tavp1].kfric;
+        const float restitup1=demdata[tavp1].restitu;
+        const float ftmassp1=demdata[tavp1].massp;
+
+        //-Search for neighbours in adjacent cells (first bound and then fluid+floating).
+        for(byte tpfluid=0;tpfluid<=1;tpfluid++){
+          const StNgSearch ngs=nsearch::Init(dcell[p1],!tpfluid,divdata);
+          for(int z=ngs.zini;z<ngs.zfin;z++)for(int y=ngs.yini;y<ngs.yfin;y++){
+            const tuint2 pif=nsearch::ParticleRange(y,z,ngs,divdata);
+
+            //-Interaction of Floating Object particles with type Fluid or Bound. | Interaccion de Floating con varias Fluid o Bound.
+            //-----------------------------------------------------------------------------------------------------------------------
+            for(unsigned p2=pif.x;p2<pif.y;p2++)if(CODE_IsNotFluid(code[p2]) && tavp1!=CODE_GetTypeAndValue(code[p2])){
+              const float drx=float(posp1.x-pos[p2].x);
+              const float dry=float(posp1.y-pos[p2].y);
+              const float drz=float(posp1.z-pos[p2].z);
+              const float rr2=drx*drx+dry*dry+drz*drz;
+              const float rad=sqrt(rr2);
+
+              //-Calculate max value of demdt. | Calcula valor maximo de demdt.
+              const typecode tavp2=CODE_GetTypeAndValue(code[p2]);
+              const float masstotp2=demdata[tavp2].mass;
+              const float taup2=demdata[tavp2].tau;
+              const float kfricp2=demdata[tavp2].kfric;
+              const float restitup2=demdata[tavp2].restitu;
+              //const StDemData *demp2=demobjs+CODE_GetTypeAndValue(code[p2]);
+
+              const float nu_mass=(!tpfluid? masstotp1/2: masstotp1*masstotp2/(masstotp1+masstotp2)); //-Con boundary toma la propia masa del floating 1.
+              const float kn=4/(3*(taup1+taup2))*sqrt(float(Dp)/4); //-Generalized rigidity - Lemieux 2008.
+              const float dvx=velrhop[p1].x-velrhop[p2].x, dvy=velrhop[p1].y-velrhop[p2].y, dvz=velrhop[p1].z-velrhop[p2].z; //vji
+              const float nx=drx/rad, ny=dry/rad, nz=drz/rad; //normal_ji               
+              const float vn=dvx*nx+dvy*ny+dvz*nz; //vji.nji
+              const float demvisc=0.2f/(3.21f*(pow(nu_mass/kn,0.4f)*pow(fabs(vn),-0.2f))/40.f);
+              if(demdtp1<demvisc)demdtp1=demvisc;
+
+              const float over_lap=1.0f*float(Dp)-rad; //-(ri+rj)-|dij|
+              if(over_lap>0.0f){ //-Contact.
+                //-Normal.
+                const float eij=(restitup1+restitup2)/2;
+                const float gn=-(2.0f*log(eij)*sqrt(nu_mass*kn))/(sqrt(float(PI)+log(eij)*log(eij))); //-Generalized damping - Cummins 2010.
+                //const float gn=0.08f*sqrt(nu_mass*sqrt(float(Dp)/2)/((taup1+taup2)/2)); //-Generalized damping - Lemieux 2008.
+                const float rep=kn*pow(over_lap,1.5f);
+                const float fn=rep-gn*pow(over_lap,0.25f)*vn;
+                float acef=fn/ftmassp1; //-Divides by the mass of particle to obtain the acceleration.
+                acep1.x+=(acef*nx); acep1.y+=(acef*ny); acep1.z+=(acef*nz); //-Force is applied in the normal between the particles.
+                //-Tangential.
+                const float dvxt=dvx-vn*nx, dvyt=dvy-vn*ny, dvzt=dvz-vn*nz; //Vji_t
+                const float vt=sqrt(dvxt*dvxt + dvyt*dvyt + dvzt*dvzt);
+                float tx=0, ty=0, tz=0; //-Tang vel unit vector.
+                if(vt!=0){ tx=dvxt/vt; ty=dvyt/vt; tz=dvzt/vt; }
+                const float ft_elast=2*(kn*float(DemDtForce)-gn)*vt/7; //-Elastic frictional string -->  ft_elast=2*(kn*fdispl-gn*vt)/7; fdispl=dtforce*vt;
+                const float kfric_ij=(kfricp1+kfricp2)/2;
+                float ft=kfric_ij*fn*tanh(8*vt);  //-Coulomb.
+                ft=(ft<ft_elast? ft: ft_elast);   //-Not above yield criteria, visco-elastic model.
+                acef=ft/ftmassp1; //-Divides by the mass of particle to obtain the acceleration.
+                acep1.x+=(acef*tx); acep1.y+=(acef*ty); acep1.z+=(acef*tz);
+              } 
+            }
           }
         }
+        //-Sum results together. | Almacena resultados.
+        if(acep1.x||acep1.y||acep1.z){
+          ace[p1]=ace[p1]+acep1;
+          if(demdtth<demdtp1)demdtth=demdtp1;
+        }
       }
-      //-Sum results together. | Almacena resultados.
-      if(acep1.x||acep1.y||acep1.z){
-        ace[p1]=ace[p1]+acep1;
-        const int th=omp_get_thread_num();
-        if(demdtth[th*OMP_STRIDE]<demdtp1)demdtth[th*OMP_STRIDE]=demdtp1;
-      }
+    }
+    #ifdef OMP_USE
+      #pragma omp critical
+    #endif
+    {
+      if(demdt<demdtth)demdt=demdtth;
     }
   }
   //-Update viscdt with max value of viscdt or demdt* | Actualiza viscdt con el valor maximo de viscdt y demdt*.
-  float demdt=demdtth[0];
-  for(int th=1;th<OmpThreads;th++)if(demdt<demdtth[th*OMP_STRIDE])demdt=demdtth[th*OMP_STRIDE];
   if(viscdt<demdt)viscdt=demdt;
 }
 
@@ -955,40 +1252,79 @@ void JSphCpu::ComputeSpsTau(unsigned n,unsigned pini,const tfloat4 *velrhop,cons
 
 //==============================================================================
 /// Interaction of Fluid-Fluid/Bound & Bound-Fluid (forces and DEM).
+/// With pips the checked and real interactions are added to res.
 /// Interaccion Fluid-Fluid/Bound & Bound-Fluid (forces and DEM).
+/// Con pips las interacciones comprobadas y reales se suman a res.
 //==============================================================================
-template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift>
+template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym,bool pips>
   void JSphCpu::Interaction_ForcesCpuT(const stinterparmsc &t,StInterResultc &res)const
 {
   float viscdt=res.viscdt;
+  //-Epilogue of fluid particles is fused in the last fluid interaction when DEM does not modify ace after it.
+  //-El epilogo de las particulas fluid se fusiona en la ultima interaccion del fluido cuando DEM no modifica ace despues.
+  const bool epi=(ftmode!=FTMODE_Ext);
+  float acemax=0;
   if(t.npf){
-    //-Interaction Fluid-Fluid.
-    InteractionForcesFluid<tker,ftmode,tvisco,tdensity,shift> (t.npf,t.npb,false,Visco                 
-      ,t.divdata,t.dcell,t.spstau,t.spsgradvel,t.pos,t.velrhop,t.code,t.idp,t.press,t.dengradcorr
-      ,viscdt,t.ar,t.ace,t.delta,t.shiftmode,t.shiftposfs);
-    //-Interaction Fluid-Bound.
-    InteractionForcesFluid<tker,ftmode,tvisco,tdensity,shift> (t.npf,t.npb,true ,Visco*ViscoBoundFactor
-      ,t.divdata,t.dcell,t.spstau,t.spsgradvel,t.pos,t.velrhop,t.code,t.idp,t.press,NULL
-      ,viscdt,t.ar,t.ace,t.delta,t.shiftmode,t.shiftposfs);
+    Timersc->TmStart(TMC_CfFluid);
+    if(tker==KERNEL_Wendland && ftmode==FTMODE_None && tvisco==VISCO_Artificial && !shift && SimdMode!=SIMD_None){
+      //-Interaction Fluid-Fluid & Fluid-Bound using SIMD instructions.
+      InteractionForcesFluidSimd<tdensity,pips,false> (t.npf,t.npb,false,Visco
+        ,t.divdata,t.dcell,t.nglist,t.pos,t.poscell,t.velrhop,t.code,t.press,viscdt,t.ar,t.ace,t.delta,res.pirf,res.picf,acemax);
+      InteractionForcesFluidSimd<tdensity,pips,epi> (t.npf,t.npb,true ,Visco*ViscoBoundFactor
+        ,t.divdata,t.dcell,t.nglist,t.pos,t.poscell,t.velrhop,t.code,t.press,viscdt,t.ar,t.ace,t.delta,res.pirf,res.picf,acemax);
+    }
+    else{
+      //-Interaction Fluid-Fluid.
+      InteractionForcesFluid<tker,ftmode,tvisco,tdensity,shift,sym,pips,false> (t.npf,t.npb,false,Visco                 
+        ,t.divdata,t.dcell,t.nglist,t.spstau,t.spsgradvel,t.pos,t.poscell,t.velrhop,t.code,t.idp,t.press,t.dengradcorr
+        ,viscdt,t.ar,t.ace,t.delta,t.shiftmode,t.shiftposfs,res.pirf,res.picf,acemax);
+      //-Interaction Fluid-Bound.
+      InteractionForcesFluid<tker,ftmode,tvisco,tdensity,shift,sym,pips,epi> (t.npf,t.npb,true ,Visco*ViscoBoundFactor
+        ,t.divdata,t.dcell,t.nglist,t.spstau,t.spsgradvel,t.pos,t.poscell,t.velrhop,t.code,t.idp,t.press,NULL
+        ,viscdt,t.ar,t.ace,t.delta,t.shiftmode,t.shiftposfs,res.pirf,res.picf,acemax);
+    }
+
+    Timersc->TmStop(TMC_CfFluid);
 
     //-Interaction of DEM Floating-Bound & Floating-Floating. //(DEM)
-    if(UseDEM)InteractionForcesDEM(CaseNfloat,t.divdata,t.dcell
-      ,FtRidp,DemData,t.pos,t.velrhop,t.code,t.idp,viscdt,t.ace);
+    if(UseDEM){
+      Timersc->TmStart(TMC_CfDem);
+      InteractionForcesDEM(CaseNfloat,t.divdata,t.dcell
+        ,FtRidp,DemData,t.pos,t.velrhop,t.code,t.idp,viscdt,t.ace);
+      Timersc->TmStop(TMC_CfDem);
+    }
 
     //-Computes tau for Laminar+SPS.
     if(tvisco==VISCO_LaminarSPS)ComputeSpsTau(t.npf,t.npb,t.velrhop,t.spsgradvel,t.spstau);
   }
   if(t.npbok){
     //-Interaction Bound-Fluid.
-    InteractionForcesBound<tker,ftmode> (t.npbok,0,t.divdata,t.dcell
-      ,t.pos,t.velrhop,t.code,t.idp,viscdt,t.ar);
+    Timersc->TmStart(TMC_CfBound);
+    InteractionForcesBound<tker,ftmode,sym,pips> (t.npbok,0,t.divdata,t.dcell,t.nglist
+      ,t.pos,t.poscell,t.velrhop,t.code,t.idp,viscdt,t.ar,res.pirb,res.picb);
+    Timersc->TmStop(TMC_CfBound);
   }
   res.viscdt=viscdt;
+  res.epilogue=epi;
+  res.acemax=sqrt(double(acemax));
+}
+//==============================================================================
+template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym> void JSphCpu::Interaction_Forces_ct6(const stinterparmsc &t,StInterResultc &res)const{
+  if(InterCounters)Interaction_ForcesCpuT<tker,ftmode,tvisco,tdensity,shift,sym,true >(t,res);
+  else             Interaction_ForcesCpuT<tker,ftmode,tvisco,tdensity,shift,sym,false>(t,res);
 }
 //==============================================================================
 template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity> void JSphCpu::Interaction_Forces_ct5(const stinterparmsc &t,StInterResultc &res)const{
-  if(Shifting)Interaction_ForcesCpuT<tker,ftmode,tvisco,tdensity,true >(t,res);
-  else        Interaction_ForcesCpuT<tker,ftmode,tvisco,tdensity,false>(t,res);
+  //-Symmetry is only allowed without floatings and with artificial viscosity, so it is only compiled for these cases.
+  const bool sym=(ftmode==FTMODE_None && tvisco==VISCO_Artificial); //<vs_syymmetry>
+  if(Symmetry){ //<vs_syymmetry>
+    if(Shifting)Interaction_Forces_ct6<tker,ftmode,tvisco,tdensity,true ,sym>(t,res);
+    else        Interaction_Forces_ct6<tker,ftmode,tvisco,tdensity,false,sym>(t,res);
+  }
+  else{
+    if(Shifting)Interaction_Forces_ct6<tker,ftmode,tvisco,tdensity,true ,false>(t,res);
+    else        Interaction_Forces_ct6<tker,ftmode,tvisco,tdensity,false,false>(t,res);
+  }
 }
 //==============================================================================
 template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco> void JSphCpu::Interaction_Forces_ct4(const stinterparmsc &t,StInterResultc &res)const{
@@ -1607,6 +1943,122 @@ void JSphCpu::ComputeSymplecticCorr(double dt){
 
 
 
+//==============================================================================
+/// Update particles according to forces and dt using Symplectic-Corrector in 
+/// one pass over fluid particles: shifting displacement (as RunShifting()), 
+/// integration and position update (as ComputeSymplecticCorr()) and damping 
+/// with planes (as RunDamping()). It applies the same operations as the 
+/// separate path, but results may differ in the last bits due to FP contraction
+/// and compiler optimizations (only used with -fusedcorr:1).
+///
+/// Actualizacion de particulas segun fuerzas y dt usando Symplectic-Corrector
+/// en una sola pasada sobre las particulas de fluido: desplazamiento de shifting, 
+/// integracion y actualizacion de posicion y damping de planos. Aplica las 
+/// mismas operaciones que el camino separado, pero los resultados pueden variar
+/// en los ultimos bits por la contraccion FP y optimizaciones del compilador.
+//==============================================================================
+template<bool shift,bool damp> void JSphCpu::ComputeSymplecticCorrT(double dt){
+  Timersc->TmStart(TMC_SuComputeStep);
+  const double dt05=dt*.5;
+  const int np=int(Np);
+  const int npb=int(Npb);
+  const int npf=np-npb;
+  
+  //-Calculate rhop of boudary and set velocity=0. | Calcula rhop de contorno y vel igual a cero.
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npb>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=0;p<npb;p++){
+    const double epsilon_rdot=(-double(Arc[p])/double(Velrhopc[p].w))*dt;
+    const float rhopnew=float(double(VelrhopPrec[p].w) * (2.-epsilon_rdot)/(2.+epsilon_rdot));
+    Velrhopc[p]=TFloat4(0,0,0,(rhopnew<RhopZero? RhopZero: rhopnew));//-Avoid fluid particles being absorbed by boundary ones. | Evita q las boundary absorvan a las fluidas.
+  }
+
+  //-Compute velocity, density and position of fluid and applies damping.
+  const tfloat3 *indirvel=(InOut? InOut->GetDirVel(): NULL);
+  const bool dampcode=(CaseNfloat || PeriActive); //-Damping ignores floating and periodic particles (as RunDamping()).
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTESTEP)
+  #endif
+  for(int p=npb;p<np;p++){
+    const typecode rcode=Codec[p];
+    const double epsilon_rdot=(-double(Arc[p])/double(Velrhopc[p].w))*dt;
+    const float rhopnew=float(double(VelrhopPrec[p].w) * (2.-epsilon_rdot)/(2.+epsilon_rdot));
+    const bool normal=(!PeriActive || CODE_IsNormal(rcode));
+    if(!WithFloating || CODE_IsFluid(rcode)){//-Fluid Particles.
+      //-Calculate velocity & density. | Calcula velocidad y densidad.
+      tfloat4 rvelrhopnew=TFloat4(
+        float(double(VelrhopPrec[p].x) + (double(Acec[p].x)+Gravity.x) * dt), 
+        float(double(VelrhopPrec[p].y) + (double(Acec[p].y)+Gravity.y) * dt), 
+        float(double(VelrhopPrec[p].z) + (double(Acec[p].z)+Gravity.z) * dt),
+        rhopnew);
+      //-Calculate displacement. | Calcula desplazamiento.
+      double dx=(double(VelrhopPrec[p].x)+double(rvelrhopnew.x)) * dt05; 
+      double dy=(double(VelrhopPrec[p].y)+double(rvelrhopnew.y)) * dt05; 
+      double dz=(double(VelrhopPrec[p].z)+double(rvelrhopnew.z)) * dt05;
+      if(shift){//-Shifting uses velocity before the update. | Shifting usa la velocidad antes de actualizar.
+        const tfloat4 shiftdis=Shifting->ComputeShiftCpu(dt,Velrhopc[p],ShiftPosfsc[p]);
+        dx+=double(shiftdis.x);
+        dy+=double(shiftdis.y);
+        dz+=double(shiftdis.z);
+      }
+      bool outrhop=(rhopnew<RhopOutMin || rhopnew>RhopOutMax);
+      //-Restore data of inout particles.
+      if(InOut && CODE_IsFluidInout(rcode)){
+        outrhop=false;
+        rvelrhopnew=VelrhopPrec[p];
+        const tfloat3 vd=indirvel[CODE_GetIzoneFluidInout(rcode)];
+        if(vd.x!=FLT_MAX){
+          const float v=rvelrhopnew.x*vd.x + rvelrhopnew.y*vd.y + rvelrhopnew.z*vd.z;
+          dx=double(v*vd.x) * dt;
+          dy=double(v*vd.y) * dt;
+          dz=double(v*vd.z) * dt;
+        }
+        else{
+          dx=double(rvelrhopnew.x) * dt; 
+          dy=double(rvelrhopnew.y) * dt; 
+          dz=double(rvelrhopnew.z) * dt;
+        }
+      }
+      //-Update particle data.
+      outrhop=(outrhop && CODE_IsNormal(rcode)); //-Only brands as excluded normal particles (not periodic). | Solo marca como excluidas las normales (no periodicas).
+      if(outrhop)Codec[p]=CODE_SetOutRhop(rcode);
+      //-Applies displacement to non-periodic fluid particles.
+      if(normal)UpdatePos(PosPrec[p],dx,dy,dz,outrhop,p,Posc,Dcellc,Codec);
+      //-Applies damping according to updated position.
+      if(damp && (!dampcode || (CODE_IsNormal(Codec[p]) && CODE_IsFluid(Codec[p]))))Damping->ComputeDampingPointCpu(dt,Posc[p],rvelrhopnew);
+      Velrhopc[p]=rvelrhopnew;
+    }
+    else{//-Floating Particles.
+      Velrhopc[p]=VelrhopPrec[p];
+      Velrhopc[p].w=(rhopnew<RhopZero? RhopZero: rhopnew); //-Avoid fluid particles being absorbed by floating ones. | Evita q las floating absorvan a las fluidas.
+      if(normal)Posc[p]=PosPrec[p]; //-Copy position of floating particles.
+    }
+  }
+
+  //-Free memory assigned to variables Pre and ComputeSymplecticPre(). | Libera memoria asignada a variables Pre en ComputeSymplecticPre().
+  ArraysCpu->Free(PosPrec);      PosPrec=NULL;
+  ArraysCpu->Free(VelrhopPrec);  VelrhopPrec=NULL;
+  Timersc->TmStop(TMC_SuComputeStep);
+}
+
+//==============================================================================
+/// Selection of template parameters for ComputeSymplecticCorrT.
+/// Seleccion de parametros template para ComputeSymplecticCorrT.
+//==============================================================================
+void JSphCpu::ComputeSymplecticCorrFused(double dt){
+  const bool shift=(Shifting!=NULL);
+  const bool damp=(Damping!=NULL);
+  if(shift){
+    if(damp)ComputeSymplecticCorrT<true ,true >(dt);
+    else    ComputeSymplecticCorrT<true ,false>(dt);
+  }
+  else{
+    if(damp)ComputeSymplecticCorrT<false,true >(dt);
+    else    ComputeSymplecticCorrT<false,false>(dt);
+  }
+}
+
 //==============================================================================
 /// Calculate variable Dt.
 /// Calcula un Dt variable.
@@ -1692,9 +2144,12 @@ void JSphCpu::CalcRidp(bool periactive,unsigned np,unsigned pini,unsigned idini,
 void JSphCpu::MoveLinBound(unsigned np,unsigned ini,const tdouble3 &mvpos,const tfloat3 &mvvel
   ,const unsigned *ridp,tdouble3 *pos,unsigned *dcell,tfloat4 *velrhop,typecode *code)const
 {
-  const unsigned fin=ini+np;
-  for(unsigned id=ini;id<fin;id++){
-    const unsigned pid=RidpMove[id];
+  const int fin=int(ini+np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(int(np)>OMP_LIMIT_COMPUTEMEDIUM)
+  #endif
+  for(int id=int(ini);id<fin;id++){
+    const unsigned pid=ridp[id];
     if(pid!=UINT_MAX){
       UpdatePos(pos[pid],mvpos.x,mvpos.y,mvpos.z,false,pid,pos,dcell,code);
       velrhop[pid].x=mvvel.x;  velrhop[pid].y=mvvel.y;  velrhop[pid].z=mvvel.z;
@@ -1709,9 +2164,12 @@ void JSphCpu::MoveLinBound(unsigned np,unsigned ini,const tdouble3 &mvpos,const
 void JSphCpu::MoveMatBound(unsigned np,unsigned ini,tmatrix4d m,double dt,const unsigned *ridpmv
   ,tdouble3 *pos,unsigned *dcell,tfloat4 *velrhop,typecode *code,tfloat3 *boundnormal)const
 {
-  const unsigned fin=ini+np;
-  for(unsigned id=ini;id<fin;id++){
-    const unsigned pid=RidpMove[id];
+  const int fin=int(ini+np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(int(np)>OMP_LIMIT_COMPUTEMEDIUM)
+  #endif
+  for(int id=int(ini);id<fin;id++){
+    const unsigned pid=ridpmv[id];
     if(pid!=UINT_MAX){
       const tdouble3 ps=pos[pid];
       tdouble3 ps2=MatrixMulPoint(m,ps);
@@ -1736,8 +2194,12 @@ void JSphCpu::MoveMatBound(unsigned np,unsigned ini,tmatrix4d m,double dt,const
 void JSphCpu::CopyMotionVel(unsigned nmoving,const unsigned *ridp
   ,const tfloat4 *velrhop,tfloat3 *motionvel)const
 {
-  for(unsigned id=0;id<nmoving;id++){
-    const unsigned pid=RidpMove[id];
+  const int n=int(nmoving);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int id=0;id<n;id++){
+    const unsigned pid=ridp[id];
     if(pid!=UINT_MAX){
       const tfloat4 v=velrhop[pid];
       motionvel[pid]=TFloat3(v.x,v.y,v.z);
@@ -1769,7 +2231,8 @@ void JSphCpu::RunMotion(double stepdt){
   if(WaveGen)CalcMotionWaveGen(stepdt);
   //-Process particles motion.
   if(DsMotion->GetActiveMotion()){
-    CalcRidp(PeriActive!=0,Npb,0,CaseNfixed,CaseNfixed+CaseNmoving,Codec,Idpc,RidpMove);
+    if(!RidpMoveOk)CalcRidp(PeriActive!=0,Npb,0,CaseNfixed,CaseNfixed+CaseNmoving,Codec,Idpc,RidpMove);
+    RidpMoveOk=true;
     BoundChanged=true;
     const unsigned nref=DsMotion->GetNumObjects();
     for(unsigned ref=0;ref<nref;ref++){
@@ -1786,7 +2249,8 @@ void JSphCpu::RunMotion(double stepdt){
   }
   //-Management of Multi-Layer Pistons.
   if(MLPistons){
-    if(!BoundChanged)CalcRidp(PeriActive!=0,Npb,0,CaseNfixed,CaseNfixed+CaseNmoving,Codec,Idpc,RidpMove);
+    if(!RidpMoveOk)CalcRidp(PeriActive!=0,Npb,0,CaseNfixed,CaseNfixed+CaseNmoving,Codec,Idpc,RidpMove);
+    RidpMoveOk=true;
     BoundChanged=true;
     if(MLPistons->GetPiston1dCount()){//-Process motion for pistons 1D.
       MLPistons->CalculateMotion1d(TimeStep+MLPistons->GetTimeMod()+stepdt);
@@ -1800,7 +2264,11 @@ void JSphCpu::RunMotion(double stepdt){
         ,RidpMove,Posc,Dcellc,Velrhopc,Codec);
     }
   }
-  if(MotionVelc)CopyMotionVel(CaseNmoving,RidpMove,Velrhopc,MotionVelc);
+  if(MotionVelc){
+    if(!RidpMoveOk)CalcRidp(PeriActive!=0,Npb,0,CaseNfixed,CaseNfixed+CaseNmoving,Codec,Idpc,RidpMove);
+    RidpMoveOk=true;
+    CopyMotionVel(CaseNmoving,RidpMove,Velrhopc,MotionVelc);
+  }
   Timersc->TmStop(TMC_SuMotion);
 }
 
@@ -1873,12 +2341,18 @@ void JSphCpu::RunRelaxZone(double dt){
 }
 
 //==============================================================================
-/// Applies Damping to selected particles.
-/// Aplica Damping a las particulas indicadas.
+/// Applies Damping to selected particles. Bounded zones only process the cells
+/// of the last divide, except with periodic conditions or inlet/outlet since 
+/// particles can change their position without a new divide.
+/// Aplica Damping a las particulas indicadas. Las zonas acotadas solo procesan
+/// las celdas del ultimo divide, excepto con condiciones periodicas o 
+/// inlet/outlet porque las particulas pueden cambiar su posicion sin un nuevo
+/// divide.
 //==============================================================================
 void JSphCpu::RunDamping(double dt,unsigned np,unsigned npb,const tdouble3 *pos,const typecode *code,tfloat4 *velrhop)const{
   const typecode *codeptr=(CaseNfloat || PeriActive? code: NULL);
-  Damping->ComputeDampingCpu(TimeStep,dt,np-npb,npb,pos,codeptr,velrhop);
+  const StDivDataCpu divdata=(PeriActive || InOut? DivDataCpuNull(): DivData);
+  Damping->ComputeDampingCpu(TimeStep,dt,np-npb,npb,pos,codeptr,velrhop,divdata);
 }
 
 //==============================================================================
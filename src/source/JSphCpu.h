@@ -24,8 +24,10 @@
 #include "DualSphDef.h"
 #include "JDsTimersCpu.h"
 #include "JCellDivDataCpu.h"
+#include "JSphCpuSimd.h"
 #include "JSph.h"
 #include <string>
+#include <vector>
 
 
 ///Structure with the parameters for particle interaction on CPU.
@@ -33,7 +35,9 @@ typedef struct{
   unsigned np,npb,npbok,npf; // npf=np-npb
   StDivDataCpu divdata;
   const unsigned *dcell;
+  StNgListCpu nglist;
   const tdouble3 *pos;
+  const tfloat4 *poscell;
   const tfloat4 *velrhop;
   const unsigned *idp;
   const typecode *code;
@@ -50,8 +54,8 @@ typedef struct{
 
 ///Collects parameters for particle interaction on CPU.
 inline stinterparmsc StInterparmsc(unsigned np,unsigned npb,unsigned npbok
-  ,StDivDataCpu divdata,const unsigned *dcell
-  ,const tdouble3 *pos,const tfloat4 *velrhop,const unsigned *idp,const typecode *code
+  ,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
+  ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const unsigned *idp,const typecode *code
   ,const float *press
   ,const tfloat3 *dengradcorr
   ,float* ar,tfloat3 *ace,float *delta
@@ -60,8 +64,8 @@ inline stinterparmsc StInterparmsc(unsigned np,unsigned npb,unsigned npbok
 )
 {
   stinterparmsc d={np,npb,npbok,(np-npb)
-    ,divdata,dcell
-    ,pos,velrhop,idp,code
+    ,divdata,dcell,nglist
+    ,pos,poscell,velrhop,idp,code
     ,press
     ,dengradcorr
     ,ar,ace,delta
@@ -75,12 +79,20 @@ inline stinterparmsc StInterparmsc(unsigned np,unsigned npb,unsigned npbok
 ///Structure to collect interaction results.
 typedef struct{
   float viscdt;
+  ullong pirf;  ///<Real interactions of fluid particles (only with InterCounters).
+  ullong pirb;  ///<Real interactions of bound particles (only with InterCounters).
+  ullong picf;  ///<Checked interactions of fluid particles (only with InterCounters).
+  ullong picb;  ///<Checked interactions of bound particles (only with InterCounters).
+  bool epilogue;  ///<2D zeroing, Delta-SPH and acemax were applied in the fluid interaction.
+  double acemax;  ///<Maximum value of ace of fluid particles (only with epilogue).
 }StInterResultc;
 
 
 class JDsPartsOut;
 class JArraysCpu;
 class JCellDivCpu;
+class JDsNgListCpu;
+class JDsPeriodicHaloCpu;
 
 //##############################################################################
 //# JSphCpu
@@ -115,6 +127,7 @@ protected:
 
   //-Particle Position according to id. | Posicion de particula segun id.
   unsigned *RidpMove; ///<Only for moving boundary particles [CaseNmoving] and when CaseNmoving!=0 | Solo para boundary moving particles [CaseNmoving] y cuando CaseNmoving!=0 
+  bool RidpMoveOk;    ///<RidpMove[] is valid for current order of particles (it is updated in RunCellDivide()). | RidpMove[] es valido para el orden actual de particulas.
 
   //-List of particle arrays on CPU. | Lista de arrays en CPU para particulas.
   JArraysCpu* ArraysCpu;
@@ -138,6 +151,7 @@ protected:
 
   //-Variables for floating bodies.
   unsigned *FtRidp;             ///<Identifier to access to the particles of the floating object [CaseNfloat].
+  bool FtRidpOk;                ///<FtRidp[] is valid for current order of particles (it is updated in RunCellDivide()).
   StFtoForces *FtoForces;       ///<Stores forces of floatings [FtCount].
   StFtoForcesRes *FtoForcesRes; ///<Stores data to update floatings [FtCount].
 
@@ -154,6 +168,8 @@ protected:
 
   //-Variables for computing forces. | Vars. derivadas para computo de fuerzas.
   float *Pressc;       ///<Pressure computed starting from density for interaction. Press[]=fsph::ComputePress(Rhop,CSP)
+  bool PressDivide;    ///<Pressc was computed while particles were sorted in last divide and it is still valid. | Pressc se calculo al ordenar particulas en el ultimo divide y sigue siendo valido.
+  tfloat4 *PosCellc;   ///<Position relative to its cell (x,y,z) and cell code (w) for interaction (NULL when PosCell is not used). | Posicion relativa a su celda y codigo de celda para la interaccion.
 
   //-Variables for Laminar+SPS viscosity.  
   tsymatrix3f *SpsTauc;       ///<SPS sub-particle stress tensor.
@@ -161,8 +177,31 @@ protected:
 
   JDsTimersCpu *Timersc;  ///<Manages timers for CPU execution.
 
+  std::vector<StSortArrayCpu> SortArrays; ///<Particle arrays that must follow the particle sort of divide (ignored when NULL). | Arrays de particulas que deben seguir la ordenacion del divide (ignorados cuando son NULL).
+
+  TpCellOrder CellOrder;  ///<Ordering of cell rows for particle sort (CELLORDER_Linear by default). | Ordenacion de filas de celdas para ordenar particulas.
+  float NgListSkin;       ///<Skin distance of neighbour list as a factor of KernelSize (0:disabled). | Distancia extra de la lista de vecinos como factor de KernelSize (0:desactivada).
+  JDsNgListCpu *NgList;   ///<Persistent neighbour list for interaction (NULL when it is disabled). | Lista de vecinos persistente para la interaccion.
+
+  float PeriHaloMargin;          ///<Margin of persistent halo of periodic particles as a factor of KernelSize (0:disabled). | Margen del halo persistente de periodicas como factor de KernelSize (0:desactivado).
+  JDsPeriodicHaloCpu *PeriHalo; ///<Persistent halo of periodic particles (NULL when it is disabled). | Halo persistente de particulas periodicas.
+  tdouble3 PeriPosMin;          ///<Lower limit to create periodic particles (Map_PosMin extended by halo margin). | Limite inferior para crear periodicas.
+  tdouble3 PeriPosMax;          ///<Upper limit to create periodic particles (Map_PosMax extended by halo margin). | Limite superior para crear periodicas.
+
+  bool UsePosCell;        ///<Interaction uses positions relative to cells in single precision (PosCellc) instead of Posc. | La interaccion usa posiciones relativas a celdas en simple precision.
+  TpSimdMode SimdMode;    ///<Instruction set for SIMD fluid interaction (SIMD_None:original interaction). | Juego de instrucciones para la interaccion SIMD del fluido.
+  bool FusedCorr;         ///<Symplectic-Corrector applies shifting, integration and plane damping in one pass (ComputeSymplecticCorrFused). | Symplectic-Corrector aplica shifting, integracion y damping de planos en una pasada.
+  bool InterCounters;     ///<Counts checked and real interactions in force interaction for PIPS. | Cuenta interacciones comprobadas y reales en la interaccion de fuerzas para PIPS.
+
   void InitVars();
 
+  /// Registers particle array that must be reordered in divide.
+  /// Registra array de particulas que debe reordenarse en el divide.
+  template<class T> void AddSortArray(T **ptr){
+    StSortArrayCpu a={(void**)ptr,unsigned(sizeof(T))};
+    SortArrays.push_back(a);
+  }
+
   void FreeCpuMemoryFixed();
   void AllocCpuMemoryFixed();
   void FreeCpuMemoryParticles();
@@ -200,6 +239,7 @@ protected:
   unsigned GetParticlesData(unsigned n,unsigned pini,bool onlynormal
     ,unsigned *idp,tdouble3 *pos,tfloat3 *vel,float *rhop,typecode *code);
   void ConfigOmp(const JSphCfgRun *cfg);
+  void ConfigSimd(const JSphCfgRun *cfg);
 
   void ConfigRunMode();
   void ConfigCellDiv(JCellDivCpu* celldiv){ CellDiv=celldiv; }
@@ -213,27 +253,34 @@ protected:
   void PreInteraction_Forces();
   void PosInteraction_Forces();
 
-  template<TpKernel tker,TpFtMode ftmode> void InteractionForcesBound
-    (unsigned n,unsigned pini,StDivDataCpu divdata,const unsigned *dcell
-    ,const tdouble3 *pos,const tfloat4 *velrhop,const typecode *code,const unsigned *id
-    ,float &viscdt,float *ar)const;
+  template<TpKernel tker,TpFtMode ftmode,bool sym,bool pips> void InteractionForcesBound
+    (unsigned n,unsigned pini,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
+    ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const unsigned *id
+    ,float &viscdt,float *ar,ullong &pir,ullong &pic)const;
 
-  template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift> 
+  template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym,bool pips,bool epi> 
     void InteractionForcesFluid(unsigned n,unsigned pini,bool boundp2,float visco
-    ,StDivDataCpu divdata,const unsigned *dcell
+    ,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
     ,const tsymatrix3f* tau,tsymatrix3f* gradvel
-    ,const tdouble3 *pos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
+    ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
     ,const float *press,const tfloat3 *dengradcorr
     ,float &viscdt,float *ar,tfloat3 *ace,float *delta
-    ,TpShifting shiftmode,tfloat4 *shiftposfs)const;
+    ,TpShifting shiftmode,tfloat4 *shiftposfs,ullong &pir,ullong &pic,float &acemax)const;
+
+  template<TpDensity tdensity,bool pips,bool epi> void InteractionForcesFluidSimd
+    (unsigned n,unsigned pini,bool boundp2,float visco
+    ,StDivDataCpu divdata,const unsigned *dcell,const StNgListCpu &nglist
+    ,const tdouble3 *pos,const tfloat4 *poscell,const tfloat4 *velrhop,const typecode *code,const float *press
+    ,float &viscdt,float *ar,tfloat3 *ace,float *delta,ullong &pir,ullong &pic,float &acemax)const;
 
   void InteractionForcesDEM(unsigned nfloat,StDivDataCpu divdata,const unsigned *dcell
     ,const unsigned *ftridp,const StDemData* demobjs
     ,const tdouble3 *pos,const tfloat4 *velrhop,const typecode *code,const unsigned *idp
     ,float &viscdt,tfloat3 *ace)const;
 
-  template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift> 
+  template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym,bool pips> 
     void Interaction_ForcesCpuT(const stinterparmsc &t,StInterResultc &res)const;
+  template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity,bool shift,bool sym> void Interaction_Forces_ct6(const stinterparmsc &t,StInterResultc &res)const;
   template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco,TpDensity tdensity> void Interaction_Forces_ct5(const stinterparmsc &t,StInterResultc &res)const;
   template<TpKernel tker,TpFtMode ftmode,TpVisco tvisco> void Interaction_Forces_ct4(const stinterparmsc &t,StInterResultc &res)const;
   template<TpKernel tker,TpFtMode ftmode> void Interaction_Forces_ct3(const stinterparmsc &t,StInterResultc &res)const;
@@ -259,6 +306,8 @@ protected:
 
   void ComputeSymplecticPre(double dt);
   void ComputeSymplecticCorr(double dt);
+  template<bool shift,bool damp> void ComputeSymplecticCorrT(double dt);
+  void ComputeSymplecticCorrFused(double dt);
 
   double DtVariable(bool final);
 
@@ -0,0 +1,296 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// \file JSphCpuSimd.cpp \brief Implements functions for SIMD particle interaction on CPU.
+
+#include "JSphCpuSimd.h"
+#include <cmath>
+#include <algorithm>
+
+//-AVX2 and AVX-512 versions are only compiled with GCC or Clang on x86-64.
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #define SIMD_X86
+  #include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace fsimd{
+
+//==============================================================================
+/// Returns the best instruction set available on the current CPU.
+/// Devuelve el mejor juego de instrucciones disponible en la CPU actual.
+//==============================================================================
+TpSimdMode GetSimdAvailable(){
+  TpSimdMode ret=SIMD_Generic;
+#ifdef SIMD_X86
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))ret=SIMD_Avx2;
+  if(__builtin_cpu_supports("avx512f"))ret=SIMD_Avx512;
+#endif
+  return(ret);
+}
+
+//==============================================================================
+/// Returns the name of SIMD mode.
+/// Devuelve el nombre del modo SIMD.
+//==============================================================================
+const char* GetSimdModeName(TpSimdMode mode){
+  switch(mode){
+    case SIMD_None:    return("None");
+    case SIMD_Generic: return("Generic");
+    case SIMD_Avx2:    return("AVX2");
+    case SIMD_Avx512:  return("AVX-512");
+  }
+  return("???");
+}
+
+//==============================================================================
+/// Interaction of particle p1 with neighbours in SoA format without explicit
+/// vector instructions.
+/// Interaccion de la particula p1 con vecinos en formato SoA sin instrucciones
+/// vectoriales explicitas.
+//==============================================================================
+static void InteractionFluidGeneric(unsigned npad,const StSimdData &d
+  ,const StSimdCtes &c,StSimdRes &r)
+{
+  const float hinv=1.f/c.kernelh;
+  const float viscoh=-c.viscocbar*c.kernelh;
+  float acex=0,acey=0,acez=0,ar=0,visc=0,delta=0;
+  for(unsigned cp=0;cp<npad;cp++){
+    const float drx=d.drx[cp],dry=d.dry[cp],drz=d.drz[cp],rr2=d.rr2[cp];
+    const float dvx=d.dvx[cp],dvy=d.dvy[cp],dvz=d.dvz[cp];
+    const float rhop2=d.rhop[cp];
+    //-Wendland kernel.
+    const float rad=sqrt(rr2);
+    const float qq=rad*hinv;
+    const float wqq1=1.f-0.5f*qq;
+    const float fac=c.bwen*qq*wqq1*wqq1*wqq1/rad;
+    const float frx=fac*drx,fry=fac*dry,frz=fac*drz;
+    //-Momentum equation.
+    const float p_vpm=-(c.pressp1+d.press[cp])/(c.rhopp1*rhop2)*c.massp2;
+    acex+=p_vpm*frx; acey+=p_vpm*fry; acez+=p_vpm*frz;
+    //-Continuity equation.
+    ar+=c.massp2*(dvx*frx+dvy*fry+dvz*frz)*(c.rhopp1/rhop2);
+    //-Artificial viscosity.
+    const float dot=drx*dvx+dry*dvy+drz*dvz;
+    const float rr2eta=1.f/(rr2+c.eta2);
+    const float dot_rr2=dot*rr2eta;
+    visc=max(dot_rr2,visc);
+    if(dot<0){
+      const float pi_visc=(viscoh*dot_rr2/((c.rhopp1+rhop2)*0.5f))*c.massp2;
+      acex-=pi_visc*frx; acey-=pi_visc*fry; acez-=pi_visc*frz;
+    }
+    //-Density Diffusion Term.
+    if(c.ddtmode){
+      const float dot3=drx*frx+dry*fry+drz*frz;
+      if(c.ddtmode==1)delta+=c.ddtkhcbar*(c.rhopp1/rhop2-1.f)*rr2eta*dot3*c.massp2;
+      else            delta-=c.ddtkhcbar*((rhop2-c.rhopp1)-d.drhop[cp])*rr2eta*dot3*c.massp2/rhop2;
+    }
+  }
+  r.ace=TFloat3(acex,acey,acez);
+  r.ar=ar; r.visc=visc; r.delta=delta;
+}
+
+#ifdef SIMD_X86
+//==============================================================================
+/// Returns the sum of the 8 values of v.
+//==============================================================================
+__attribute__((target("avx2,fma"))) static inline float HSum8(__m256 v){
+  const __m128 s=_mm_add_ps(_mm256_castps256_ps128(v),_mm256_extractf128_ps(v,1));
+  const __m128 s2=_mm_add_ps(s,_mm_movehl_ps(s,s));
+  return(_mm_cvtss_f32(_mm_add_ss(s2,_mm_shuffle_ps(s2,s2,1))));
+}
+
+//==============================================================================
+/// Returns the maximum of the 8 values of v.
+//==============================================================================
+__attribute__((target("avx2,fma"))) static inline float HMax8(__m256 v){
+  const __m128 s=_mm_max_ps(_mm256_castps256_ps128(v),_mm256_extractf128_ps(v,1));
+  const __m128 s2=_mm_max_ps(s,_mm_movehl_ps(s,s));
+  return(_mm_cvtss_f32(_mm_max_ss(s2,_mm_shuffle_ps(s2,s2,1))));
+}
+
+//==============================================================================
+/// Interaction of particle p1 with neighbours in SoA format using AVX2
+/// (8 neighbours at once).
+/// Interaccion de la particula p1 con vecinos en formato SoA usando AVX2
+/// (8 vecinos a la vez).
+//==============================================================================
+__attribute__((target("avx2,fma"))) static void InteractionFluidAvx2
+  (unsigned npad,const StSimdData &d,const StSimdCtes &c,StSimdRes &r)
+{
+  const __m256 one=_mm256_set1_ps(1.f);
+  const __m256 half=_mm256_set1_ps(0.5f);
+  const __m256 zero=_mm256_setzero_ps();
+  const __m256 hinv=_mm256_set1_ps(1.f/c.kernelh);
+  const __m256 bwen=_mm256_set1_ps(c.bwen);
+  const __m256 massp2=_mm256_set1_ps(c.massp2);
+  const __m256 rhopp1=_mm256_set1_ps(c.rhopp1);
+  const __m256 pressp1=_mm256_set1_ps(c.pressp1);
+  const __m256 eta2=_mm256_set1_ps(c.eta2);
+  const __m256 viscoh=_mm256_set1_ps(-c.viscocbar*c.kernelh);
+  const __m256 ddtkh=_mm256_set1_ps(c.ddtkhcbar);
+  __m256 acex=zero,acey=zero,acez=zero,ar=zero,visc=zero,delta=zero;
+  for(unsigned cp=0;cp<npad;cp+=8){
+    const __m256 drx=_mm256_loadu_ps(d.drx+cp);
+    const __m256 dry=_mm256_loadu_ps(d.dry+cp);
+    const __m256 drz=_mm256_loadu_ps(d.drz+cp);
+    const __m256 rr2=_mm256_loadu_ps(d.rr2+cp);
+    const __m256 dvx=_mm256_loadu_ps(d.dvx+cp);
+    const __m256 dvy=_mm256_loadu_ps(d.dvy+cp);
+    const __m256 dvz=_mm256_loadu_ps(d.dvz+cp);
+    const __m256 rhop2=_mm256_loadu_ps(d.rhop+cp);
+    const __m256 press2=_mm256_loadu_ps(d.press+cp);
+    //-Wendland kernel.
+    const __m256 rad=_mm256_sqrt_ps(rr2);
+    const __m256 qq=_mm256_mul_ps(rad,hinv);
+    const __m256 wqq1=_mm256_fnmadd_ps(half,qq,one);
+    const __m256 wqq3=_mm256_mul_ps(_mm256_mul_ps(wqq1,wqq1),wqq1);
+    const __m256 fac=_mm256_div_ps(_mm256_mul_ps(_mm256_mul_ps(bwen,qq),wqq3),rad);
+    const __m256 frx=_mm256_mul_ps(fac,drx);
+    const __m256 fry=_mm256_mul_ps(fac,dry);
+    const __m256 frz=_mm256_mul_ps(fac,drz);
+    //-Momentum equation and artificial viscosity.
+    const __m256 prs=_mm256_div_ps(_mm256_add_ps(pressp1,press2),_mm256_mul_ps(rhopp1,rhop2));
+    const __m256 dot=_mm256_fmadd_ps(drz,dvz,_mm256_fmadd_ps(dry,dvy,_mm256_mul_ps(drx,dvx)));
+    const __m256 rr2eta=_mm256_div_ps(one,_mm256_add_ps(rr2,eta2));
+    const __m256 dot_rr2=_mm256_mul_ps(dot,rr2eta);
+    visc=_mm256_max_ps(dot_rr2,visc);
+    const __m256 robar=_mm256_mul_ps(_mm256_add_ps(rhopp1,rhop2),half);
+    const __m256 pivisc=_mm256_and_ps(_mm256_cmp_ps(dot,zero,_CMP_LT_OQ)
+      ,_mm256_div_ps(_mm256_mul_ps(viscoh,dot_rr2),robar));
+    const __m256 p_vpm=_mm256_mul_ps(_mm256_add_ps(prs,pivisc),massp2);
+    acex=_mm256_fnmadd_ps(p_vpm,frx,acex);
+    acey=_mm256_fnmadd_ps(p_vpm,fry,acey);
+    acez=_mm256_fnmadd_ps(p_vpm,frz,acez);
+    //-Continuity equation.
+    const __m256 dvfr=_mm256_fmadd_ps(dvz,frz,_mm256_fmadd_ps(dvy,fry,_mm256_mul_ps(dvx,frx)));
+    const __m256 rhop1over2=_mm256_div_ps(rhopp1,rhop2);
+    ar=_mm256_fmadd_ps(_mm256_mul_ps(massp2,dvfr),rhop1over2,ar);
+    //-Density Diffusion Term.
+    if(c.ddtmode){
+      const __m256 dot3=_mm256_fmadd_ps(drz,frz,_mm256_fmadd_ps(dry,fry,_mm256_mul_ps(drx,frx)));
+      const __m256 dm=_mm256_mul_ps(_mm256_mul_ps(ddtkh,rr2eta),_mm256_mul_ps(dot3,massp2));
+      if(c.ddtmode==1)delta=_mm256_fmadd_ps(dm,_mm256_sub_ps(rhop1over2,one),delta);
+      else{
+        const __m256 drhop=_mm256_loadu_ps(d.drhop+cp);
+        const __m256 drh=_mm256_sub_ps(_mm256_sub_ps(rhop2,rhopp1),drhop);
+        delta=_mm256_fnmadd_ps(dm,_mm256_div_ps(drh,rhop2),delta);
+      }
+    }
+  }
+  r.ace=TFloat3(HSum8(acex),HSum8(acey),HSum8(acez));
+  r.ar=HSum8(ar); r.visc=HMax8(visc); r.delta=HSum8(delta);
+}
+
+//==============================================================================
+/// Interaction of particle p1 with neighbours in SoA format using AVX-512
+/// (16 neighbours at once).
+/// Interaccion de la particula p1 con vecinos en formato SoA usando AVX-512
+/// (16 vecinos a la vez).
+//==============================================================================
+__attribute__((target("avx512f"))) static void InteractionFluidAvx512
+  (unsigned npad,const StSimdData &d,const StSimdCtes &c,StSimdRes &r)
+{
+  const __m512 one=_mm512_set1_ps(1.f);
+  const __m512 half=_mm512_set1_ps(0.5f);
+  const __m512 zero=_mm512_setzero_ps();
+  const __m512 hinv=_mm512_set1_ps(1.f/c.kernelh);
+  const __m512 bwen=_mm512_set1_ps(c.bwen);
+  const __m512 massp2=_mm512_set1_ps(c.massp2);
+  const __m512 rhopp1=_mm512_set1_ps(c.rhopp1);
+  const __m512 pressp1=_mm512_set1_ps(c.pressp1);
+  const __m512 eta2=_mm512_set1_ps(c.eta2);
+  const __m512 viscoh=_mm512_set1_ps(-c.viscocbar*c.kernelh);
+  const __m512 ddtkh=_mm512_set1_ps(c.ddtkhcbar);
+  __m512 acex=zero,acey=zero,acez=zero,ar=zero,visc=zero,delta=zero;
+  for(unsigned cp=0;cp<npad;cp+=16){
+    const __m512 drx=_mm512_loadu_ps(d.drx+cp);
+    const __m512 dry=_mm512_loadu_ps(d.dry+cp);
+    const __m512 drz=_mm512_loadu_ps(d.drz+cp);
+    const __m512 rr2=_mm512_loadu_ps(d.rr2+cp);
+    const __m512 dvx=_mm512_loadu_ps(d.dvx+cp);
+    const __m512 dvy=_mm512_loadu_ps(d.dvy+cp);
+    const __m512 dvz=_mm512_loadu_ps(d.dvz+cp);
+    const __m512 rhop2=_mm512_loadu_ps(d.rhop+cp);
+    const __m512 press2=_mm512_loadu_ps(d.press+cp);
+    //-Wendland kernel.
+    const __m512 rad=_mm512_sqrt_ps(rr2);
+    const __m512 qq=_mm512_mul_ps(rad,hinv);
+    const __m512 wqq1=_mm512_fnmadd_ps(half,qq,one);
+    const __m512 wqq3=_mm512_mul_ps(_mm512_mul_ps(wqq1,wqq1),wqq1);
+    const __m512 fac=_mm512_div_ps(_mm512_mul_ps(_mm512_mul_ps(bwen,qq),wqq3),rad);
+    const __m512 frx=_mm512_mul_ps(fac,drx);
+    const __m512 fry=_mm512_mul_ps(fac,dry);
+    const __m512 frz=_mm512_mul_ps(fac,drz);
+    //-Momentum equation and artificial viscosity.
+    const __m512 prs=_mm512_div_ps(_mm512_add_ps(pressp1,press2),_mm512_mul_ps(rhopp1,rhop2));
+    const __m512 dot=_mm512_fmadd_ps(drz,dvz,_mm512_fmadd_ps(dry,dvy,_mm512_mul_ps(drx,dvx)));
+    const __m512 rr2eta=_mm512_div_ps(one,_mm512_add_ps(rr2,eta2));
+    const __m512 dot_rr2=_mm512_mul_ps(dot,rr2eta);
+    visc=_mm512_max_ps(dot_rr2,visc);
+    const __m512 robar=_mm512_mul_ps(_mm512_add_ps(rhopp1,rhop2),half);
+    const __mmask16 dotneg=_mm512_cmp_ps_mask(dot,zero,_CMP_LT_OQ);
+    const __m512 pivisc=_mm512_maskz_div_ps(dotneg,_mm512_mul_ps(viscoh,dot_rr2),robar);
+    const __m512 p_vpm=_mm512_mul_ps(_mm512_add_ps(prs,pivisc),massp2);
+    acex=_mm512_fnmadd_ps(p_vpm,frx,acex);
+    acey=_mm512_fnmadd_ps(p_vpm,fry,acey);
+    acez=_mm512_fnmadd_ps(p_vpm,frz,acez);
+    //-Continuity equation.
+    const __m512 dvfr=_mm512_fmadd_ps(dvz,frz,_mm512_fmadd_ps(dvy,fry,_mm512_mul_ps(dvx,frx)));
+    const __m512 rhop1over2=_mm512_div_ps(rhopp1,rhop2);
+    ar=_mm512_fmadd_ps(_mm512_mul_ps(massp2,dvfr),rhop1over2,ar);
+    //-Density Diffusion Term.
+    if(c.ddtmode){
+      const __m512 dot3=_mm512_fmadd_ps(drz,frz,_mm512_fmadd_ps(dry,fry,_mm512_mul_ps(drx,frx)));
+      const __m512 dm=_mm512_mul_ps(_mm512_mul_ps(ddtkh,rr2eta),_mm512_mul_ps(dot3,massp2));
+      if(c.ddtmode==1)delta=_mm512_fmadd_ps(dm,_mm512_sub_ps(rhop1over2,one),delta);
+      else{
+        const __m512 drhop=_mm512_loadu_ps(d.drhop+cp);
+        const __m512 drh=_mm512_sub_ps(_mm512_sub_ps(rhop2,rhopp1),drhop);
+        delta=_mm512_fnmadd_ps(dm,_mm512_div_ps(drh,rhop2),delta);
+      }
+    }
+  }
+  r.ace=TFloat3(_mm512_reduce_add_ps(acex),_mm512_reduce_add_ps(acey),_mm512_reduce_add_ps(acez));
+  r.ar=_mm512_reduce_add_ps(ar); r.visc=_mm512_reduce_max_ps(visc); r.delta=_mm512_reduce_add_ps(delta);
+}
+#endif
+
+//==============================================================================
+/// Interaction of particle p1 with neighbours in SoA format (npad must be a
+/// multiple of SIMD_PADDING).
+/// Interaccion de la particula p1 con vecinos en formato SoA (npad debe ser
+/// multiplo de SIMD_PADDING).
+//==============================================================================
+void InteractionFluid(TpSimdMode mode,unsigned npad,const StSimdData &d
+  ,const StSimdCtes &c,StSimdRes &r)
+{
+#ifdef SIMD_X86
+  if(mode==SIMD_Avx512)InteractionFluidAvx512(npad,d,c,r);
+  else if(mode==SIMD_Avx2)InteractionFluidAvx2(npad,d,c,r);
+  else InteractionFluidGeneric(npad,d,c,r);
+#else
+  InteractionFluidGeneric(npad,d,c,r);
+#endif
+}
+
+}
+
+
@@ -0,0 +1,87 @@
+//HEAD_DSPH
+/*
+ <DUALSPHYSICS>  Copyright (c) 2020 by Dr Jose M. Dominguez et al. (see http://dual.sphysics.org/index.php/developers/).
+
+ EPHYSLAB Environmental Physics Laboratory, Universidade de Vigo, Ourense, Spain.
+ School of Mechanical, Aerospace and Civil Engineering, University of Manchester, Manchester, U.K.
+
+ This file is part of DualSPHysics.
+
+ DualSPHysics is free software: you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ as published by the Free Software Foundation; either version 2.1 of the License, or (at your option) any later version.
+
+ DualSPHysics is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+
+ You should have received a copy of the GNU Lesser General Public License along with DualSPHysics. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+//:#############################################################################
+//:# Cambios:
+//:# =========
+//:# - Interaccion Fluid-Fluid/Bound con kernel Wendland sobre datos SoA en
+//:#   float con versiones AVX2 y AVX-512 seleccionables en ejecucion. (17-10-2026)
+//:#############################################################################
+
+/// \file JSphCpuSimd.h \brief Declares functions for SIMD particle interaction on CPU.
+
+#ifndef _JSphCpuSimd_
+#define _JSphCpuSimd_
+
+#include "TypesDef.h"
+
+///Instruction set used for SIMD interaction on CPU.
+typedef enum{
+  SIMD_None=0     ///<SIMD interaction is disabled (original interaction).
+ ,SIMD_Generic=1  ///<Interaction on SoA data without explicit vector instructions.
+ ,SIMD_Avx2=2     ///<Interaction on SoA data using AVX2 (8 neighbours at once).
+ ,SIMD_Avx512=3   ///<Interaction on SoA data using AVX-512 (16 neighbours at once).
+}TpSimdMode;
+
+#define SIMD_PADDING 16  ///<Number of neighbours is padded to a multiple of this value.
+
+/// Implements functions for SIMD particle interaction on CPU.
+namespace fsimd{
+
+///Structure with neighbour data in SoA format (only neighbours inside kernel, padded to SIMD_PADDING).
+typedef struct{
+  float *drx,*dry,*drz;  ///<Distance to neighbour (pos1-pos2).
+  float *rr2;            ///<Square distance to neighbour.
+  float *dvx,*dvy,*dvz;  ///<Velocity difference (vel1-vel2).
+  float *rhop;           ///<Density of neighbour.
+  float *press;          ///<Pressure of neighbour.
+  float *drhop;          ///<Hydrostatic density difference (only for DDT2).
+}StSimdData;
+
+///Structure with constants of particle p1 for SIMD interaction.
+typedef struct{
+  float massp2;     ///<Mass of neighbours.
+  float rhopp1;     ///<Density of particle p1.
+  float pressp1;    ///<Pressure of particle p1.
+  float kernelh;    ///<Smoothing length.
+  float bwen;       ///<Wendland constant for gradient.
+  float eta2;       ///<eta*eta (eta=0.1*h).
+  float viscocbar;  ///<Artificial viscosity coefficient multiplied by Cs0.
+  float ddtkhcbar;  ///<DDTkh multiplied by Cs0.
+  int ddtmode;      ///<0:None, 1:Molteni and Colagrossi, 2:Fourtakas.
+}StSimdCtes;
+
+///Structure with results of SIMD interaction for particle p1.
+typedef struct{
+  tfloat3 ace;
+  float ar;
+  float visc;
+  float delta;
+}StSimdRes;
+
+TpSimdMode GetSimdAvailable();
+const char* GetSimdModeName(TpSimdMode mode);
+
+void InteractionFluid(TpSimdMode mode,unsigned npad,const StSimdData &d
+  ,const StSimdCtes &c,StSimdRes &r);
+
+}
+
+#endif
+
+
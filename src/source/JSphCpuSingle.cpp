@@ -44,8 +44,11 @@
 #include "JSphShifting.h"
 #include "JDsPips.h"
 #include "JDsExtraData.h"
+#include "JDsNgListCpu.h"
+#include "JDsPeriodicHaloCpu.h"
 
 #include <climits>
+#include <vector>
 
 using namespace std;
 //==============================================================================
@@ -94,8 +97,16 @@ void JSphCpuSingle::UpdateMaxValues(){
 void JSphCpuSingle::LoadConfig(const JSphCfgRun *cfg){
   //-Load OpenMP configuraction. | Carga configuracion de OpenMP.
   ConfigOmp(cfg);
+  CellOrder=cfg->CellOrder;
+  NgListSkin=cfg->NgListSkin;
+  PeriHaloMargin=cfg->PeriHaloMargin;
+  UsePosCell=cfg->PosCellCpu;
+  ArraysCpu->SetHugePages(cfg->HugePagesCpu);
+  FusedCorr=cfg->FusedCorrCpu;
+  ConfigSimd(cfg);
   //-Load basic general configuraction. | Carga configuracion basica general.
   JSph::LoadConfig(cfg);
+  InterCounters=(DsPips && DsPips->Counters);
   //-Checks compatibility of selected options.
   Log->Print("**Special case configuration is loaded");
 }
@@ -153,10 +164,31 @@ void JSphCpuSingle::ConfigDomain(){
 
   //-Creates object for Celldiv on the CPU and selects a valid cellmode.
   //-Crea objeto para divide en CPU y selecciona un cellmode valido.
-  CellDivSingle=new JCellDivCpuSingle(Stable,FtCount!=0,PeriActive,CellDomFixed,CellMode
+  CellDivSingle=new JCellDivCpuSingle(Stable,FtCount!=0,PeriActive,CellDomFixed,CellMode,CellOrder
     ,Scell,Map_PosMin,Map_PosMax,Map_Cells,CaseNbound,CaseNfixed,CaseNpb,DirOut);
   CellDivSingle->DefineDomain(DomCellCode,DomCelIni,DomCelFin,DomPosMin,DomPosMax);
   ConfigCellDiv((JCellDivCpu*)CellDivSingle);
+  if(CellOrder!=CELLORDER_Linear)Log->Printf("Cell rows are sorted according to %s curve.",GetNameCellOrder(CellOrder));
+
+  //-Creates object for persistent neighbour list.
+  //-Crea objeto para lista de vecinos persistente.
+  if(NgListSkin>0){
+    if(PeriActive)Log->PrintWarning("The neighbour list (-nglist) is not used with periodic conditions.");
+    else{
+      NgList=new JDsNgListCpu(KernelSize,KernelSize*NgListSkin);
+      Log->Printf("Neighbour list with skin distance: %g (%g*KernelSize)",NgList->Skin,NgListSkin);
+    }
+  }
+
+  //-Creates object for persistent halo of periodic particles.
+  //-Crea objeto para halo persistente de particulas periodicas.
+  PeriPosMin=Map_PosMin; PeriPosMax=Map_PosMax;
+  if(PeriHaloMargin>0 && PeriActive){
+    const double margin=double(KernelSize)*PeriHaloMargin;
+    PeriHalo=new JDsPeriodicHaloCpu(Map_PosMin,Map_PosMax,margin,PeriX,PeriY,PeriZ,PeriXinc,PeriYinc,PeriZinc);
+    PeriPosMin=PeriHalo->ExtPosMin; PeriPosMax=PeriHalo->ExtPosMax;
+    Log->Printf("Persistent halo of periodic particles with margin: %g (%g*KernelSize)",margin,PeriHaloMargin);
+  }
 
   ConfigSaveData(0,1,"");
 
@@ -182,45 +214,87 @@ void JSphCpuSingle::ResizeParticlesSize(unsigned newsize,float oversize,bool upd
 }
 
 //==============================================================================
-/// Create list of new periodic particles to duplicate.
-/// With stable activated reordered list of periodic particles.
+/// Returns number of blocks to create the list of periodic particles in parallel.
+/// Devuelve numero de bloques para crear la lista de periodicas en paralelo.
+//==============================================================================
+unsigned JSphCpuSingle::PeriodicListBlocks(unsigned n)const{
+  return(n>OMP_LIMIT_COMPUTELIGHT? unsigned(OmpThreads): 1);
+}
+
+//==============================================================================
+/// Counts new periodic particles to duplicate in each block of particles and 
+/// stores in blkpos[] the position of each block in the final list (exclusive 
+/// prefix sum). Returns the total number of new periodic particles.
 ///
-/// Crea lista de nuevas particulas periodicas a duplicar.
-/// Con stable activado reordena lista de periodicas.
+/// Cuenta las nuevas particulas periodicas a duplicar en cada bloque de 
+/// particulas y guarda en blkpos[] la posicion de cada bloque en la lista final
+/// (suma prefija exclusiva). Devuelve el numero total de nuevas periodicas.
 //==============================================================================
-unsigned JSphCpuSingle::PeriodicMakeList(unsigned n,unsigned pini,bool stable
-  ,unsigned nmax,tdouble3 perinc,const tdouble3 *pos,const typecode *code
-  ,unsigned *listp)const
+unsigned JSphCpuSingle::PeriodicCountList(unsigned n,unsigned pini,unsigned nblk
+  ,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *blkpos)const
 {
-  unsigned count=0;
-  if(n){
-    //-Initialize size of list lsph to zero. | Inicializa tamanho de lista lspg a cero.
-    listp[nmax]=0;
-    for(unsigned p=0;p<n;p++){
-      const unsigned p2=p+pini;
+  const unsigned blksize=(n+nblk-1)/nblk;
+  const int nb=int(nblk);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nb>1)
+  #endif
+  for(int cb=0;cb<nb;cb++){
+    const unsigned p0=pini+blksize*unsigned(cb);
+    const unsigned p1=pini+min(n,blksize*unsigned(cb+1));
+    unsigned count=0;
+    for(unsigned p=p0;p<p1;p++){
       //-Keep normal or periodic particles. | Se queda con particulas normales o periodicas.
-      if(CODE_GetSpecialValue(code[p2])<=CODE_PERIODIC){
-        //-Get particle position. | Obtiene posicion de particula.
-        const tdouble3 ps=pos[p2];
-        tdouble3 ps2=ps+perinc;
-        if(Map_PosMin<=ps2 && ps2<Map_PosMax){
-          unsigned cp=listp[nmax]; listp[nmax]++; if(cp<nmax)listp[cp]=p2;
-        }
-        ps2=ps-perinc;
-        if(Map_PosMin<=ps2 && ps2<Map_PosMax){
-          unsigned cp=listp[nmax]; listp[nmax]++; if(cp<nmax)listp[cp]=(p2|0x80000000);
-        }
+      if(CODE_GetSpecialValue(code[p])<=CODE_PERIODIC){
+        const byte per=PeriodicCheckPos(pos[p],perinc);
+        count+=(per&1)+(per>>1);
       }
     }
-    count=listp[nmax];
-    //-Reorder list if it is valid and stability is activated. | Reordena lista si es valida y stable esta activado.
-    if(stable && count && count<=nmax){
-      //-Don't make mistake because at the moment the list is not created using OpenMP. | No hace falta porque de momento no se crea la lista usando OpenMP.
-    }
+    blkpos[cb]=count;
+  }
+  //-Computes position of each block in the list. | Calcula la posicion de cada bloque en la lista.
+  unsigned count=0;
+  for(unsigned cb=0;cb<nblk;cb++){
+    const unsigned c=blkpos[cb];
+    blkpos[cb]=count;
+    count+=c;
   }
   return(count);
 }
 
+//==============================================================================
+/// Create list of new periodic particles to duplicate starting from positions
+/// of each block computed by PeriodicCountList(). The list keeps the order of 
+/// particles as a serial search, so it is always stable.
+///
+/// Crea lista de nuevas particulas periodicas a duplicar a partir de las 
+/// posiciones de cada bloque calculadas por PeriodicCountList(). La lista 
+/// mantiene el orden de particulas de una busqueda serie, por lo que siempre 
+/// es estable.
+//==============================================================================
+void JSphCpuSingle::PeriodicMakeList(unsigned n,unsigned pini,unsigned nblk
+  ,const unsigned *blkpos,tdouble3 perinc,const tdouble3 *pos,const typecode *code
+  ,unsigned *listp)const
+{
+  const unsigned blksize=(n+nblk-1)/nblk;
+  const int nb=int(nblk);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(nb>1)
+  #endif
+  for(int cb=0;cb<nb;cb++){
+    const unsigned p0=pini+blksize*unsigned(cb);
+    const unsigned p1=pini+min(n,blksize*unsigned(cb+1));
+    unsigned cp=blkpos[cb];
+    for(unsigned p=p0;p<p1;p++){
+      //-Keep normal or periodic particles. | Se queda con particulas normales o periodicas.
+      if(CODE_GetSpecialValue(code[p])<=CODE_PERIODIC){
+        const byte per=PeriodicCheckPos(pos[p],perinc);
+        if(per&1)listp[cp++]=p;
+        if(per&2)listp[cp++]=(p|0x80000000);
+      }
+    }
+  }
+}
+
 //==============================================================================
 /// Duplicate the indicated particle position applying displacement.
 /// Duplicated particles are considered to be always valid and are inside
@@ -243,10 +317,11 @@ void JSphCpuSingle::PeriodicDuplicatePos(unsigned pnew,unsigned pcopy,bool inver
   ps.x+=(inverse? -dx: dx);
   ps.y+=(inverse? -dy: dy);
   ps.z+=(inverse? -dz: dz);
-  //-Calculate coordinates of cell inside of domain. | Calcula coordendas de celda dentro de dominio.
-  unsigned cx=unsigned((ps.x-DomPosMin.x)/Scell);
-  unsigned cy=unsigned((ps.y-DomPosMin.y)/Scell);
-  unsigned cz=unsigned((ps.z-DomPosMin.z)/Scell);
+  //-Calculate coordinates of cell inside of domain (periodic particles of halo can be out of the domain).
+  //-Calcula coordendas de celda dentro de dominio (las periodicas del halo pueden estar fuera del dominio).
+  unsigned cx=(ps.x>DomPosMin.x? unsigned((ps.x-DomPosMin.x)/Scell): 0);
+  unsigned cy=(ps.y>DomPosMin.y? unsigned((ps.y-DomPosMin.y)/Scell): 0);
+  unsigned cz=(ps.z>DomPosMin.z? unsigned((ps.z-DomPosMin.z)/Scell): 0);
   //-Adjust coordinates of cell is they exceed maximum. | Ajusta las coordendas de celda si sobrepasan el maximo.
   cx=(cx<=cellmax.x? cx: cellmax.x);
   cy=(cy<=cellmax.y? cy: cellmax.y);
@@ -260,13 +335,17 @@ void JSphCpuSingle::PeriodicDuplicatePos(unsigned pnew,unsigned pcopy,bool inver
 /// Create periodic particles starting from a list of the particles to duplicate.
 /// Assume that all the particles are valid.
 /// This kernel works for single-cpu & multi-cpu because it uses domposmin.
+/// When listnew is not NULL, it contains the position of each periodic particle
+/// (used to update the periodic halo).
 ///
 /// Crea particulas periodicas a partir de una lista con las particulas a duplicar.
 /// Se presupone que todas las particulas son validas.
 /// Este kernel vale para single-cpu y multi-cpu porque usa domposmin. 
+/// Cuando listnew no es NULL, contiene la posicion de cada particula periodica
+/// (usado para actualizar el halo periodico).
 //==============================================================================
 void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cellmax
-  ,tdouble3 perinc,const unsigned *listp,unsigned *idp,typecode *code,unsigned *dcell
+  ,tdouble3 perinc,const unsigned *listp,const unsigned *listnew,unsigned *idp,typecode *code,unsigned *dcell
   ,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1)const
 {
   const int n=int(np);
@@ -274,7 +353,7 @@ void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cel
     #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
   #endif
   for(int p=0;p<n;p++){
-    const unsigned pnew=unsigned(p)+pini;
+    const unsigned pnew=(listnew? listnew[p]: unsigned(p)+pini);
     const unsigned rp=listp[p];
     const unsigned pcopy=(rp&0x7FFFFFFF);
     //-Adjust position and cell of new particle. | Ajusta posicion y celda de nueva particula.
@@ -292,20 +371,24 @@ void JSphCpuSingle::PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cel
 /// Create periodic particles starting from a list of the particles to duplicate.
 /// Assume that all the particles are valid.
 /// This kernel works for single-cpu & multi-cpu because it uses domposmin.
+/// When listnew is not NULL, it contains the position of each periodic particle
+/// (used to update the periodic halo).
 ///
 /// Crea particulas periodicas a partir de una lista con las particulas a duplicar.
 /// Se presupone que todas las particulas son validas.
 /// Este kernel vale para single-cpu y multi-cpu porque usa domposmin. 
+/// Cuando listnew no es NULL, contiene la posicion de cada particula periodica
+/// (usado para actualizar el halo periodico).
 //==============================================================================
 void JSphCpuSingle::PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-  ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const
+  ,const unsigned *listnew,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const
 {
   const int n=int(np);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
   #endif
   for(int p=0;p<n;p++){
-    const unsigned pnew=unsigned(p)+pini;
+    const unsigned pnew=(listnew? listnew[p]: unsigned(p)+pini);
     const unsigned rp=listp[p];
     const unsigned pcopy=(rp&0x7FFFFFFF);
     //-Adjust position and cell of new particle. | Ajusta posicion y celda de nueva particula.
@@ -324,20 +407,24 @@ void JSphCpuSingle::PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3
 /// Create periodic particles starting from a list of the particles to duplicate.
 /// Assume that all the particles are valid.
 /// This kernel works for single-cpu & multi-cpu because it uses domposmin.
+/// When listnew is not NULL, it contains the position of each periodic particle
+/// (used to update the periodic halo).
 ///
 /// Crea particulas periodicas a partir de una lista con las particulas a duplicar.
 /// Se presupone que todas las particulas son validas.
 /// Este kernel vale para single-cpu y multi-cpu porque usa domposmin. 
+/// Cuando listnew no es NULL, contiene la posicion de cada particula periodica
+/// (usado para actualizar el halo periodico).
 //==============================================================================
 void JSphCpuSingle::PeriodicDuplicateNormals(unsigned np,unsigned pini,tuint3 cellmax
-  ,tdouble3 perinc,const unsigned *listp,tfloat3 *normals,tfloat3 *motionvel)const
+  ,tdouble3 perinc,const unsigned *listp,const unsigned *listnew,tfloat3 *normals,tfloat3 *motionvel)const
 {
   const int n=int(np);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (static) if(n>OMP_LIMIT_COMPUTELIGHT)
   #endif
   for(int p=0;p<n;p++){
-    const unsigned pnew=unsigned(p)+pini;
+    const unsigned pnew=(listnew? listnew[p]: unsigned(p)+pini);
     const unsigned rp=listp[p];
     const unsigned pcopy=(rp&0x7FFFFFFF);
     normals[pnew]=normals[pcopy];
@@ -364,16 +451,21 @@ void JSphCpuSingle::RunPeriodic(){
   NpfPerM1=NpfPer;
   NpbPerM1=NpbPer;
   //-Mark present periodic particles to ignore. | Marca periodicas actuales para ignorar.
-  for(unsigned p=0;p<Np;p++){
+  const int np=int(Np);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(np>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=0;p<np;p++){
     const typecode rcode=Codec[p];
     if(CODE_IsPeriodic(rcode))Codec[p]=CODE_SetOutIgnore(rcode);
   }
   //-Create new periodic particles. | Crea las nuevas periodicas.
   const unsigned npb0=Npb;
   const unsigned npf0=Np-Npb;
-  const unsigned np0=Np;
   NpbPer=NpfPer=0;
   BoundChanged=true;
+  if(PeriHalo)PeriHalo->Clear();
+  std::vector<unsigned> blkpos(OmpThreads);
   for(unsigned ctype=0;ctype<2;ctype++){//-0:bound, 1:fluid+floating.
     //-Calculate range of particles to be examined (bound or fluid). | Calcula rango de particulas a examinar (bound o fluid).
     const unsigned pini=(ctype? npb0: 0);
@@ -387,34 +479,32 @@ void JSphCpuSingle::RunPeriodic(){
         const unsigned nper=(ctype? NpfPer: NpbPer); //-Number of new periodic particles of type to be processed. | Numero de periodicas nuevas del tipo a procesar.
         const unsigned pini2=(cblock? pini: Np-nper);
         const unsigned num2= (cblock? num:  nper);
-        //-Repeat the search if the resulting memory available is insufficient and it had to be increased.
-        //-Repite la busqueda si la memoria disponible resulto insuficiente y hubo que aumentarla.
-        bool run=true;
-        while(run && num2){
-          //-Reserve memory to create list of periodic particles. | Reserva memoria para crear lista de particulas periodicas.
-          unsigned* listp=ArraysCpu->ReserveUint();
-          unsigned nmax=CpuParticlesSize-1; //-Maximmum number of particles that fit in the list. | Numero maximo de particulas que caben en la lista.
-          //-Generate list of new periodic particles. | Genera lista de nuevas periodicas.
+        if(num2){
           if(Np>=0x80000000)Run_Exceptioon("The number of particles is too big.");//-Because the last bit is used to mark the direction in which a new periodic particle is created. | Porque el ultimo bit se usa para marcar el sentido en que se crea la nueva periodica.
-          unsigned count=PeriodicMakeList(num2,pini2,Stable,nmax,perinc,Posc,Codec,listp);
-          //-Redimension memory for particles if there is insufficient space and repeat the search process.
-          //-Redimensiona memoria para particulas si no hay espacio suficiente y repite el proceso de busqueda.
-          if(count>nmax || !CheckCpuParticlesSize(count+Np)){
-            ArraysCpu->Free(listp); listp=NULL;
-            Timersc->TmStop(TMC_SuPeriodic);
-            ResizeParticlesSize(Np+count,PERIODIC_OVERMEMORYNP,false);
-            Timersc->TmStart(TMC_SuPeriodic);
-          }
-          else{
-            run=false;
+          //-Count new periodic particles of each block. | Cuenta nuevas periodicas de cada bloque.
+          const unsigned nblk=PeriodicListBlocks(num2);
+          const unsigned count=PeriodicCountList(num2,pini2,nblk,perinc,Posc,Codec,&blkpos[0]);
+          if(count){
+            //-Redimension memory for particles if there is insufficient space. | Redimensiona memoria para particulas si no hay espacio suficiente.
+            if(!CheckCpuParticlesSize(count+Np)){
+              Timersc->TmStop(TMC_SuPeriodic);
+              ResizeParticlesSize(Np+count,PERIODIC_OVERMEMORYNP,false);
+              Timersc->TmStart(TMC_SuPeriodic);
+            }
+            //-Generate list of new periodic particles. | Genera lista de nuevas periodicas.
+            unsigned* listp=ArraysCpu->ReserveUint();
+            PeriodicMakeList(num2,pini2,nblk,&blkpos[0],perinc,Posc,Codec,listp);
             //-Create new duplicate periodic particles in the list
             //-Crea nuevas particulas periodicas duplicando las particulas de la lista.
-            if(TStep==STEP_Verlet)PeriodicDuplicateVerlet(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,VelrhopM1c);
+            if(TStep==STEP_Verlet)PeriodicDuplicateVerlet(count,Np,DomCells,perinc,listp,NULL,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,VelrhopM1c);
             if(TStep==STEP_Symplectic){
               if((PosPrec || VelrhopPrec) && (!PosPrec || !VelrhopPrec))Run_Exceptioon("Symplectic data is invalid.") ;
-              PeriodicDuplicateSymplectic(count,Np,DomCells,perinc,listp,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,PosPrec,VelrhopPrec);
+              PeriodicDuplicateSymplectic(count,Np,DomCells,perinc,listp,NULL,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,PosPrec,VelrhopPrec);
             }
-            if(UseNormals)PeriodicDuplicateNormals(count,Np,DomCells,perinc,listp,BoundNormalc,MotionVelc);
+            if(UseNormals)PeriodicDuplicateNormals(count,Np,DomCells,perinc,listp,NULL,BoundNormalc,MotionVelc);
+
+            //-Stores new periodic particles in the halo. | Guarda las nuevas periodicas en el halo.
+            if(PeriHalo)PeriHalo->AddGroup(cper,count,Np,listp);
 
             //-Free the list and update the number of particles. | Libera lista y actualiza numero de particulas.
             ArraysCpu->Free(listp); listp=NULL;
@@ -430,53 +520,137 @@ void JSphCpuSingle::RunPeriodic(){
   Timersc->TmStop(TMC_SuPeriodic);
 }
 
+//==============================================================================
+/// Updates the periodic particles of the halo from their source particles 
+/// instead of creating them again. Returns false when the halo is not valid 
+/// and the periodic particles must be created using RunPeriodic().
+///
+/// Actualiza las particulas periodicas del halo desde sus particulas origen 
+/// en lugar de crearlas de nuevo. Devuelve false cuando el halo no es valido 
+/// y las periodicas deben crearse usando RunPeriodic().
+//==============================================================================
+bool JSphCpuSingle::RunPeriodicHalo(){
+  if(!PeriHalo->GetValid() || PeriHalo->GetNp()!=Np)return(false);
+  Timersc->TmStart(TMC_SuPeriodic);
+  if(TStep==STEP_Symplectic && (!PosPrec)!=(!VelrhopPrec))Run_Exceptioon("Symplectic data is invalid.");
+  const unsigned *peridx=PeriHalo->GetPerIdx();
+  const unsigned *srcidx=PeriHalo->GetSrcIdx();
+  //-Updates groups of periodic particles in the same order they were created. | Actualiza grupos de periodicas en el mismo orden en que se crearon.
+  const unsigned ngroups=PeriHalo->GetGroupsCount();
+  for(unsigned cg=0;cg<ngroups;cg++){
+    const JDsPeriodicHaloCpu::StGroup &g=PeriHalo->GetGroup(cg);
+    const tdouble3 perinc=(g.axis==0? PeriXinc: (g.axis==1? PeriYinc: PeriZinc));
+    const unsigned *listp=srcidx+g.ini;
+    const unsigned *listnew=peridx+g.ini;
+    PeriHalo->UpdateGroupDirection(cg,Posc);
+    if(TStep==STEP_Verlet)PeriodicDuplicateVerlet(g.count,0,DomCells,perinc,listp,listnew,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,VelrhopM1c);
+    if(TStep==STEP_Symplectic)PeriodicDuplicateSymplectic(g.count,0,DomCells,perinc,listp,listnew,Idpc,Codec,Dcellc,Posc,Velrhopc,SpsTauc,PosPrec,VelrhopPrec);
+    if(UseNormals)PeriodicDuplicateNormals(g.count,0,DomCells,perinc,listp,listnew,BoundNormalc,MotionVelc);
+  }
+  //-Checks that updated periodic particles are valid. | Comprueba que las periodicas actualizadas son validas.
+  const bool ok=PeriHalo->CheckPeriodic(Posc,Codec);
+  if(ok){
+    NpfPerM1=NpfPer;
+    NpbPerM1=NpbPer;
+    BoundChanged=true;
+  }
+  else PeriHalo->Invalidate();
+  Timersc->TmStop(TMC_SuPeriodic);
+  return(ok);
+}
+
+//==============================================================================
+/// Reorders all registered particle arrays (SortArrays) according to the last 
+/// divide in one fused pass. Arrays with a free partner buffer in ArraysCpu are 
+/// gathered into it and the pointers are swapped (ping-pong buffers), the rest 
+/// are sorted in place.
+/// Reordena todos los arrays de particulas registrados (SortArrays) segun el 
+/// ultimo divide en una unica pasada. Los arrays con un buffer pareja libre en 
+/// ArraysCpu se recogen en el y se intercambian los punteros, el resto se 
+/// ordenan en el mismo array.
+//==============================================================================
+void JSphCpuSingle::SortParticleArrays(){
+  const bool swap=CellDivSingle->GetSortSwapUseful();
+  std::vector<StSortArrayCpu> arrays;
+  std::vector<void*> vecs2;
+  int cvelrhop=-1;
+  for(unsigned c=0;c<unsigned(SortArrays.size());c++)if(*SortArrays[c].ptr){
+    if(SortArrays[c].ptr==(void**)&Velrhopc)cvelrhop=int(arrays.size());
+    arrays.push_back(SortArrays[c]);
+    vecs2.push_back(swap? ArraysCpu->TryReserve(SortArrays[c].size): NULL);
+  }
+  //-Pressure for next interaction is computed with the sort of velrhop, but not
+  //-with mDBC or inlet/outlet because they change rhop after the divide.
+  //-La presion para la siguiente interaccion se calcula al ordenar velrhop, pero
+  //-no con mDBC o inlet/outlet porque cambian rhop despues del divide.
+  if(cvelrhop>=0 && TBoundary!=BC_MDBC && !InOut)Pressc=(float*)ArraysCpu->TryReserve(sizeof(float));
+  PressDivide=(Pressc!=NULL);
+  if(!arrays.empty())CellDivSingle->SortArrays(unsigned(arrays.size()),&arrays[0],&vecs2[0]
+    ,cvelrhop,&CSP,Pressc);
+  for(unsigned c=0;c<unsigned(arrays.size());c++)if(vecs2[c]){
+    ArraysCpu->Free(arrays[c].size,*arrays[c].ptr);
+    *arrays[c].ptr=vecs2[c];
+  }
+}
+
 //==============================================================================
 /// Executes divide of particles in cells.
 /// Ejecuta divide de particulas en celdas.
 //==============================================================================
 void JSphCpuSingle::RunCellDivide(bool updateperiodic){
   DivData=DivDataCpuNull();
-  //-Creates new periodic particles and marks the old ones to be ignored.
-  //-Crea nuevas particulas periodicas y marca las viejas para ignorarlas.
-  if(updateperiodic && PeriActive)RunPeriodic();
+  //-Frees pressure of previous divide. | Libera presion del divide anterior.
+  ArraysCpu->Free(Pressc); Pressc=NULL;
+  PressDivide=false;
+  //-Updates periodic particles of the halo or creates new periodic particles and marks the old ones to be ignored.
+  //-Actualiza las periodicas del halo o crea nuevas particulas periodicas y marca las viejas para ignorarlas.
+  bool perihalo=false;
+  if(updateperiodic && PeriActive){
+    perihalo=(PeriHalo && RunPeriodicHalo());
+    if(!perihalo)RunPeriodic();
+  }
 
-  //-Initiates Divide.
-  CellDivSingle->Divide(Npb,Np-Npb-NpbPer-NpfPer,NpbPer,NpfPer,BoundChanged
+  //-Initiates Divide (periodic particles of the halo are already mixed with the rest).
+  //-Inicia Divide (las periodicas del halo ya estan mezcladas con el resto).
+  Timersc->TmStart(TMC_NlCellDiv);
+  const unsigned npini=Np;
+  if(perihalo)CellDivSingle->Divide(Npb,Np-Npb,0,0,BoundChanged,Dcellc,Codec,Idpc,Posc,Timersc);
+  else CellDivSingle->Divide(Npb,Np-Npb-NpbPer-NpfPer,NpbPer,NpfPer,BoundChanged
     ,Dcellc,Codec,Idpc,Posc,Timersc);
   DivData=CellDivSingle->GetCellDivData();
 
   //-Sorts particle data. | Ordena datos de particulas.
   Timersc->TmStart(TMC_NlSortData);
-  CellDivSingle->SortArray(Idpc);
-  CellDivSingle->SortArray(Codec);
-  CellDivSingle->SortArray(Dcellc);
-  CellDivSingle->SortArray(Posc);
-  CellDivSingle->SortArray(Velrhopc);
-  if(TStep==STEP_Verlet){
-    CellDivSingle->SortArray(VelrhopM1c);
-  }
-  else if(TStep==STEP_Symplectic && (PosPrec || VelrhopPrec)){//-In reality, this is only necessary in divide for corrector, not in predictor??? | En realidad solo es necesario en el divide del corrector, no en el predictor???
-    if(!PosPrec || !VelrhopPrec)Run_Exceptioon("Symplectic data is invalid.") ;
-    CellDivSingle->SortArray(PosPrec);
-    CellDivSingle->SortArray(VelrhopPrec);
-  }
-  if(TVisco==VISCO_LaminarSPS)CellDivSingle->SortArray(SpsTauc);
-  if(UseNormals){
-    CellDivSingle->SortArray(BoundNormalc);
-    if(MotionVelc)CellDivSingle->SortArray(MotionVelc);
-  }
+  if(TStep==STEP_Symplectic && (!PosPrec)!=(!VelrhopPrec))Run_Exceptioon("Symplectic data is invalid.");
+  SortParticleArrays();
 
   //-Collect divide data. | Recupera datos del divide.
   Np=CellDivSingle->GetNpFinal();
   Npb=CellDivSingle->GetNpbFinal();
   NpbOk=Npb-CellDivSingle->GetNpbIgnore();
 
+  //-Updates neighbour list according to new order. | Actualiza lista de vecinos segun el nuevo orden.
+  if(NgList)NgList->SortParticles(npini,Np,Npb,CellDivSingle->GetSortIni(),CellDivSingle->GetSortPart());
+  //-Updates periodic halo according to new order. | Actualiza halo periodico segun el nuevo orden.
+  if(PeriHalo)PeriHalo->SortParticles(npini,Np,CellDivSingle->GetSortIni(),CellDivSingle->GetSortPart());
+
   //-Manages excluded particles fixed, moving and floating before aborting the execution.
   if(CellDivSingle->GetNpbOut())AbortBoundOut();
 
+  //-Updates position of moving particles according to new order (it is computed again in RunMotion() with periodic conditions).
+  //-Actualiza posicion de particulas moving segun el nuevo orden (se calcula de nuevo en RunMotion() con condiciones periodicas).
+  if(RidpMoveOk){
+    if(PeriActive)RidpMoveOk=false;
+    else CellDivSingle->SortRidp(CaseNmoving,0,Npb,RidpMove);
+  }
   //-Collect position of floating particles. | Recupera posiciones de floatings.
-  if(CaseNfloat)CalcRidp(PeriActive!=0,Np-Npb,Npb,CaseNpb,CaseNpb+CaseNfloat,Codec,Idpc,FtRidp);
+  if(CaseNfloat){
+    if(FtRidpOk && !PeriActive)CellDivSingle->SortRidp(CaseNfloat,Npb,Np,FtRidp);
+    else CalcRidp(PeriActive!=0,Np-Npb,Npb,CaseNpb,CaseNpb+CaseNfloat,Codec,Idpc,FtRidp);
+    FtRidpOk=true;
+  }
   Timersc->TmStop(TMC_NlSortData);
+  Timersc->TmStop(TMC_NlCellDiv);
 
   //-Control of excluded particles (only fluid because excluded boundary are checked before).
   //-Gestion de particulas excluidas (solo fluid porque las boundary excluidas se comprueban antes).
@@ -498,6 +672,15 @@ void JSphCpuSingle::RunCellDivide(bool updateperiodic){
   }
   Timersc->TmStop(TMC_NlOutCheck);
   BoundChanged=false;
+
+  //-Creates periodic particles again when the particles to duplicate changed.
+  //-Crea de nuevo las periodicas cuando cambiaron las particulas a duplicar.
+  if(perihalo){
+    Timersc->TmStart(TMC_SuPeriodic);
+    const bool ok=PeriHalo->CheckSources(Np,DivData,Posc,Codec);
+    Timersc->TmStop(TMC_SuPeriodic);
+    if(!ok)RunCellDivide(true);
+  }
 }
 
 //==============================================================================
@@ -527,41 +710,56 @@ void JSphCpuSingle::Interaction_Forces(TpInterStep interstep){
   PreInteraction_Forces();
   tfloat3 *dengradcorr=NULL;
 
+  //-Rebuilds neighbour list when it is necessary. | Recrea lista de vecinos cuando es necesario.
+  if(NgList){
+    Timersc->TmStart(TMC_NlNgList);
+    NgList->Update(Np,Npb,DivData,Dcellc,Posc);
+    Timersc->TmStop(TMC_NlNgList);
+  }
+
   Timersc->TmStart(TMC_CfForces);
   //-Interaction of Fluid-Fluid/Bound & Bound-Fluid (forces and DEM). | Interaccion Fluid-Fluid/Bound & Bound-Fluid (forces and DEM).
   const stinterparmsc parms=StInterparmsc(Np,Npb,NpbOk
-    ,DivData,Dcellc
-    ,Posc,Velrhopc,Idpc,Codec,Pressc,dengradcorr
+    ,DivData,Dcellc,(NgList? NgList->GetNgList(): NgListCpuNull())
+    ,Posc,PosCellc,Velrhopc,Idpc,Codec,Pressc,dengradcorr
     ,Arc,Acec,Deltac
     ,ShiftingMode,ShiftPosfsc
     ,SpsTauc,SpsGradvelc
   );
   StInterResultc res;
   res.viscdt=0;
+  res.pirf=res.pirb=res.picf=res.picb=0;
+  res.epilogue=false; res.acemax=0;
   JSphCpu::Interaction_Forces_ct(parms,res);
-
-  //-For 2-D simulations zero the 2nd component. | Para simulaciones 2D anula siempre la 2nd componente.
-  if(Simulate2D){
-    const int ini=int(Npb),fin=int(Np),npf=int(Np-Npb);
-    #ifdef OMP_USE
-      #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
-    #endif
-    for(int p=ini;p<fin;p++)Acec[p].y=0;
-  }
-
-  //-Add Delta-SPH correction to Arg[]. | Anhade correccion de Delta-SPH a Arg[].
-  if(Deltac){
-    const int ini=int(Npb),fin=int(Np),npf=int(Np-Npb);
-    #ifdef OMP_USE
-      #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
-    #endif
-    for(int p=ini;p<fin;p++)if(Deltac[p]!=FLT_MAX)Arc[p]+=Deltac[p];
-  }
+  if(InterCounters)DsPips->AddInteraction(res.pirf,res.pirb,res.picf,res.picb);
 
   //-Calculates maximum value of ViscDt.
   ViscDtMax=res.viscdt;
-  //-Calculates maximum value of Ace (periodic particles are ignored).
-  AceMax=ComputeAceMax(Np-Npb,Acec+Npb,Codec+Npb);
+  //-2D zeroing, Delta-SPH and AceMax were already applied in the fluid interaction.
+  //-Anulacion 2D, Delta-SPH y AceMax ya se aplicaron en la interaccion del fluido.
+  if(res.epilogue)AceMax=res.acemax;
+  else{
+    //-For 2-D simulations zero the 2nd component. | Para simulaciones 2D anula siempre la 2nd componente.
+    if(Simulate2D){
+      const int ini=int(Npb),fin=int(Np),npf=int(Np-Npb);
+      #ifdef OMP_USE
+        #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
+      #endif
+      for(int p=ini;p<fin;p++)Acec[p].y=0;
+    }
+
+    //-Add Delta-SPH correction to Arg[]. | Anhade correccion de Delta-SPH a Arg[].
+    if(Deltac){
+      const int ini=int(Npb),fin=int(Np),npf=int(Np-Npb);
+      #ifdef OMP_USE
+        #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
+      #endif
+      for(int p=ini;p<fin;p++)if(Deltac[p]!=FLT_MAX)Arc[p]+=Deltac[p];
+    }
+
+    //-Calculates maximum value of Ace (periodic particles are ignored).
+    AceMax=ComputeAceMax(Np-Npb,Acec+Npb,Codec+Npb);
+  }
 
   Timersc->TmStop(TMC_CfForces);
 }
@@ -572,7 +770,9 @@ void JSphCpuSingle::Interaction_Forces(TpInterStep interstep){
 //==============================================================================
 void JSphCpuSingle::MdbcBoundCorrection(){
   Timersc->TmStart(TMC_CfPreForces);
+  Timersc->TmStart(TMC_CfMdbcCorrection);
   Interaction_MdbcCorrection(SlipMode,DivData,Posc,Codec,Idpc,BoundNormalc,MotionVelc,Velrhopc);
+  Timersc->TmStop(TMC_CfMdbcCorrection);
   Timersc->TmStop(TMC_CfPreForces);
 }
 
@@ -710,11 +910,14 @@ double JSphCpuSingle::ComputeStep_Sym(){
   RunCellDivide(true);
   Interaction_Forces(INTERSTEP_SymCorrector);  //-Interaction.
   const double ddt_c=DtVariable(true);         //-Calculate dt of corrector step.
-  if(Shifting)RunShifting(dt);                 //-Shifting.
-  ComputeSymplecticCorr(dt);                   //-Apply Symplectic-Corrector to particles (periodic particles become invalid).
+  if(FusedCorr)ComputeSymplecticCorrFused(dt); //-Apply Shifting, Symplectic-Corrector and Damping to particles in one pass.
+  else{
+    if(Shifting)RunShifting(dt);               //-Shifting.
+    ComputeSymplecticCorr(dt);                 //-Apply Symplectic-Corrector to particles (periodic particles become invalid).
+  }
   if(CaseNfloat)RunFloating(dt,false);         //-Control of floating bodies.
   PosInteraction_Forces();                     //-Free memory used for interaction.
-  if(Damping)RunDamping(dt,Np,Npb,Posc,Codec,Velrhopc); //-Applies Damping.
+  if(Damping && !FusedCorr)RunDamping(dt,Np,Npb,Posc,Codec,Velrhopc); //-Applies Damping.
   if(RelaxZones)RunRelaxZone(dt);              //-Generate waves using RZ.
   SymplecticDtPre=min(ddt_p,ddt_c);            //-Calculate dt for next ComputeStep.
   return(dt);
@@ -768,12 +971,76 @@ void JSphCpuSingle::FtCalcForcesSum(unsigned cf,tfloat3 &face,tfloat3 &fomegaace
   }
 }
 
+//==============================================================================
+/// Calculate summation of linear and angular forces starting from acceleration 
+/// of particles using all threads (for floatings with many particles). Partial 
+/// sums of each thread are combined in thread order.
+/// Calcula suma de fuerzas lineal y angular a partir de la aceleracion de las 
+/// particulas usando todos los hilos (para floatings con muchas particulas). Las
+/// sumas parciales de cada hilo se combinan en orden de hilo.
+//==============================================================================
+void JSphCpuSingle::FtCalcForcesSumOmp(unsigned cf,tfloat3 &face,tfloat3 &fomegaace)const{
+  const StFloatingData &fobj=FtObjs[cf];
+  const int fpini=int(fobj.begin-CaseNpb);
+  const int fpfin=fpini+int(fobj.count);
+  const float fradius=fobj.radius;
+  const tdouble3 fcenter=fobj.center;
+  const float fmassp=fobj.massp;
+  const bool periactive=(PeriActive!=0);
+
+  //-Computes partial sums of each thread. | Calcula sumas parciales de cada hilo.
+  const unsigned nth=unsigned(omp_get_max_threads());
+  std::vector<tfloat3> thsum(nth*2,TFloat3(0));
+  #ifdef OMP_USE
+    #pragma omp parallel
+  #endif
+  {
+    tfloat3 facth=TFloat3(0),fomegath=TFloat3(0);
+    #ifdef OMP_USE
+      #pragma omp for schedule (static) nowait
+    #endif
+    for(int fp=fpini;fp<fpfin;fp++){
+      const int p=int(FtRidp[fp]);
+      const tfloat3 force=Acec[p]*fmassp;
+      facth=facth+force;
+      const tfloat3 dist=(periactive? FtPeriodicDist(Posc[p],fcenter,fradius): ToTFloat3(Posc[p]-fcenter)); 
+      fomegath.x+= force.z*dist.y - force.y*dist.z;
+      fomegath.y+= force.x*dist.z - force.z*dist.x;
+      fomegath.z+= force.y*dist.x - force.x*dist.y;
+    }
+    const unsigned th=unsigned(omp_get_thread_num());
+    thsum[th*2]=facth;
+    thsum[th*2+1]=fomegath;
+  }
+  //-Combines partial sums. | Combina sumas parciales.
+  face=TFloat3(0);
+  fomegaace=TFloat3(0);
+  for(unsigned th=0;th<nth;th++){
+    face=face+thsum[th*2];
+    fomegaace=fomegaace+thsum[th*2+1];
+  }
+}
+
 //==============================================================================
 /// Computes final acceleration from particles and from external forces to ftoforces[].
+/// Floatings with many particles are summed using all threads (particle-parallel)
+/// and the rest are computed in parallel by floating.
 /// Calcula aceleracion final a parti de particulas y de fuerzas externas en ftoforces[].
+/// Los floatings con muchas particulas se suman usando todos los hilos y el resto
+/// se calcula en paralelo por floating.
 //==============================================================================
 void JSphCpuSingle::FtCalcForces(StFtoForces *ftoforces)const{
   const int ftcount=int(FtCount);
+  //-Computes summation of forces of large floatings using all threads.
+  //-Calcula suma de fuerzas de floatings grandes usando todos los hilos.
+  std::vector<byte> ftlarge(ftcount,0);
+  if(OmpThreads>1)for(int cf=0;cf<ftcount;cf++)if(FtObjs[cf].count>=OMP_LIMIT_FTFORCES){
+    tfloat3 face,fomegaace;
+    FtCalcForcesSumOmp(unsigned(cf),face,fomegaace);
+    ftoforces[cf].face=face+ftoforces[cf].face;
+    ftoforces[cf].fomegaace=fomegaace+ftoforces[cf].fomegaace;
+    ftlarge[cf]=1;
+  }
   #ifdef OMP_USE
     #pragma omp parallel for schedule (guided)
   #endif
@@ -792,10 +1059,16 @@ void JSphCpuSingle::FtCalcForces(StFtoForces *ftoforces)const{
 
     //-Compute summation of linear and angular forces starting from acceleration of particles.
     tfloat3 face,fomegaace;
-    FtCalcForcesSum(cf,face,fomegaace);
-    //-Adds inital external forces from ForcePoints, Moorings and external files.
-    face=face+ftoforces[cf].face;
-    fomegaace=fomegaace+ftoforces[cf].fomegaace;
+    if(ftlarge[cf]){ //-Summation of large floatings already includes external forces.
+      face=ftoforces[cf].face;
+      fomegaace=ftoforces[cf].fomegaace;
+    }
+    else{
+      FtCalcForcesSum(cf,face,fomegaace);
+      //-Adds inital external forces from ForcePoints, Moorings and external files.
+      face=face+ftoforces[cf].face;
+      fomegaace=fomegaace+ftoforces[cf].fomegaace;
+    }
 
     //-Calculate omega starting from fomegaace & invinert. | Calcula omega a partir de fomegaace y invinert.
     {
@@ -1037,8 +1310,13 @@ void JSphCpuSingle::ComputePips(bool run){
   if(run || DsPips->CheckRun(Nstep)){
     TimerSim.Stop();
     const double timesim=TimerSim.GetElapsedTimeD()/1000.;
-    DsPips->ComputeCpu(Nstep,TimeStep,timesim,CSP,OmpThreads,Np,Npb,NpbOk
-      ,DivData,Dcellc,Posc);
+    if(DsPips->Counters){
+      DsPips->ComputeCounters(Nstep,TimeStep,timesim);
+      return;
+    }
+    if(NgList)NgList->Update(Np,Npb,DivData,Dcellc,Posc);
+    DsPips->ComputeCpu(Nstep,TimeStep,timesim,CSP,Np,Npb,NpbOk
+      ,DivData,Dcellc,Posc,(NgList? NgList->GetNgList(): NgListCpuNull()));
   }
 }
 
@@ -1058,6 +1336,7 @@ void JSphCpuSingle::Run(std::string appname,const JSphCfgRun *cfg,JLog2 *log){
   //-Load parameters and values of input. | Carga de parametros y datos de entrada.
   //--------------------------------------------------------------------------------
   LoadConfig(cfg);
+  Timersc->ConfigThreads(unsigned(OmpThreads));
   LoadCaseParticles();
   VisuConfig();
   ConfigDomain();
@@ -1177,6 +1456,13 @@ void JSphCpuSingle::SaveData(){
   if(UseNormals && SvNormals)SaveVtkNormals("normals/Normals.vtk",Part,npsave,Npb,Posc,Idpc,BoundNormalc,1.f);
   //-Save extra data.
   if(SvExtraDataBi4)SaveExtraData();
+  //-Saves accumulated timers.
+  if(SvTimersPart){
+    Log->AddFileInfo(DirOut+"RunTimers.csv","Saves accumulated times of timers for each PART.");
+    Log->AddFileInfo(DirOut+"RunTimers.json","Saves tree of timers with per-thread times of last PART.");
+    Timersc->SaveCsvPart(DirOut+"RunTimers.csv",CsvSepComa,Part,TimeStep,Nstep);
+    Timersc->SaveJsonPart(DirOut+"RunTimers.json",Part,TimeStep,Nstep);
+  }
   Timersc->TmStop(TMC_SuSavePart);
 }
 
@@ -1202,8 +1488,11 @@ void JSphCpuSingle::SaveExtraData(){
 /// Muestra y graba resumen final de ejecucion.
 //==============================================================================
 void JSphCpuSingle::FinishRun(bool stop){
+  SavePartDataWait();
   float tsim=TimerSim.GetElapsedTimeF()/1000.f,ttot=TimerTot.GetElapsedTimeF()/1000.f;
   JSph::ShowResume(stop,tsim,ttot,true,"");
+  if(NgList)Log->Print(NgList->GetInfo());
+  if(PeriHalo)Log->Print(PeriHalo->GetInfo());
   Log->Print(" ");
   string hinfo,dinfo;
   if(SvTimers){
@@ -43,15 +43,24 @@ protected:
   void ConfigDomain();
 
   void ResizeParticlesSize(unsigned newsize,float oversize,bool updatedivide);
-  unsigned PeriodicMakeList(unsigned np,unsigned pini,bool stable,unsigned nmax,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const;
+  /// Returns new periodic particles of position ps: 1 (ps+perinc), 2 (ps-perinc) or 3 (both).
+  /// Devuelve nuevas periodicas de la posicion ps: 1 (ps+perinc), 2 (ps-perinc) o 3 (ambas).
+  inline byte PeriodicCheckPos(const tdouble3 &ps,const tdouble3 &perinc)const{
+    const tdouble3 ps1=ps+perinc,ps2=ps-perinc;
+    return(byte((PeriPosMin<=ps1 && ps1<PeriPosMax? 1: 0) | (PeriPosMin<=ps2 && ps2<PeriPosMax? 2: 0)));
+  }
+  unsigned PeriodicListBlocks(unsigned n)const;
+  unsigned PeriodicCountList(unsigned n,unsigned pini,unsigned nblk,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *blkpos)const;
+  void PeriodicMakeList(unsigned n,unsigned pini,unsigned nblk,const unsigned *blkpos,tdouble3 perinc,const tdouble3 *pos,const typecode *code,unsigned *listp)const;
   void PeriodicDuplicatePos(unsigned pnew,unsigned pcopy,bool inverse,double dx,double dy,double dz,tuint3 cellmax,tdouble3 *pos,unsigned *dcell)const;
   void PeriodicDuplicateVerlet(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1)const;
+    ,const unsigned *listnew,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tfloat4 *velrhopm1)const;
   void PeriodicDuplicateSymplectic(unsigned np,unsigned pini,tuint3 cellmax,tdouble3 perinc,const unsigned *listp
-    ,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const;
+    ,const unsigned *listnew,unsigned *idp,typecode *code,unsigned *dcell,tdouble3 *pos,tfloat4 *velrhop,tsymatrix3f *spstau,tdouble3 *pospre,tfloat4 *velrhoppre)const;
   void PeriodicDuplicateNormals(unsigned np,unsigned pini,tuint3 cellmax
-    ,tdouble3 perinc,const unsigned *listp,tfloat3 *motionvel,tfloat3 *normals)const;
+    ,tdouble3 perinc,const unsigned *listp,const unsigned *listnew,tfloat3 *motionvel,tfloat3 *normals)const;
   void RunPeriodic();
+  bool RunPeriodicHalo();
 
   void RunCellDivide(bool updateperiodic);
   void AbortBoundOut();
@@ -60,6 +69,7 @@ protected:
   void MdbcBoundCorrection();
 
   double ComputeAceMax(unsigned np,const tfloat3* ace,const typecode *code)const;
+  void SortParticleArrays();
   template<bool checkcode> double ComputeAceMaxSeq(unsigned np,const tfloat3* ace,const typecode *code)const;
   template<bool checkcode> double ComputeAceMaxOmp(unsigned np,const tfloat3* ace,const typecode *code)const;
   
@@ -71,6 +81,7 @@ protected:
 
   inline tfloat3 FtPeriodicDist(const tdouble3 &pos,const tdouble3 &center,float radius)const;
   void FtCalcForcesSum(unsigned cf,tfloat3 &face,tfloat3 &fomegaace)const;
+  void FtCalcForcesSumOmp(unsigned cf,tfloat3 &face,tfloat3 &fomegaace)const;
   void FtCalcForces(StFtoForces *ftoforces)const;
   void FtCalcForcesRes(double dt,const StFtoForces *ftoforces,StFtoForcesRes *ftoforcesres)const;
   void FtApplyImposedVel(StFtoForcesRes *ftoforcesres)const;
@@ -33,7 +33,14 @@
 #endif
 
 #include <cfloat>
+#include <cstring>
 #include <algorithm>
+#ifndef WIN32
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
 
 using namespace std;
 
@@ -121,6 +128,9 @@ void JSphInOutGridDataTime::Interpolate(double time,const JSphInOutGridDataTime
 JSphInOutGridData::JSphInOutGridData():Log(AppInfo.LogPtr()){
   ClassName="JSphInOutGridData";
   SelData=NULL;
+  Streaming=false;
+  MapPtr=NULL; MapSize=0;
+  NextCount=0;
   #ifdef _WITHGPU
     Velx0g=Velx1g=SelVelxg=NULL;
     Velz0g=Velz1g=SelVelzg=NULL;
@@ -141,7 +151,8 @@ JSphInOutGridData::~JSphInOutGridData(){
 //==============================================================================
 void JSphInOutGridData::Reset(){
   File="";
-  const unsigned nt=CountTimes();
+  FreeStreaming();
+  const unsigned nt=unsigned(DataTimes.size());
   for(unsigned ct=0;ct<nt;ct++){ delete DataTimes[ct]; DataTimes[ct]=NULL; }
   DataTimes.clear();
   Nx=Nz=Npt=0;
@@ -187,6 +198,28 @@ void JSphInOutGridData::FreeMemoryGpu(){
 }
 #endif
 
+//==============================================================================
+/// Stops background thread and frees data from BIN file.
+/// Detiene el hilo en segundo plano y libera los datos del fichero BIN.
+//==============================================================================
+void JSphInOutGridData::FreeStreaming(){
+  if(Prefetch.joinable())Prefetch.join();
+  PrefetchError="";
+  NextCount=0;
+  #ifndef WIN32
+    if(MapPtr)munmap((void*)MapPtr,size_t(MapSize));
+  #endif
+  MapPtr=NULL; MapSize=0;
+  for(unsigned c=0;c<unsigned(WinData.size());c++)delete WinData[c];
+  for(unsigned c=0;c<unsigned(NextData.size());c++)delete NextData[c];
+  WinData.clear();
+  NextData.clear();
+  WinIni=WinCount=NextIni=0;
+  Times.clear();
+  RecSize=0;
+  Streaming=false;
+}
+
 //==============================================================================
 /// Sets origin of grid.
 //==============================================================================
@@ -198,21 +231,42 @@ void JSphInOutGridData::SetPosMin(const tdouble3 &posmin){
 }
 
 //==============================================================================
-/// Configures and load data from CSV or BIN file.
+/// Configures and load data from CSV or BIN file. CSV file is converted to a
+/// BIN file in the output directory and its data is loaded by windows of times.
+/// Configura y carga datos de fichero CSV o BIN. El fichero CSV se convierte a
+/// fichero BIN en el directorio de salida y sus datos se cargan por ventanas 
+/// de tiempos.
 //==============================================================================
 void JSphInOutGridData::ConfigFromFile(const std::string &filename){
   Reset();
   string ext=fun::StrUpper(fun::GetExtension(filename));
-  if(ext=="CSV")LoadDataCsv(filename);
+  if(ext=="CSV"){
+    const string filebin=AppInfo.GetDirOut()+fun::GetWithoutExtension(fun::GetFile(filename))+"_GridData.bin";
+    ConvertCsvToBin(filename,filebin);
+    LoadDataBin(filebin);
+  }
   else if(ext=="BIN")LoadDataBin(filename);
   else Run_ExceptioonFile("Unknown file extension.",filename);
   File=filename;
 }
 
 //==============================================================================
-/// Configures and load data from CSV file.
+/// Converts CSV file to BIN file. Each time is stored after reading it, so
+/// the data of all times is never in memory.
+/// Convierte fichero CSV a fichero BIN. Cada tiempo se graba tras leerlo, de
+/// forma que los datos de todos los tiempos nunca estan en memoria.
 //==============================================================================
-void JSphInOutGridData::LoadDataCsv(const std::string &filename){
+void JSphInOutGridData::ConvertCsvToBin(const std::string &filecsv,const std::string &filebin){
+  Reset();
+  LoadDataCsv(filecsv,fun::GetWithoutExtension(filebin)+".bin");
+  Reset();
+}
+
+//==============================================================================
+/// Configures and load data from CSV file. With filebin the data of each time
+/// is stored in BIN file instead of being loaded.
+//==============================================================================
+void JSphInOutGridData::LoadDataCsv(const std::string &filename,const std::string &filebin){
   JReadDatafile rdat;
   rdat.LoadFile(filename);
   //-Load and check fmtversion.
@@ -244,16 +298,37 @@ void JSphInOutGridData::LoadDataCsv(const std::string &filename){
   else if(vars=="velx velz")usevelz=true;
   else Run_ExceptioonFile("Head value \'vars\' is invalid.",filename);
   ConfigGridData(nx,nz,dpx,dpz,usevelz);
+  //-Creates BIN file to store the data.
+  const bool svbin=!filebin.empty();
+  std::ofstream pfbin;
+  if(svbin){
+    pfbin.open(filebin.c_str(),ios::binary|ios::out);
+    if(!pfbin)Run_ExceptioonFile("Cannot open the file.",filebin);
+    SaveBinHead(pfbin,0);
+  }
   //-Load values data according FmtVersion.
   rdat.SetReadLine(4);
   const unsigned npt=nx*nz;
   float *velx=new float[npt];
   float *velz=(usevelz? new float[npt]: NULL);
+  double lasttime=0;
   for(unsigned cr=4;cr<rows;cr++){
     const double time=rdat.ReadNextDouble();
     for(unsigned p=0;p<npt;p++)velx[p]=rdat.ReadNextFloat(true);
     if(usevelz)for(unsigned p=0;p<npt;p++)velz[p]=rdat.ReadNextFloat(true);
-    AddDataTime(time,npt,velx,velz);
+    if(svbin){
+      if(cr>4 && lasttime>=time)Run_ExceptioonFile("New time of data is not higher than previous one.",filename);
+      SaveBinTime(pfbin,time,velx,velz);
+      lasttime=time;
+    }
+    else AddDataTime(time,npt,velx,velz);
+  }
+  //-Updates number of times in BIN file.
+  if(svbin){
+    pfbin.seekp(0,pfbin.beg);
+    SaveBinHead(pfbin,rows-4);
+    if(pfbin.fail())Run_ExceptioonFile("File writing failure.",filebin);
+    pfbin.close();
   }
   //SaveDataCsv("dg.csv");
   //-Frees memory.
@@ -262,10 +337,213 @@ void JSphInOutGridData::LoadDataCsv(const std::string &filename){
 }
 
 //==============================================================================
-/// Configures and load data from BIN file.
+/// Configures data from BIN file. The file is mapped in memory (when it is
+/// possible) and only the times are loaded, the data is loaded by windows.
+/// Configura datos de fichero BIN. El fichero se mapea en memoria (cuando es
+/// posible) y solo se cargan los tiempos, los datos se cargan por ventanas.
 //==============================================================================
 void JSphInOutGridData::LoadDataBin(const std::string &filename){
-  Run_Exceptioon("NOT IMPLEMENTED...");
+  //-Loads and checks head.
+  StHeadBin hd;
+  llong fsize=0;
+  {
+    std::ifstream pf;
+    pf.open(filename.c_str(),ios::binary|ios::in);
+    if(!pf)Run_ExceptioonFile("Cannot open the file.",filename);
+    pf.seekg(0,pf.end);
+    fsize=llong(pf.tellg());
+    pf.seekg(0,pf.beg);
+    memset(&hd,0,sizeof(StHeadBin));
+    if(fsize>=llong(sizeof(StHeadBin)))pf.read((char*)&hd,sizeof(StHeadBin));
+    if(fsize<llong(sizeof(StHeadBin)) || pf.fail() || strncmp(hd.title,"#InOutGridData",16))Run_ExceptioonFile("File format is invalid.",filename);
+    pf.close();
+  }
+  if(hd.fmtversion!=FmtVersion)Run_ExceptioonFile(fun::PrintStr("fmtversion value (%u) is invalid. The expected format version is %u.",hd.fmtversion,FmtVersion),filename);
+  ConfigGridData(hd.nx,hd.nz,hd.dpx,hd.dpz,hd.usevelz!=0);
+  RecSize=llong(sizeof(double))+llong(sizeof(float))*Npt*(UseVelz? 2: 1);
+  if(!hd.ntimes || hd.ntimes>=UINT_MAX || llong(sizeof(StHeadBin))+RecSize*llong(hd.ntimes)!=fsize)
+    Run_ExceptioonFile("Number of times does not match the file size.",filename);
+  const unsigned nt=unsigned(hd.ntimes);
+  //-Maps file in memory. | Mapea fichero en memoria.
+  #ifndef WIN32
+  {
+    const int fd=open(filename.c_str(),O_RDONLY);
+    if(fd>=0){
+      void *map=mmap(NULL,size_t(fsize),PROT_READ,MAP_PRIVATE,fd,0);
+      if(map!=MAP_FAILED){
+        MapPtr=(const byte*)map;
+        MapSize=fsize;
+      }
+      close(fd);
+    }
+  }
+  #endif
+  //-Loads times. | Carga tiempos.
+  File=filename;
+  Streaming=true;
+  Times.resize(nt);
+  if(MapPtr){
+    for(unsigned ct=0;ct<nt;ct++)memcpy(&Times[ct],MapPtr+sizeof(StHeadBin)+RecSize*ct,sizeof(double));
+  }
+  else{
+    std::ifstream pf;
+    pf.open(filename.c_str(),ios::binary|ios::in);
+    for(unsigned ct=0;ct<nt && pf;ct++){
+      pf.seekg(std::streamoff(sizeof(StHeadBin)+RecSize*ct),pf.beg);
+      pf.read((char*)&Times[ct],sizeof(double));
+    }
+    if(!pf)Run_ExceptioonFile("File reading failure.",filename);
+    pf.close();
+  }
+  for(unsigned ct=1;ct<nt;ct++)if(Times[ct-1]>=Times[ct])Run_ExceptioonFile("Times of data are not in ascending order.",filename);
+  //-Allocates memory for windows. | Reserva memoria para ventanas.
+  for(unsigned c=0;c<WINTIMES;c++){
+    WinData.push_back(new JSphInOutGridDataTime(Nx,Nz));
+    NextData.push_back(new JSphInOutGridDataTime(Nx,Nz));
+  }
+  WinIni=WinCount=0;
+}
+
+//==============================================================================
+/// Stores head of BIN file.
+//==============================================================================
+void JSphInOutGridData::SaveBinHead(std::ofstream &pf,ullong ntimes)const{
+  StHeadBin hd;
+  memset(&hd,0,sizeof(StHeadBin));
+  strncpy(hd.title,"#InOutGridData",16);
+  hd.fmtversion=FmtVersion;
+  hd.nx=Nx; hd.nz=Nz;
+  hd.usevelz=(UseVelz? 1: 0);
+  hd.dpx=Dpx; hd.dpz=Dpz;
+  hd.ntimes=ntimes;
+  pf.write((const char*)&hd,sizeof(StHeadBin));
+}
+
+//==============================================================================
+/// Stores data of one time in BIN file.
+//==============================================================================
+void JSphInOutGridData::SaveBinTime(std::ofstream &pf,double time
+  ,const float *velx,const float *velz)const
+{
+  pf.write((const char*)&time,sizeof(double));
+  pf.write((const char*)velx,sizeof(float)*Npt);
+  if(UseVelz)pf.write((const char*)velz,sizeof(float)*Npt);
+}
+
+//==============================================================================
+/// Loads n times starting at ctini from BIN file. Pages of the mapped file
+/// are released after copying the data.
+/// Carga n tiempos desde ctini del fichero BIN. Las paginas del fichero 
+/// mapeado se liberan tras copiar los datos.
+//==============================================================================
+void JSphInOutGridData::ReadTimes(unsigned ctini,unsigned n,JSphInOutGridDataTime **gdt)const{
+  if(!Streaming || ctini+n>CountTimes())Run_Exceptioon("Requested times are invalid.");
+  const llong pini=llong(sizeof(StHeadBin))+RecSize*ctini;
+  const llong size=RecSize*n;
+  if(MapPtr){
+    #ifndef WIN32
+      const llong spage=llong(sysconf(_SC_PAGESIZE));
+      const llong mini=(pini/spage)*spage;
+      madvise((void*)(MapPtr+mini),size_t(pini+size-mini),MADV_WILLNEED);
+    #endif
+    for(unsigned c=0;c<n;c++){
+      const byte *ptr=MapPtr+pini+RecSize*c;
+      const float *velx=(const float*)(ptr+sizeof(double));
+      gdt[c]->SetData(Times[ctini+c],velx,(UseVelz? velx+Npt: NULL));
+    }
+    #ifndef WIN32
+      madvise((void*)(MapPtr+mini),size_t(pini+size-mini),MADV_DONTNEED);
+    #endif
+  }
+  else{
+    std::vector<byte> buf;
+    buf.resize(size_t(size));
+    std::ifstream pf;
+    pf.open(File.c_str(),ios::binary|ios::in);
+    if(pf){
+      pf.seekg(std::streamoff(pini),pf.beg);
+      pf.read((char*)buf.data(),std::streamsize(size));
+    }
+    if(!pf)Run_ExceptioonFile("File reading failure.",File);
+    pf.close();
+    for(unsigned c=0;c<n;c++){
+      const float *velx=(const float*)(buf.data()+RecSize*c+sizeof(double));
+      gdt[c]->SetData(Times[ctini+c],velx,(UseVelz? velx+Npt: NULL));
+    }
+  }
+}
+
+//==============================================================================
+/// Loads the next window in background thread.
+/// Carga la siguiente ventana en el hilo en segundo plano.
+//==============================================================================
+void JSphInOutGridData::RunPrefetch(){
+  try{
+    ReadTimes(NextIni,NextCount,NextData.data());
+  }
+  catch(const std::exception &e){
+    PrefetchError=e.what();
+    if(PrefetchError.empty())PrefetchError="Unknown error.";
+  }
+  catch(...){
+    PrefetchError="Unknown error.";
+  }
+}
+
+//==============================================================================
+/// Waits for the background thread and throws exception when it failed.
+/// Espera por el hilo en segundo plano y lanza excepcion cuando fallo.
+//==============================================================================
+void JSphInOutGridData::WaitPrefetch(){
+  if(Prefetch.joinable())Prefetch.join();
+  if(!PrefetchError.empty()){
+    const string err=PrefetchError;
+    PrefetchError="";
+    NextCount=0;
+    Run_Exceptioon(string("Error loading data in background. ")+err);
+  }
+}
+
+//==============================================================================
+/// Selects window with times ct0 and ct1 (ct0<=ct1<ct0+WINTIMES) using the 
+/// window loaded in background when it is possible and starts the load of 
+/// the next window.
+/// Selecciona ventana con los tiempos ct0 y ct1 (ct0<=ct1<ct0+WINTIMES) usando
+/// la ventana cargada en segundo plano cuando es posible e inicia la carga de
+/// la siguiente ventana.
+//==============================================================================
+void JSphInOutGridData::SelectWindow(unsigned ct0,unsigned ct1){
+  if(WinCount && WinIni<=ct0 && ct1<WinIni+WinCount)return;
+  WaitPrefetch();
+  const unsigned nt=CountTimes();
+  if(NextCount && NextIni<=ct0 && ct1<NextIni+NextCount){
+    WinData.swap(NextData);
+    WinIni=NextIni; WinCount=NextCount;
+  }
+  else{
+    WinIni=ct0; WinCount=min(WINTIMES,nt-ct0);
+    ReadTimes(WinIni,WinCount,WinData.data());
+  }
+  NextCount=0;
+  //-Starts load of next window (the last time of current window is the first of next one).
+  //-Inicia la carga de la siguiente ventana (el ultimo tiempo de la actual es el primero de la siguiente).
+  if(WinIni+WinCount<nt){
+    NextIni=WinIni+WinCount-1;
+    NextCount=min(WINTIMES,nt-NextIni);
+    Prefetch=std::thread(&JSphInOutGridData::RunPrefetch,this);
+  }
+}
+
+//==============================================================================
+/// Returns data of time ct. Data from BIN file is loaded in gdtmp.
+/// Devuelve datos del tiempo ct. Los datos del fichero BIN se cargan en gdtmp.
+//==============================================================================
+const JSphInOutGridDataTime* JSphInOutGridData::GetDataTime(unsigned ct
+  ,JSphInOutGridDataTime *gdtmp)const
+{
+  if(!Streaming)return(DataTimes[ct]);
+  ReadTimes(ct,1,&gdtmp);
+  return(gdtmp);
 }
 
 //==============================================================================
@@ -284,6 +562,7 @@ void JSphInOutGridData::ConfigGridData(unsigned nx,unsigned nz,double dpx,double
 /// Adds data for another time.
 //==============================================================================
 void JSphInOutGridData::AddDataTime(double time,unsigned npt,const float *velx,const float *velz){
+  if(Streaming)Run_Exceptioon("Data cannot be added when it is loaded from BIN file.");
   if(CountTimes() && DataTimes[CountTimes()-1]->GetTime()>=time)Run_Exceptioon("New time of data is not higher than previous one.");
   if(npt!=Npt)Run_Exceptioon("The number of points does not match.");
   JSphInOutGridDataTime *gdt=new JSphInOutGridDataTime(Nx,Nz,time,velx,(UseVelz? velz: NULL));
@@ -309,9 +588,10 @@ void JSphInOutGridData::SaveDataCsv(std::string filename)const{
   scsv.SaveData(true);
   //-Saves data in CSV file.
   scsv.SetData();
+  JSphInOutGridDataTime gdtmp(Nx,Nz);
   const unsigned nt=CountTimes();
   for(unsigned ct=0;ct<nt;ct++){
-    const JSphInOutGridDataTime *gdt=DataTimes[ct];
+    const JSphInOutGridDataTime *gdt=GetDataTime(ct,&gdtmp);
     const float *velx=gdt->GetVelx();
     const float *velz=gdt->GetVelz();
     scsv << gdt->GetTime();
@@ -323,6 +603,25 @@ void JSphInOutGridData::SaveDataCsv(std::string filename)const{
   scsv.SaveData(true);
 }
 
+//==============================================================================
+/// Saves DataTimes in BIN file.
+//==============================================================================
+void JSphInOutGridData::SaveDataBin(std::string filename)const{
+  filename=fun::GetWithoutExtension(filename)+".bin";
+  std::ofstream pf;
+  pf.open(filename.c_str(),ios::binary|ios::out);
+  if(!pf)Run_ExceptioonFile("Cannot open the file.",filename);
+  JSphInOutGridDataTime gdtmp(Nx,Nz);
+  const unsigned nt=CountTimes();
+  SaveBinHead(pf,nt);
+  for(unsigned ct=0;ct<nt;ct++){
+    const JSphInOutGridDataTime *gdt=GetDataTime(ct,&gdtmp);
+    SaveBinTime(pf,gdt->GetTime(),gdt->GetVelx(),gdt->GetVelz());
+  }
+  if(pf.fail())Run_ExceptioonFile("File writing failure.",filename);
+  pf.close();
+}
+
 //==============================================================================
 /// Loads values for time t in SelData object.
 //==============================================================================
@@ -331,14 +630,15 @@ void JSphInOutGridData::ComputeTime(double t){
   if(SelData->GetTime()!=t){
     const unsigned nt=CountTimes();
     if(SelCt>=nt)SelCt=nt-1;
-    while(SelCt+1<nt && t>=DataTimes[SelCt+1]->GetTime())SelCt++;
-    while(SelCt>0 && t<DataTimes[SelCt-1]->GetTime())SelCt--;
-    const double seltime=DataTimes[SelCt]->GetTime();
+    while(SelCt+1<nt && t>=GetTimeCt(SelCt+1))SelCt++;
+    while(SelCt>0 && t<GetTimeCt(SelCt-1))SelCt--;
+    if(Streaming)SelectWindow(SelCt,(SelCt+1<nt? SelCt+1: SelCt));
+    const double seltime=GetTimeCt(SelCt);
     if(t<=seltime || (t>=seltime && SelCt+1>=nt)){//-Copy data from DataTimes[SelCt].
-      SelData->CopyFrom(t,DataTimes[SelCt]);
+      SelData->CopyFrom(t,GetDataTimeCt(SelCt));
     }
     else{ //-Interpolate data between DataTimes[SelCt] and DataTimes[SelCt+1].
-      SelData->Interpolate(t,DataTimes[SelCt],DataTimes[SelCt+1]);
+      SelData->Interpolate(t,GetDataTimeCt(SelCt),GetDataTimeCt(SelCt+1));
     }
   }
 }
@@ -443,9 +743,10 @@ void JSphInOutGridData::ComputeTimeGpu(double t){
   if(TimeGpu!=t){
     const unsigned nt=CountTimes();
     if(SelCt>=nt)SelCt=nt-1;
-    while(SelCt+1<nt && t>=DataTimes[SelCt+1]->GetTime())SelCt++;
-    while(SelCt>0 && t<DataTimes[SelCt-1]->GetTime())SelCt--;
-    const double seltime=DataTimes[SelCt]->GetTime();
+    while(SelCt+1<nt && t>=GetTimeCt(SelCt+1))SelCt++;
+    while(SelCt>0 && t<GetTimeCt(SelCt-1))SelCt--;
+    if(Streaming)SelectWindow(SelCt,(SelCt+1<nt? SelCt+1: SelCt));
+    const double seltime=GetTimeCt(SelCt);
     //-Swap data between variables for time t0 and t1.
     if(CtVel0!=SelCt && CtVel1==SelCt){
       swap(CtVel0,CtVel1);
@@ -455,15 +756,15 @@ void JSphInOutGridData::ComputeTimeGpu(double t){
     //-Updata data for time t0.
     if(CtVel0!=SelCt){
       CtVel0=SelCt;
-      cudaMemcpy(Velx0g,DataTimes[SelCt]->GetVelx(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
-      if(UseVelz)cudaMemcpy(Velz0g,DataTimes[SelCt]->GetVelz(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
+      cudaMemcpy(Velx0g,GetDataTimeCt(SelCt)->GetVelx(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
+      if(UseVelz)cudaMemcpy(Velz0g,GetDataTimeCt(SelCt)->GetVelz(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
     }
     //-Updata data for time t1.
     unsigned selct1=(SelCt+1<nt? SelCt+1: SelCt);
     if(CtVel1!=selct1){
       CtVel1=selct1;
-      cudaMemcpy(Velx1g,DataTimes[selct1]->GetVelx(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
-      if(UseVelz)cudaMemcpy(Velz1g,DataTimes[selct1]->GetVelz(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
+      cudaMemcpy(Velx1g,GetDataTimeCt(selct1)->GetVelx(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
+      if(UseVelz)cudaMemcpy(Velz1g,GetDataTimeCt(selct1)->GetVelz(),sizeof(float)*Npt,cudaMemcpyHostToDevice);
     }
     //-Updata data for the requested time (t).
     if(t<=seltime || (t>=seltime && SelCt+1>=nt)){//-Copy data from DataTimes[SelCt].
@@ -475,8 +776,8 @@ void JSphInOutGridData::ComputeTimeGpu(double t){
     }
     else{ //-Interpolate data between DataTimes[SelCt] and DataTimes[SelCt+1].
       CtSelVel=UINT_MAX;
-      const double t0=DataTimes[CtVel0]->GetTime();
-      const double t1=DataTimes[CtVel1]->GetTime();
+      const double t0=GetTimeCt(CtVel0);
+      const double t1=GetTimeCt(CtVel1);
       cusphinout::InOutInterpolateTime(Npt,t,t0,t1,Velx0g,Velx1g,SelVelxg,Velz0g,Velz1g,SelVelzg);
     }
     TimeGpu=t;
@@ -537,8 +838,9 @@ void JSphInOutGridData::SaveDataVtk(std::string filename,int ctime)const{
   const unsigned ctini=(!onefile? 0: unsigned(ctime));
   const unsigned ctfin=(!onefile? CountTimes(): unsigned(ctime)+1);
   if(ctini>=CountTimes())Run_Exceptioon("Number of DataTime is invalid.");
-  if(onefile)SaveVtk(DataTimes[ctini],filename);
-  else for(unsigned ct=ctini;ct<ctfin;ct++)SaveVtk(DataTimes[ct],fun::FileNameSec(filename,ct));
+  JSphInOutGridDataTime gdtmp(Nx,Nz);
+  if(onefile)SaveVtk(GetDataTime(ctini,&gdtmp),filename);
+  else for(unsigned ct=ctini;ct<ctfin;ct++)SaveVtk(GetDataTime(ct,&gdtmp),fun::FileNameSec(filename,ct));
 }
 
 //==============================================================================
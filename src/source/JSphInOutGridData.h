@@ -21,6 +21,11 @@
 //:# Cambios:
 //:# =========
 //:# - Clase para gestionar la creacion de los puntos inlet. (25-01-2017)
+//:# - Carga de ficheros BIN mapeados en memoria manteniendo solo una ventana de
+//:#   tiempos y precarga de la siguiente ventana en segundo plano. Conversion
+//:#   de CSV a BIN sin cargar todos los tiempos. (17-10-2026)
+//:# - Los ficheros CSV se convierten a BIN en el directorio de salida para cargar
+//:#   sus datos por ventanas de tiempos. (17-10-2026)
 //:#############################################################################
 
 /// \file JSphInOutGrid.h \brief Declares the class \ref JSphInOutGrid.
@@ -30,6 +35,8 @@
 
 #include <string>
 #include <vector>
+#include <fstream>
+#include <thread>
 #include "JObject.h"
 #include "DualSphDef.h"
 #ifdef _WITHGPU
@@ -74,8 +81,29 @@ public:
 //# JSphInOutGridData
 //##############################################################################
 /// \brief Defines object to manage interpolation grid points.
+///
+/// Data from BIN files is not fully loaded. The file is mapped in memory and
+/// only a window of WINTIMES consecutive times is kept, while the next window
+/// (sharing one time with the current one) is loaded by a background thread.
+/// BIN format: StHeadBin followed by one record per time with time (double),
+/// velx[Npt] and velz[Npt] (only when UseVelz) as float.
 class JSphInOutGridData : protected JObject
 {
+public:
+  ///Head of BIN file.
+  typedef struct{
+    char title[16];       ///<File title ("#InOutGridData").
+    unsigned fmtversion;  ///<Format version.
+    unsigned nx;          ///<Number of points in X.
+    unsigned nz;          ///<Number of points in Z.
+    unsigned usevelz;     ///<Z velocity is included.
+    double dpx;           ///<Distance between points in X.
+    double dpz;           ///<Distance between points in Z.
+    ullong ntimes;        ///<Number of times.
+  }StHeadBin;
+
+  static const unsigned WINTIMES=32;  ///<Number of times in each window of data from BIN file.
+
 private:
   JLog2 *Log;
   std::string File;
@@ -92,8 +120,34 @@ private:
 
   std::vector<JSphInOutGridDataTime*> DataTimes;
 
-  void LoadDataCsv(const std::string &filename);
+  //-Variables for data from BIN file.
+  bool Streaming;             ///<Data is loaded from BIN file by windows of times.
+  llong RecSize;              ///<Size of data of each time in BIN file.
+  std::vector<double> Times;  ///<Times in BIN file.
+  const byte *MapPtr;         ///<BIN file mapped in memory (NULL when it is not mapped).
+  llong MapSize;              ///<Size of mapped BIN file.
+  std::vector<JSphInOutGridDataTime*> WinData;  ///<Data of current window [WINTIMES].
+  unsigned WinIni;            ///<First time of current window.
+  unsigned WinCount;          ///<Number of times in current window.
+  std::vector<JSphInOutGridDataTime*> NextData; ///<Data of next window loaded in background [WINTIMES].
+  unsigned NextIni;           ///<First time of next window.
+  unsigned NextCount;         ///<Number of times in next window (0 when it is not requested).
+  std::thread Prefetch;       ///<Background thread to load the next window.
+  std::string PrefetchError;  ///<Error in background thread.
+
+  void LoadDataCsv(const std::string &filename,const std::string &filebin="");
   void LoadDataBin(const std::string &filename);
+  void SaveBinHead(std::ofstream &pf,ullong ntimes)const;
+  void SaveBinTime(std::ofstream &pf,double time,const float *velx,const float *velz)const;
+
+  void FreeStreaming();
+  void ReadTimes(unsigned ctini,unsigned n,JSphInOutGridDataTime **gdt)const;
+  void RunPrefetch();
+  void WaitPrefetch();
+  void SelectWindow(unsigned ct0,unsigned ct1);
+  double GetTimeCt(unsigned ct)const{ return(Streaming? Times[ct]: DataTimes[ct]->GetTime()); }
+  const JSphInOutGridDataTime* GetDataTimeCt(unsigned ct)const{ return(Streaming? WinData[ct-WinIni]: DataTimes[ct]); }
+  const JSphInOutGridDataTime* GetDataTime(unsigned ct,JSphInOutGridDataTime *gdtmp)const;
 
   unsigned SelCt;
   JSphInOutGridDataTime* SelData;
@@ -127,6 +181,7 @@ public:
   ~JSphInOutGridData();
   void Reset();
   void ConfigFromFile(const std::string &filename);
+  void ConvertCsvToBin(const std::string &filecsv,const std::string &filebin);
   void ConfigGridData(unsigned nx,unsigned nz,double dpx,double dpz,bool usevelz);
   void SetPosMin(const tdouble3 &posmin);
 
@@ -138,7 +193,8 @@ public:
   double GetDpz()const{ return(Dpz); }
   bool GetUseVelz()const{ return(UseVelz); }
 
-  unsigned CountTimes()const{ return(unsigned(DataTimes.size())); }
+  unsigned CountTimes()const{ return(unsigned(Streaming? Times.size(): DataTimes.size())); }
+  bool GetStreaming()const{ return(Streaming); }
   std::string GetFile()const{ return(File); };
 
   void InterpolateVelCpu(double time,unsigned izone,unsigned np,const int *plist
@@ -387,6 +387,7 @@ void JSphInOutVel::GetConfig(std::vector<std::string> &lines)const{
   }
   else if(VelMode==InVelM_Interpolated){
     lines.push_back(fun::PrintStr("  Velocity file: %s",InputVelGrid->GetFile().c_str()));
+    if(InputVelGrid->GetStreaming())lines.push_back(fun::PrintStr("  Velocity data: %u times loaded in windows of %u times",InputVelGrid->CountTimes(),JSphInOutGridData::WINTIMES));
     lines.push_back(fun::PrintStr("  Reset Z velocity: %s","True"));
     if(AwasVel)AwasVel->GetConfig(lines);
   }
@@ -77,6 +77,21 @@ void JSphShiftingZone::PrepareZone(){
   if(UsePosMax)PosMax=PosRef+TDouble3(Vecx.x,Vecy.y,Vecz.z);
   else fgeo::PlanesDomain(PosRef,Vecx,Vecy,Vecz,DomPlax,DomPlay,DomPlaz,DomPladis);
 }
+//==============================================================================
+/// Returns limits of the box including the shifting domain.
+/// Devuelve limites de la caja que incluye el dominio de shifting.
+//==============================================================================
+void JSphShiftingZone::GetBoxLimits(tdouble3 &pmin,tdouble3 &pmax)const{
+  if(UsePosMax){ pmin=PosRef; pmax=PosMax; }
+  else{
+    pmin=pmax=PosRef;
+    for(unsigned c=1;c<8;c++){
+      const tdouble3 pt=PosRef+(c&1? Vecx: TDouble3(0))+(c&2? Vecy: TDouble3(0))+(c&4? Vecz: TDouble3(0));
+      pmin=MinValues(pmin,pt);
+      pmax=MaxValues(pmax,pt);
+    }
+  }
+}
 
 
 //##############################################################################
@@ -340,12 +355,59 @@ template<bool first,bool dbl> void JSphShifting::InitCpuPlanes(unsigned n,unsign
 }
 
 //==============================================================================
-/// Select particles for shifting and initialize shiftposfs[].
-/// Selecciona particulas para shifting e inicializa shiftposfs[].
+/// Select particles for shifting checking only the particles in the cells of
+/// each zone according to the last divide (divdata).
+/// Selecciona particulas para shifting comprobando solo las particulas de las
+/// celdas de cada zona segun el ultimo divide (divdata).
+//==============================================================================
+void JSphShifting::InitCpuCells(unsigned n,unsigned pini,const tdouble3* pos
+  ,tfloat4* shiftposfs,const StDivDataCpu &divdata)const
+{
+  //-Shifting is cancelled outside the zones. | Se anula shifting fuera de las zonas.
+  const int ppini=int(pini),ppfin=ppini+int(n),npf=int(n);
+  #ifdef OMP_USE
+    #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
+  #endif
+  for(int p=ppini;p<ppfin;p++)shiftposfs[p]=TFloat4(FLT_MAX);
+  //-Select particles of each zone. | Selecciona las particulas de cada zona.
+  std::vector<tuint2> ranges;
+  for(unsigned cz=0;cz<GetCount();cz++){
+    const JSphShiftingZone* zo=Zones[cz];
+    tdouble3 pmin,pmax;
+    zo->GetBoxLimits(pmin,pmax);
+    const unsigned nsel=DivDataCpuBoxRanges(divdata,true,pmin,pmax,1,pini,pini+n,ranges);
+    const bool useposmax=zo->GetUsePosMax();
+    const tplane3d plax=zo->GetDomPlax(),play=zo->GetDomPlay(),plaz=zo->GetDomPlaz();
+    const tdouble3 pladis=zo->GetDomPladis();
+    const int nr=int(ranges.size());
+    #ifdef OMP_USE
+      #pragma omp parallel for schedule (dynamic) if(nsel>OMP_LIMIT_COMPUTELIGHT)
+    #endif
+    for(int r=0;r<nr;r++){
+      const unsigned pfin=ranges[r].y;
+      for(unsigned p=ranges[r].x;p<pfin;p++){
+        const tdouble3 ps=pos[p];
+        if(useposmax? fgeo::PointInMinMax(ps,pmin,pmax): fgeo::PlanesDomainCheck(ps,plax,play,plaz,pladis)){
+          shiftposfs[p]=TFloat4(0);
+        }
+      }
+    }
+  }
+}
+
 //==============================================================================
-void JSphShifting::InitCpu(unsigned n,unsigned pini,const tdouble3* pos,tfloat4* shiftposfs)const{
+/// Select particles for shifting and initialize shiftposfs[]. When divdata is
+/// valid, only the particles in the cells of the zones are checked.
+/// Selecciona particulas para shifting e inicializa shiftposfs[]. Cuando 
+/// divdata es valido, solo se comprueban las particulas en las celdas de las
+/// zonas.
+//==============================================================================
+void JSphShifting::InitCpu(unsigned n,unsigned pini,const tdouble3* pos,tfloat4* shiftposfs
+  ,const StDivDataCpu &divdata)const
+{
   const unsigned nz=GetCount();
   if(!nz)memset(shiftposfs+pini,0,sizeof(tfloat4)*n);   //shiftposfs[]=0
+  else if(divdata.begincell)InitCpuCells(n,pini,pos,shiftposfs,divdata);
   else{
     //-Zones defined by position min-max.
     unsigned cz=0;
@@ -388,32 +450,12 @@ void JSphShifting::InitCpu(unsigned n,unsigned pini,const tdouble3* pos,tfloat4*
 void JSphShifting::RunCpu(unsigned n,unsigned pini,double dt,const tfloat4* velrhop
   ,tfloat4* shiftposfs)const
 {
-  const double coefumagn=dt*ShiftCoef*KernelH;
-  const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
-  const float maxdist=float(Dp*0.1); //-Max shifting distance permitted (recommended).
   const int ppini=int(pini),ppfin=pini+int(n),npf=int(n);
   #ifdef OMP_USE
     #pragma omp parallel for schedule (static) if(npf>OMP_LIMIT_COMPUTELIGHT)
   #endif
   for(int p=ppini;p<ppfin;p++){
-    const tfloat4 rs=shiftposfs[p];
-    if(rs.x!=FLT_MAX){
-      const double vx=double(velrhop[p].x);
-      const double vy=double(velrhop[p].y);
-      const double vz=double(velrhop[p].z);
-      double umagn=coefumagn*sqrt(vx*vx+vy*vy+vz*vz);
-      if(ShiftTFS){
-        if(rs.w<ShiftTFS)umagn=0;
-        else umagn*=(double(rs.w)-ShiftTFS)/coeftfs;
-      }
-      const float shiftdistx=float(double(rs.x)*umagn);
-      const float shiftdisty=float(double(rs.y)*umagn);
-      const float shiftdistz=float(double(rs.z)*umagn);
-      shiftposfs[p].x=(fabs(shiftdistx)<maxdist? shiftdistx: (shiftdistx>=0? maxdist: -maxdist));
-      shiftposfs[p].y=(fabs(shiftdisty)<maxdist? shiftdisty: (shiftdisty>=0? maxdist: -maxdist));
-      shiftposfs[p].z=(fabs(shiftdistz)<maxdist? shiftdistz: (shiftdistz>=0? maxdist: -maxdist));
-    }
-    else shiftposfs[p]=TFloat4(0); //-Cancels shifting close to the boundaries. | Anula shifting por proximidad del contorno. 
+    shiftposfs[p]=ComputeShiftCpu(dt,velrhop[p],shiftposfs[p]);
   }
 }
 
@@ -25,6 +25,10 @@
 //:# - Comprueba opcion active en elementos de primer y segundo nivel. (19-03-2020)  
 //:# - Nuevo metodo GetConfigInfo(). (03-06-2020)  
 //:# - Cambio de nombre de J.Shifting a J.SphShifting. (28-06-2020)
+//:# - Nuevo metodo inline ComputeShiftCpu() para calcular el shifting de una particula
+//:#   en la actualizacion fusionada del Symplectic-Corrector. (17-10-2026)
+//:# - Seleccion de particulas en CPU solo sobre las celdas de cada zona segun el
+//:#   ultimo divide. (17-10-2026)
 //:#############################################################################
 
 /// \file JSphShifting.h \brief Declares the class \ref JSphShifting.
@@ -35,12 +39,15 @@
 #include "JObject.h"
 #include "DualSphDef.h"
 #include "JMatrix4.h"
+#include "JCellDivDataCpu.h"
 #ifdef _WITHGPU
   #include <cuda_runtime_api.h>
 #endif
 
 #include <string>
 #include <vector>
+#include <cmath>
+#include <cfloat>
 
 class JLog2;
 class JXml;
@@ -88,6 +95,7 @@ public:
   
   tdouble3 GetPosMin()const{ return(PosRef); }
   tdouble3 GetPosMax()const{ return(PosMax); }
+  void GetBoxLimits(tdouble3 &pmin,tdouble3 &pmax)const;
 
   tplane3d GetDomPlax()const{ return(DomPlax); }
   tplane3d GetDomPlay()const{ return(DomPlay); }
@@ -126,6 +134,8 @@ private:
     ,const tplane3d& plax1,const tplane3d& play1,const tplane3d& plaz1,const tdouble3& pladis1
     ,const tplane3d& plax2,const tplane3d& play2,const tplane3d& plaz2,const tdouble3& pladis2
     ,const tdouble3* pos,tfloat4* shiftposfs)const;
+  void InitCpuCells(unsigned n,unsigned pini,const tdouble3* pos,tfloat4* shiftposfs
+    ,const StDivDataCpu &divdata)const;
 
 
 public:
@@ -148,8 +158,10 @@ public:
   float       GetShiftCoef()const{ return(ShiftCoef); }
   float       GetShiftTFS ()const{ return(ShiftTFS); }
 
-  void InitCpu(unsigned n,unsigned pini,const tdouble3* pos,tfloat4* shiftposfs)const;
+  void InitCpu(unsigned n,unsigned pini,const tdouble3* pos,tfloat4* shiftposfs
+    ,const StDivDataCpu &divdata)const;
   void RunCpu(unsigned n,unsigned pini,double dt,const tfloat4* velrhop,tfloat4* shiftposfs)const;
+  inline tfloat4 ComputeShiftCpu(double dt,const tfloat4 &velrhop,const tfloat4 &rs)const;
 
 #ifdef _WITHGPU
   void InitGpu(unsigned n,unsigned pini,const double2* posxy,const double* posz,float4* shiftposfs,cudaStream_t stm=NULL)const;
@@ -159,6 +171,35 @@ public:
 };
 
 
+//==============================================================================
+/// Returns final shifting displacement of one particle from shiftposfs value 
+/// computed in the interaction. Used by RunCpu() and by the fused update of 
+/// Symplectic-Corrector.
+/// Devuelve el desplazamiento final de shifting de una particula a partir del
+/// valor shiftposfs calculado en la interaccion.
+//==============================================================================
+inline tfloat4 JSphShifting::ComputeShiftCpu(double dt,const tfloat4 &velrhop,const tfloat4 &rs)const{
+  if(rs.x==FLT_MAX)return(TFloat4(0)); //-Cancels shifting close to the boundaries. | Anula shifting por proximidad del contorno. 
+  const double coefumagn=dt*ShiftCoef*KernelH;
+  const float maxdist=float(Dp*0.1); //-Max shifting distance permitted (recommended).
+  const double vx=double(velrhop.x);
+  const double vy=double(velrhop.y);
+  const double vz=double(velrhop.z);
+  double umagn=coefumagn*sqrt(vx*vx+vy*vy+vz*vz);
+  if(ShiftTFS){
+    const double coeftfs=(Simulate2D? 2.0: 3.0)-ShiftTFS;
+    if(rs.w<ShiftTFS)umagn=0;
+    else umagn*=(double(rs.w)-ShiftTFS)/coeftfs;
+  }
+  const float shiftdistx=float(double(rs.x)*umagn);
+  const float shiftdisty=float(double(rs.y)*umagn);
+  const float shiftdistz=float(double(rs.z)*umagn);
+  return(TFloat4((fabs(shiftdistx)<maxdist? shiftdistx: (shiftdistx>=0? maxdist: -maxdist))
+                ,(fabs(shiftdisty)<maxdist? shiftdisty: (shiftdisty>=0? maxdist: -maxdist))
+                ,(fabs(shiftdistz)<maxdist? shiftdistz: (shiftdistz>=0? maxdist: -maxdist)),rs.w));
+}
+
+
 #endif
 
 
@@ -25,7 +25,7 @@
 
 #define OMP_USE  ///<Enables/Disables OpenMP.
 #ifdef OMP_USE
-  //#define OMP_USE_RADIXSORT ///<Enables/disables OpenMP in JRadixSort.
+  #define OMP_USE_RADIXSORT  ///<Enables/disables OpenMP in JRadixSort.
   #define OMP_USE_WAVEGEN    ///<Enables/disables OpenMP in JWaveGen.
 #endif
 
@@ -36,14 +36,14 @@
   #define omp_get_max_threads() 1
 #endif
 
-#define OMP_MAXTHREADS 64  
-#define OMP_STRIDE 200
 #define OMP_LIMIT_COMPUTESTEP 25000
 #define OMP_LIMIT_COMPUTEMEDIUM 10000
 #define OMP_LIMIT_COMPUTELIGHT 100000
 #define OMP_LIMIT_PREINTERACTION 100000
 #define OMP_LIMIT_TRIANGLESCELLS 3000
 #define OMP_LIMIT_LIGHT 100000
+#define OMP_LIMIT_CELLDIVSORT 50000
+#define OMP_LIMIT_FTFORCES 10000  ///<Minimum number of particles of a floating to compute its forces using all threads.
 
 #endif
 
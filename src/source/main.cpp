@@ -53,6 +53,7 @@ Please download source files and documentation from <a href="http://dual.sphysic
 #include "JException.h"
 #include "JSphCfgRun.h"
 #include "JSphCpuSingle.h"
+#include "JRadixSort.h"
 #ifdef _WITHGPU
   #include "JSphGpuSingle.h"
 #endif
@@ -167,7 +168,11 @@ int main(int argc, char** argv){
   try{
     cfg.LoadArgv(argc,argv);
     //cfg.VisuConfig();
-    if(!cfg.PrintInfo){
+    if(!cfg.PrintInfo && cfg.RadixBench){
+      //-Benchmark of RadixSort without simulation.
+      if(!JRadixSort::RunBenchmark(cfg.RadixBench))throw std::string("Results of RadixSort and std::sort are different.");
+    }
+    else if(!cfg.PrintInfo){
       AppInfo.ConfigOutput(cfg.CreateDirs,cfg.CsvSepComa,cfg.DirOut,cfg.DirDataOut);
       AppInfo.LogInit(AppInfo.GetDirOut()+"/Run.out");
       log=AppInfo.LogPtr();